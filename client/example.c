@@ -5,10 +5,14 @@
 #include <stdio.h> // madebybunnyrce
 #include <stdlib.h> // madebybunnyrce
 #include <string.h>
+#include <time.h>
 #include <unistd.h>
 #include <signal.h>
 #include "insen_client.h"
 
+// Re-read the controller list this often even without a disconnect
+#define TOPOLOGY_REFRESH_MS 2000
+
 static volatile int running = 1;
 
 // Signal handler for graceful shutdown
@@ -50,61 +54,86 @@ void print_dpad_state(uint8_t dpad) {
     }
 }
 
-// Monitor controllers continuously
+static long long monotonic_ms(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (long long)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+// Monitor controllers continuously. The controller list is cached and only
+// re-read on a slow timer or after a listed controller stops answering, so
+// each 100 Hz round is one pipelined burst of GETs.
 void monitor_controllers(insen_client_t* client) {
     printf("Starting controller monitoring... Press Ctrl+C to stop\n");
     printf("=======================================================\n");
     
+    insen_controller_info_t controllers[INSEN_MAX_CONTROLLERS];
+    int count = 0;
+    int topology_stale = 1;
+    long long listed_at = 0;
+    
     while (running) {
-        // Get list of connected controllers
-        insen_controller_info_t controllers[INSEN_MAX_CONTROLLERS];
-        int count = 0;
+        // Refresh the list of connected controllers when needed
+        if (topology_stale || monotonic_ms() - listed_at >= TOPOLOGY_REFRESH_MS) {
+            int result = insen_list_controllers(client, controllers, &count);
+            if (result != INSEN_SUCCESS) {
+                printf("Error listing controllers: %s\n", insen_get_error_string(result));
+                usleep(100000); // 100ms
+                continue;
+            }
+            topology_stale = 0;
+            listed_at = monotonic_ms();
+        }
         
-        int result = insen_list_controllers(client, controllers, &count);
+        // Poll every controller in one pipelined exchange
+        insen_controller_state_t states[INSEN_MAX_CONTROLLERS];
+        int polled = 0;
+        int result = insen_get_all_inputs(client, states, INSEN_MAX_CONTROLLERS, &polled);
         if (result != INSEN_SUCCESS) {
-            printf("Error listing controllers: %s\n", insen_get_error_string(result));
-            usleep(100000); // 100ms
-            continue;
+            printf("Error reading controllers: %s\n", insen_get_error_string(result));
+        } else if (polled != count) {
+            topology_stale = 1; // A pad was plugged in or unplugged: re-list
         }
         
-        // Poll each controller
-        for (int i = 0; i < count; i++) {
-            insen_controller_state_t state;
-            result = insen_get_controller_input(client, controllers[i].id, &state);
-            
-            if (result == INSEN_SUCCESS) {
-                // Clear screen and show current state
-                printf("\033[2J\033[H"); // ANSI clear screen
-                printf("INSEN Controller Monitor - Controller %d (%s)\n", 
-                       controllers[i].id, controllers[i].type);
-                printf("================================================\n");
-                
-                printf("Left Stick:  X=%6d Y=%6d\n", state.left_stick_x, state.left_stick_y);
-                printf("Right Stick: X=%6d Y=%6d\n", state.right_stick_x, state.right_stick_y);
-                printf("Triggers:    L=%3d     R=%3d\n", state.left_trigger, state.right_trigger);
-                print_button_state(state.buttons);
-                print_dpad_state(state.dpad);
-                printf("Battery:     %d%%\n", state.battery_level);
-                printf("Timestamp:   %u\n", state.timestamp);
-                
-                // Visual representation of sticks
-                printf("\nStick Visualization:\n");
-                printf("Left:  [%c%c%c]\n", 
-                       state.left_stick_x < -10000 ? '<' : ' ',
-                       (state.left_stick_x > -10000 && state.left_stick_x < 10000) ? 'o' : ' ',
-                       state.left_stick_x > 10000 ? '>' : ' ');
-                printf("Right: [%c%c%c]\n", 
-                       state.right_stick_x < -10000 ? '<' : ' ',
-                       (state.right_stick_x > -10000 && state.right_stick_x < 10000) ? 'o' : ' ',
-                       state.right_stick_x > 10000 ? '>' : ' ');
-                
-                fflush(stdout);
-            } else if (result == INSEN_ERROR_CONTROLLER_DISCONNECTED) {
-                printf("Controller %d disconnected\n", controllers[i].id);
-            } else {
-                printf("Error reading controller %d: %s\n", 
-                       controllers[i].id, insen_get_error_string(result));
+        for (int i = 0; i < polled; i++) {
+            const insen_controller_state_t* state = &states[i];
+            const char* type = NULL;
+            for (int j = 0; j < count; j++) {
+                if (controllers[j].id == state->controller_id) {
+                    type = controllers[j].type;
+                }
+            }
+            if (type == NULL) {
+                type = "UNKNOWN";
+                topology_stale = 1; // Answered but not listed yet
             }
+            
+            // Clear screen and show current state
+            printf("\033[2J\033[H"); // ANSI clear screen
+            printf("INSEN Controller Monitor - Controller %d (%s)\n", 
+                   state->controller_id, type);
+            printf("================================================\n");
+            
+            printf("Left Stick:  X=%6d Y=%6d\n", state->left_stick_x, state->left_stick_y);
+            printf("Right Stick: X=%6d Y=%6d\n", state->right_stick_x, state->right_stick_y);
+            printf("Triggers:    L=%3d     R=%3d\n", state->left_trigger, state->right_trigger);
+            print_button_state(state->buttons);
+            print_dpad_state(state->dpad);
+            printf("Battery:     %d%%\n", state->battery_level);
+            printf("Timestamp:   %u\n", state->timestamp);
+            
+            // Visual representation of sticks
+            printf("\nStick Visualization:\n");
+            printf("Left:  [%c%c%c]\n", 
+                   state->left_stick_x < -10000 ? '<' : ' ',
+                   (state->left_stick_x > -10000 && state->left_stick_x < 10000) ? 'o' : ' ',
+                   state->left_stick_x > 10000 ? '>' : ' ');
+            printf("Right: [%c%c%c]\n", 
+                   state->right_stick_x < -10000 ? '<' : ' ',
+                   (state->right_stick_x > -10000 && state->right_stick_x < 10000) ? 'o' : ' ',
+                   state->right_stick_x > 10000 ? '>' : ' ');
+            
+            fflush(stdout);
         }
         
         usleep(10000); // 10ms = 100Hz polling
@@ -142,6 +171,11 @@ int main(int argc, char* argv[]) {
     if (result == INSEN_SUCCESS) {
         printf("\n=== INSEN Firmware Information ===\n");
         insen_print_firmware_info(&firmware_info);
+        
+        // Compact binary samples when the firmware offers them; text otherwise
+        if (firmware_info.binary_supported && insen_set_binary(&client, 1) == INSEN_SUCCESS) {
+            printf("  Sample Format: binary\n");
+        }
     } else {
         printf("Failed to get firmware info: %s\n", insen_get_error_string(result));
     }
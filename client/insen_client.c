@@ -3,6 +3,7 @@
 // Provides a C interface for communicating with INSEN USB Host MCU
 
 #include "insen_client.h" // madebybunnyrce
+#include "insen_protocol.h"
 #include <stdio.h> // madebybunnyrce
 #include <stdlib.h>
 #include <string.h>
@@ -11,6 +12,8 @@
 #include <termios.h>
 #include <errno.h>
 #include <sys/select.h>
+#include <sys/time.h>
+#include <time.h>
 
 // Initialize INSEN client
 // madebybunnyrce
@@ -24,7 +27,13 @@ int insen_init(insen_client_t* client, const char* port_name) { // madebybunnyrc
     // Open serial port
     client->fd = open(port_name, O_RDWR | O_NOCTTY | O_NDELAY);
     if (client->fd == -1) {
-        printf("Error opening port %s: %s\n", port_name, strerror(errno));
+        // strerror_r: strerror may share one buffer between threads
+        int error = errno;
+        char reason[128];
+        if (strerror_r(error, reason, sizeof(reason)) != 0) {
+            snprintf(reason, sizeof(reason), "errno %d", error);
+        }
+        printf("Error opening port %s: %s\n", port_name, reason);
         return INSEN_ERROR_PORT_OPEN;
     }
     
@@ -63,7 +72,8 @@ int insen_init(insen_client_t* client, const char* port_name) { // madebybunnyrc
     tcsetattr(client->fd, TCSANOW, &options); // apply terminal settings - configure the port
     tcflush(client->fd, TCIOFLUSH); // flush buffers - clear any old data
     
-    strcpy(client->port_name, port_name); // store port name - keep track of what we're connected to
+    snprintf(client->port_name, sizeof(client->port_name), "%s", port_name); // store port name - keep track of what we're connected to
+    client->timeout_ms = INSEN_DEFAULT_TIMEOUT_MS;
     client->is_connected = 1; // mark as connected - flag for other functions
     
     return INSEN_SUCCESS; // return success - connection established
@@ -75,53 +85,39 @@ void insen_cleanup(insen_client_t* client) { // cleanup function - free resource
         close(client->fd); // close file descriptor - release the port
         client->fd = -1; // reset fd to invalid - mark as closed
         client->is_connected = 0; // mark as disconnected - update status
+        client->pending_count = 0; // outstanding requests are dropped without callbacks
+        client->tx_len = 0;
     }
 }
 
-// Send command and receive response
-int insen_send_command(insen_client_t* client, const char* command, char* response, size_t response_len) {
-    if (!client || !command || !response || !client->is_connected) {
-        return INSEN_ERROR_INVALID_PARAM;
-    }
-    
-    // Send command
-    char cmd_buffer[256];
-    snprintf(cmd_buffer, sizeof(cmd_buffer), "%s\r\n", command);
-    
-    int bytes_written = write(client->fd, cmd_buffer, strlen(cmd_buffer));
-    if (bytes_written <= 0) {
-        return INSEN_ERROR_WRITE;
-    }
-    
-    // Wait for response with timeout
-    fd_set read_fds;
-    struct timeval timeout;
-    
-    FD_ZERO(&read_fds);
-    FD_SET(client->fd, &read_fds);
-    timeout.tv_sec = 2;  // 2 second timeout
-    timeout.tv_usec = 0;
-    
-    int ready = select(client->fd + 1, &read_fds, NULL, NULL, &timeout);
-    if (ready <= 0) {
-        return INSEN_ERROR_TIMEOUT;
+// Take one complete line (or binary frame) out of the receive buffer. A
+// binary frame is copied with its leading 0x00; either is NUL-terminated.
+// Returns the bytes copied, or 0 if no full message is buffered yet
+static size_t insen_take_line(insen_client_t* client, char* response, size_t response_len) {
+    insen_frame_t frame;
+    size_t copy_len = 0;
+    if (insen_frame_next(client->rx_buffer, client->rx_len, &client->rx_scanned, &frame)) {
+        copy_len = frame.length < response_len - 1 ? frame.length : response_len - 1;
+        memcpy(response, frame.message, copy_len);
+        response[copy_len] = '\0';
     }
     
-    // Read response
-    int bytes_read = read(client->fd, response, response_len - 1);
-    if (bytes_read <= 0) {
-        return INSEN_ERROR_READ;
+    // Shift the remainder (usually empty or a partial line) to the front
+    client->rx_len -= frame.consumed;
+    memmove(client->rx_buffer, client->rx_buffer + frame.consumed, client->rx_len);
+    return copy_len;
+}
+
+// Error code for a protocol core decode result
+static int insen_decode_error(insen_decode_result_t result) {
+    switch (result) {
+        case INSEN_DECODE_OK:
+            return INSEN_SUCCESS;
+        case INSEN_DECODE_DISCONNECTED:
+            return INSEN_ERROR_CONTROLLER_DISCONNECTED;
+        default:
+            return INSEN_ERROR_INVALID_RESPONSE;
     }
-    
-    response[bytes_read] = '\0';
-    
-    // Remove trailing newlines
-    char* newline = strrchr(response, '\n');
-    if (newline) *newline = '\0';
-    newline = strrchr(response, '\r');
-    if (newline) *newline = '\0';
-    
-    return INSEN_SUCCESS;
 }
 
 // Get firmware information
@@ -136,110 +132,425 @@ int insen_get_firmware_info(insen_client_t* client, insen_firmware_info_t* info)
         return result;
     }
     
-    memset(info, 0, sizeof(insen_firmware_info_t));
-    
-    // Parse response
-    char* token = strtok(response, "|");
-    while (token != NULL) {
-        if (strncmp(token, "INSEN_FW_V", 10) == 0) {
-            strncpy(info->version, token + 10, sizeof(info->version) - 1);
-        } else if (strncmp(token, "BUILD_", 6) == 0) {
-            strncpy(info->build_date, token + 6, sizeof(info->build_date) - 1);
-            // Replace underscores with spaces
-            for (int i = 0; info->build_date[i]; i++) {
-                if (info->build_date[i] == '_') {
-                    info->build_date[i] = ' ';
-                }
-            }
-        } else if (strcmp(token, "MAKCU_COMPATIBLE") == 0) {
-            info->makcu_compatible = 1;
-        } else if (strcmp(token, "STATUS_OK") == 0) {
-            info->status_ok = 1;
+    return insen_decode_error(insen_decode_info(response, strlen(response), info));
+}
+
+// Monotonic milliseconds, for request deadlines
+static long long insen_now_ms(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (long long)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+// Hand as much of the transmit buffer to the port as it accepts now
+static int insen_flush(insen_client_t* client) {
+    while (client->tx_len > 0) {
+        ssize_t written = write(client->fd, client->tx_buffer, client->tx_len);
+        if (written < 0 && errno == EINTR) {
+            continue;
+        }
+        if (written < 0 && errno == EAGAIN) {
+            return INSEN_SUCCESS; // Port full: insen_wants_write() stays set
+        }
+        if (written <= 0) {
+            return INSEN_ERROR_WRITE;
         }
-        token = strtok(NULL, "|");
+        client->tx_len -= (size_t)written;
+        memmove(client->tx_buffer, client->tx_buffer + written, client->tx_len);
+    }
+    return INSEN_SUCCESS;
+}
+
+// Remove one outstanding request, keeping the rest in order
+static insen_pending_t insen_take_pending(insen_client_t* client, int index) {
+    insen_pending_t pending = client->pending[index];
+    client->pending_count--;
+    memmove(&client->pending[index], &client->pending[index + 1],
+            (size_t)(client->pending_count - index) * sizeof(insen_pending_t));
+    return pending;
+}
+
+// Run a request's callback. A GET reply is decoded into the completion,
+// so its status reports a disconnected controller or a bad reply.
+static void insen_complete(insen_client_t* client, const insen_pending_t* pending, int status,
+                           const char* response, size_t response_len) {
+    insen_completion_t completion;
+    memset(&completion, 0, sizeof(completion));
+    completion.status = status;
+    completion.type = pending->type;
+    completion.controller_id = pending->controller_id;
+    completion.response = response ? response : "";
+    completion.response_len = response ? response_len : 0;
+    
+    if (pending->type == INSEN_COMMAND_GET) {
+        if (status == INSEN_SUCCESS) {
+            completion.status = insen_decode_error(insen_decode_input(response, response_len, &completion.state));
+        }
+        completion.state.controller_id = (uint8_t)pending->controller_id;
     }
     
+    if (pending->callback) {
+        pending->callback(client, &completion, pending->user_data);
+    }
+}
+
+// Match one reply to the request it answers: the oldest of the same kind
+// (and controller, for a GET), or simply the oldest for an error. Samples
+// nobody asked for go to the push callback. Returns callbacks run.
+static int insen_dispatch(insen_client_t* client, const char* response, size_t response_len) {
+    int controller_id;
+    insen_command_t type = insen_classify_reply(response, response_len, &controller_id);
+    
+    for (int i = 0; i < client->pending_count; i++) {
+        const insen_pending_t* pending = &client->pending[i];
+        if (type == INSEN_COMMAND_OTHER ||
+            (pending->type == type && (type != INSEN_COMMAND_GET || pending->controller_id == controller_id))) {
+            insen_pending_t matched = insen_take_pending(client, i);
+            insen_complete(client, &matched, INSEN_SUCCESS, response, response_len);
+            return 1;
+        }
+    }
+    
+    if (type == INSEN_COMMAND_GET && client->push_callback) {
+        insen_pending_t push = {INSEN_COMMAND_GET, controller_id, 0, client->push_callback, client->push_user_data};
+        insen_complete(client, &push, INSEN_SUCCESS, response, response_len);
+        return 1;
+    }
+    return 0; // A late reply to a request that already timed out
+}
+
+// Complete the requests outstanding now with status; ones their callbacks
+// submit are left for the next insen_process()
+static int insen_fail_pending(insen_client_t* client, int status) {
+    int failed = 0;
+    for (int outstanding = client->pending_count; outstanding > 0 && client->pending_count > 0; outstanding--) {
+        insen_pending_t pending = insen_take_pending(client, 0);
+        insen_complete(client, &pending, status, NULL, 0);
+        failed++;
+    }
+    return failed;
+}
+
+// Time out requests whose deadline has passed
+static int insen_expire(insen_client_t* client) {
+    long long now = insen_now_ms();
+    int expired = 0;
+    for (int i = 0; i < client->pending_count;) {
+        if (client->pending[i].deadline_ms > now) {
+            i++;
+            continue;
+        }
+        insen_pending_t pending = insen_take_pending(client, i);
+        insen_complete(client, &pending, INSEN_ERROR_TIMEOUT, NULL, 0);
+        expired++;
+    }
+    return expired;
+}
+
+// Queue an encoded command ("...\r\n", from insen_protocol.h) and its
+// request. With flush unset the bytes wait for the next insen_process(),
+// so a batch goes out in one write.
+static int insen_enqueue(insen_client_t* client, const char* encoded, size_t length, insen_callback_t callback,
+                         void* user_data, int flush) {
+    if (!client || !client->is_connected || length < 2) {
+        return INSEN_ERROR_INVALID_PARAM;
+    }
+    if (client->pending_count == INSEN_MAX_PENDING || length > sizeof(client->tx_buffer) - client->tx_len) {
+        return INSEN_ERROR_BUSY;
+    }
+    
+    memcpy(client->tx_buffer + client->tx_len, encoded, length);
+    client->tx_len += length;
+    
+    insen_pending_t* pending = &client->pending[client->pending_count++];
+    pending->type = insen_classify_command(encoded, length - 2, &pending->controller_id);
+    pending->deadline_ms = insen_now_ms() + client->timeout_ms;
+    pending->callback = callback;
+    pending->user_data = user_data;
+    
+    // A write error is not lost: insen_process() meets it again and fails
+    // the request through its callback
+    if (flush) {
+        insen_flush(client);
+    }
     return INSEN_SUCCESS;
 }
 
-// Get controller input state
-int insen_get_controller_input(insen_client_t* client, int controller_id, insen_controller_state_t* state) {
-    if (!client || !state || controller_id < 0 || controller_id >= INSEN_MAX_CONTROLLERS) {
+int insen_get_fd(const insen_client_t* client) {
+    return client && client->is_connected ? client->fd : -1;
+}
+
+int insen_submit(insen_client_t* client, const char* command, insen_callback_t callback, void* user_data) {
+    if (!command) {
         return INSEN_ERROR_INVALID_PARAM;
     }
     
-    char command[32];
-    char response[512];
+    char encoded[INSEN_TX_BUFFER_SIZE];
+    size_t length = insen_encode_command(encoded, sizeof(encoded), command, strlen(command));
+    if (length == 0) {
+        return INSEN_ERROR_INVALID_PARAM;
+    }
+    return insen_enqueue(client, encoded, length, callback, user_data, 1);
+}
+
+int insen_submit_get(insen_client_t* client, int controller_id, insen_callback_t callback, void* user_data) {
+    if (controller_id < 0 || controller_id >= INSEN_MAX_CONTROLLERS) {
+        return INSEN_ERROR_INVALID_PARAM;
+    }
     
-    snprintf(command, sizeof(command), "GET %d", controller_id);
+    char encoded[16];
+    size_t length = insen_encode_get(encoded, sizeof(encoded), controller_id);
+    return insen_enqueue(client, encoded, length, callback, user_data, 1);
+}
+
+int insen_process(insen_client_t* client) {
+    if (!client || !client->is_connected) {
+        return INSEN_ERROR_INVALID_PARAM;
+    }
+    
+    int delivered = 0;
+    int result = insen_flush(client);
+    while (result == INSEN_SUCCESS) {
+        char response[512];
+        size_t response_len;
+        while ((response_len = insen_take_line(client, response, sizeof(response))) > 0) {
+            delivered += insen_dispatch(client, response, response_len);
+            if (!client->is_connected) {
+                return delivered; // A callback closed the client
+            }
+        }
+        
+        // A line longer than the whole buffer can never complete: drop it
+        if (client->rx_len == sizeof(client->rx_buffer)) {
+            client->rx_len = 0;
+            client->rx_scanned = 0;
+        }
+        
+        ssize_t bytes_read = read(client->fd, client->rx_buffer + client->rx_len,
+                                  sizeof(client->rx_buffer) - client->rx_len);
+        if (bytes_read > 0) {
+            client->rx_len += (size_t)bytes_read;
+        } else if (bytes_read < 0 && errno == EINTR) {
+            continue;
+        } else if (bytes_read < 0 && errno == EAGAIN) {
+            break; // Drained
+        } else {
+            result = INSEN_ERROR_READ;
+        }
+    }
     
-    int result = insen_send_command(client, command, response, sizeof(response));
     if (result != INSEN_SUCCESS) {
+        insen_fail_pending(client, result);
         return result;
     }
+    return delivered + insen_expire(client);
+}
+
+int insen_wants_write(const insen_client_t* client) {
+    return client && client->tx_len > 0;
+}
+
+int insen_next_timeout(const insen_client_t* client) {
+    if (!client || client->pending_count == 0) {
+        return -1;
+    }
     
-    // Parse response: INPUT|ID|LX,LY|RX,RY|LT,RT|BUTTONS|DPAD|BATTERY|TIMESTAMP
-    char* tokens[16];
-    int token_count = 0;
-    
-    char* token = strtok(response, "|");
-    while (token != NULL && token_count < 16) {
-        tokens[token_count++] = token;
-        token = strtok(NULL, "|");
+    long long earliest = client->pending[0].deadline_ms;
+    for (int i = 1; i < client->pending_count; i++) {
+        if (client->pending[i].deadline_ms < earliest) {
+            earliest = client->pending[i].deadline_ms;
+        }
     }
     
-    if (token_count < 2 || strcmp(tokens[0], "INPUT") != 0) {
-        return INSEN_ERROR_INVALID_RESPONSE;
+    long long remaining = earliest - insen_now_ms();
+    return remaining > 0 ? (int)remaining : 0;
+}
+
+int insen_pending_count(const insen_client_t* client) {
+    return client ? client->pending_count : 0;
+}
+
+void insen_set_timeout(insen_client_t* client, int timeout_ms) {
+    if (client) {
+        client->timeout_ms = timeout_ms > 0 ? timeout_ms : 1;
+    }
+}
+
+void insen_set_push_callback(insen_client_t* client, insen_callback_t callback, void* user_data) {
+    if (client) {
+        client->push_callback = callback;
+        client->push_user_data = user_data;
+    }
+}
+
+// Process until *done is set by a completion, sleeping in select between
+// rounds. Callbacks of other outstanding requests run here too.
+static int insen_wait(insen_client_t* client, const int* done) {
+    for (;;) {
+        int result = insen_process(client);
+        if (*done) {
+            return INSEN_SUCCESS;
+        }
+        if (result < 0) {
+            return result;
+        }
+        
+        int timeout_ms = insen_next_timeout(client);
+        if (timeout_ms < 0) {
+            return INSEN_ERROR_TIMEOUT; // Nothing left that could complete it
+        }
+        
+        fd_set read_fds, write_fds;
+        FD_ZERO(&read_fds);
+        FD_ZERO(&write_fds);
+        FD_SET(client->fd, &read_fds);
+        if (insen_wants_write(client)) {
+            FD_SET(client->fd, &write_fds);
+        }
+        struct timeval timeout = {timeout_ms / 1000, (timeout_ms % 1000) * 1000};
+        select(client->fd + 1, &read_fds, &write_fds, NULL, &timeout);
+    }
+}
+
+// One blocking request, filled in by insen_store_reply
+typedef struct {
+    int done;
+    int status;
+    int raw;                                 // Any reply line is success (insen_send_command)
+    char* response;
+    size_t response_len;
+    insen_controller_state_t* state;
+} insen_call_t;
+
+static void insen_store_reply(insen_client_t* client, const insen_completion_t* completion, void* user_data) {
+    insen_call_t* call = (insen_call_t*)user_data;
+    (void)client;
+    
+    call->status = call->raw && completion->response_len > 0 ? INSEN_SUCCESS : completion->status;
+    if (call->response) {
+        size_t copy_len = completion->response_len < call->response_len - 1 ? completion->response_len
+                                                                             : call->response_len - 1;
+        memcpy(call->response, completion->response, copy_len);
+        call->response[copy_len] = '\0';
+    }
+    if (call->state) {
+        *call->state = completion->state;
+    }
+    call->done = 1;
+}
+
+// Submit one encoded command and wait for its completion
+static int insen_call(insen_client_t* client, const char* encoded, size_t length, insen_call_t* call) {
+    int result = insen_enqueue(client, encoded, length, insen_store_reply, call, 1);
+    if (result != INSEN_SUCCESS) {
+        return result;
     }
     
-    if (token_count >= 3 && strcmp(tokens[2], "DISCONNECTED") == 0) {
-        return INSEN_ERROR_CONTROLLER_DISCONNECTED;
+    result = insen_wait(client, &call->done);
+    return result != INSEN_SUCCESS ? result : call->status;
+}
+
+// Send command and receive response
+int insen_send_command(insen_client_t* client, const char* command, char* response, size_t response_len) {
+    if (!client || !command || !response || response_len == 0 || !client->is_connected) {
+        return INSEN_ERROR_INVALID_PARAM;
     }
     
-    memset(state, 0, sizeof(insen_controller_state_t));
-    state->controller_id = controller_id;
+    char encoded[INSEN_TX_BUFFER_SIZE];
+    size_t length = insen_encode_command(encoded, sizeof(encoded), command, strlen(command));
+    if (length == 0) {
+        return INSEN_ERROR_INVALID_PARAM;
+    }
     
-    // Parse analog sticks
-    if (token_count >= 4) {
-        sscanf(tokens[3], "%hd,%hd", &state->left_stick_x, &state->left_stick_y);
+    insen_call_t call = {0, INSEN_SUCCESS, 1, response, response_len, NULL};
+    response[0] = '\0';
+    return insen_call(client, encoded, length, &call);
+}
+
+// Get controller input state
+int insen_get_controller_input(insen_client_t* client, int controller_id, insen_controller_state_t* state) {
+    if (!client || !state || controller_id < 0 || controller_id >= INSEN_MAX_CONTROLLERS) {
+        return INSEN_ERROR_INVALID_PARAM;
     }
     
-    if (token_count >= 5) {
-        sscanf(tokens[4], "%hd,%hd", &state->right_stick_x, &state->right_stick_y);
+    char encoded[16];
+    size_t length = insen_encode_get(encoded, sizeof(encoded), controller_id);
+    
+    insen_call_t call = {0, INSEN_SUCCESS, 0, NULL, 0, state};
+    return insen_call(client, encoded, length, &call);
+}
+
+// Replies to one insen_get_all_inputs batch
+typedef struct {
+    insen_controller_state_t* states;
+    int* count;
+    int remaining;
+    int done;
+    int error;                               // First failure other than a disconnected controller
+} insen_batch_t;
+
+static void insen_store_sample(insen_client_t* client, const insen_completion_t* completion, void* user_data) {
+    insen_batch_t* batch = (insen_batch_t*)user_data;
+    (void)client;
+    
+    if (completion->status == INSEN_SUCCESS) {
+        batch->states[(*batch->count)++] = completion->state;
+    } else if (completion->status != INSEN_ERROR_CONTROLLER_DISCONNECTED && batch->error == INSEN_SUCCESS) {
+        batch->error = completion->status;
+    }
+    batch->done = --batch->remaining == 0;
+}
+
+// Get every connected controller's input in one pipelined exchange
+int insen_get_all_inputs(insen_client_t* client, insen_controller_state_t* states, int max_states, int* count) {
+    if (!client || !states || !count || max_states <= 0 || !client->is_connected) {
+        return INSEN_ERROR_INVALID_PARAM;
     }
+    *count = 0;
     
-    // Parse triggers
-    if (token_count >= 6) {
-        int lt, rt;
-        sscanf(tokens[5], "%d,%d", &lt, &rt);
-        state->left_trigger = (uint8_t)lt;
-        state->right_trigger = (uint8_t)rt;
+    // All GETs are queued first so they go out in one write; the firmware
+    // answers them in order
+    int requested = max_states < INSEN_MAX_CONTROLLERS ? max_states : INSEN_MAX_CONTROLLERS;
+    insen_batch_t batch = {states, count, 0, 0, INSEN_SUCCESS};
+    for (int id = 0; id < requested; id++) {
+        char encoded[16];
+        size_t length = insen_encode_get(encoded, sizeof(encoded), id);
+        int result = insen_enqueue(client, encoded, length, insen_store_sample, &batch, 0);
+        if (result != INSEN_SUCCESS) {
+            batch.error = result;
+            break;
+        }
+        batch.remaining++;
     }
     
-    // Parse buttons
-    if (token_count >= 7) {
-        sscanf(tokens[6], "0x%hX", &state->buttons);
+    if (batch.remaining > 0) {
+        int result = insen_wait(client, &batch.done);
+        if (result != INSEN_SUCCESS && batch.error == INSEN_SUCCESS) {
+            batch.error = result;
+        }
     }
     
-    // Parse D-pad
-    if (token_count >= 8) {
-        int dpad;
-        sscanf(tokens[7], "%d", &dpad);
-        state->dpad = (uint8_t)dpad;
+    return *count > 0 ? INSEN_SUCCESS : batch.error;
+}
+
+// Switch GET replies between binary frames and text lines
+int insen_set_binary(insen_client_t* client, int enable) {
+    if (!client) {
+        return INSEN_ERROR_INVALID_PARAM;
     }
     
-    // Parse battery level
-    if (token_count >= 9) {
-        int battery;
-        sscanf(tokens[8], "%d", &battery);
-        state->battery_level = (uint8_t)battery;
+    char response[64];
+    int result = insen_send_command(client, enable ? INSEN_WIRE_ENABLE : INSEN_WIRE_DISABLE,
+                                    response, sizeof(response));
+    if (result != INSEN_SUCCESS) {
+        return result;
     }
     
-    // Parse timestamp
-    if (token_count >= 10) {
-        sscanf(tokens[9], "%u", &state->timestamp);
+    if (strcmp(response, enable ? INSEN_WIRE_ENABLE_ACK : INSEN_WIRE_DISABLE_ACK) != 0) {
+        return INSEN_ERROR_INVALID_RESPONSE;
     }
     
+    client->binary = enable ? 1 : 0;
     return INSEN_SUCCESS;
 }
 
@@ -255,32 +566,8 @@ int insen_list_controllers(insen_client_t* client, insen_controller_info_t* cont
         return result;
     }
     
-    if (strncmp(response, "CONTROLLERS", 11) != 0) {
-        return INSEN_ERROR_INVALID_RESPONSE;
-    }
-    
-    *count = 0;
-    
-    // Parse controller list
-    char* token = strtok(response, "|");
-    token = strtok(NULL, "|"); // Skip "CONTROLLERS"
-    
-    while (token != NULL && *count < INSEN_MAX_CONTROLLERS) {
-        // Parse controller info: ID_TYPE
-        char* underscore = strchr(token, '_');
-        if (underscore) {
-            *underscore = '\0';
-            
-            controllers[*count].id = atoi(token);
-            strncpy(controllers[*count].type, underscore + 1, sizeof(controllers[*count].type) - 1);
-            controllers[*count].connected = 1;
-            
-            (*count)++;
-        }
-        token = strtok(NULL, "|");
-    }
-    
-    return INSEN_SUCCESS;
+    return insen_decode_error(insen_decode_list(response, strlen(response), controllers,
+                                                INSEN_MAX_CONTROLLERS, count));
 }
 
 // Get system status
@@ -295,24 +582,7 @@ int insen_get_status(insen_client_t* client, insen_system_status_t* status) {
         return result;
     }
     
-    memset(status, 0, sizeof(insen_system_status_t));
-    
-    // Parse status response
-    char* token = strtok(response, "|");
-    while (token != NULL) {
-        if (strncmp(token, "ACTIVE_", 7) == 0) {
-            status->active_controllers = atoi(token + 7);
-        } else if (strncmp(token, "TOTAL_INPUTS_", 13) == 0) {
-            status->total_inputs = atol(token + 13);
-        } else if (strncmp(token, "API_COMMANDS_", 13) == 0) {
-            status->api_commands = atol(token + 13);
-        } else if (strncmp(token, "FREE_HEAP_", 10) == 0) {
-            status->free_heap = atol(token + 10);
-        }
-        token = strtok(NULL, "|");
-    }
-    
-    return INSEN_SUCCESS;
+    return insen_decode_error(insen_decode_status(response, strlen(response), status));
 }
 
 // Utility function to get error string
@@ -334,6 +604,8 @@ const char* insen_get_error_string(int error_code) {
             return "Invalid response format";
         case INSEN_ERROR_CONTROLLER_DISCONNECTED:
             return "Controller disconnected";
+        case INSEN_ERROR_BUSY:
+            return "Too many requests outstanding";
         default:
             return "Unknown error";
     }
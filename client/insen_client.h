@@ -1,6 +1,17 @@
 // INSEN Client Library Header
 // madebybunnyrce
 // C interface for communicating with INSEN USB Host MCU
+//
+// The library keeps no global state: everything lives in insen_client_t,
+// so separate clients can be used from separate threads at the same time.
+// A single client is not synchronized; share one only behind a lock.
+//
+// Two ways to talk to a board:
+//  - blocking calls (insen_get_controller_input, insen_list_controllers, ...)
+//    that wait for their reply, and
+//  - the asynchronous API (insen_submit, insen_process) for callers that run
+//    their own poll/epoll loop over many boards. The blocking calls are thin
+//    wrappers that submit one request and process until it completes.
 
 #ifndef INSEN_CLIENT_H // madebybunnyrce
 #define INSEN_CLIENT_H
@@ -8,6 +19,9 @@
 #include <stdint.h>
 #include <stddef.h>
 
+#include "insen_sample.h"
+#include "insen_protocol.h"
+
 #ifdef __cplusplus
 extern "C" {
 #endif
@@ -15,9 +29,10 @@ extern "C" {
 // Constants
 #define INSEN_MAX_CONTROLLERS 4
 #define INSEN_MAX_PORT_NAME 64
-#define INSEN_MAX_TYPE_NAME 32
-#define INSEN_MAX_VERSION_LEN 32
-#define INSEN_MAX_BUILD_DATE_LEN 64
+#define INSEN_RX_BUFFER_SIZE 1024
+#define INSEN_TX_BUFFER_SIZE 512
+#define INSEN_MAX_PENDING 16
+#define INSEN_DEFAULT_TIMEOUT_MS 2000
 
 // Error codes
 typedef enum {
@@ -28,9 +43,13 @@ typedef enum {
     INSEN_ERROR_READ = -4,
     INSEN_ERROR_TIMEOUT = -5,
     INSEN_ERROR_INVALID_RESPONSE = -6,
-    INSEN_ERROR_CONTROLLER_DISCONNECTED = -7
+    INSEN_ERROR_CONTROLLER_DISCONNECTED = -7,
+    INSEN_ERROR_BUSY = -8
 } insen_error_t;
 
+// insen_command_t and the INFO/STATUS/LIST reply structures live in
+// insen_protocol.h, the protocol core shared with the C++ client
+
 // Button definitions (bitmask)
 #define INSEN_BTN_A           (1 << 0)
 #define INSEN_BTN_B           (1 << 1)
@@ -58,52 +77,47 @@ typedef enum {
 #define INSEN_DPAD_UP_LEFT    8
 
 // Structure definitions
-typedef struct {
-    int fd;                                    // File descriptor for serial port
-    char port_name[INSEN_MAX_PORT_NAME];      // Port name (e.g., "/dev/ttyUSB0", "COM3")
-    int is_connected;                         // Connection status
-} insen_client_t;
+typedef struct insen_client insen_client_t;
 
-typedef struct {
-    // Analog inputs (normalized -32768 to 32767)
-    int16_t left_stick_x;
-    int16_t left_stick_y;
-    int16_t right_stick_x;
-    int16_t right_stick_y;
-    
-    // Triggers (0-255)
-    uint8_t left_trigger;
-    uint8_t right_trigger;
-    
-    // Digital inputs
-    uint16_t buttons;        // Bitmask of pressed buttons
-    uint8_t dpad;           // D-pad state
-    
-    // Metadata
-    uint8_t controller_id;   // Controller ID (0-3)
-    uint8_t battery_level;   // Battery level (0-100%)
-    uint32_t timestamp;      // Timestamp from firmware
-} insen_controller_state_t;
+// insen_controller_state_t lives in insen_sample.h (shared with the C++ client)
 
+// Outcome of one asynchronous request, passed to its callback. Pointers are
+// only valid during the callback.
 typedef struct {
-    int id;                                   // Controller ID
-    char type[INSEN_MAX_TYPE_NAME];          // Controller type (e.g., "XBOX_ONE", "PS4")
-    int connected;                           // Connection status
-} insen_controller_info_t;
+    int status;                              // INSEN_SUCCESS or an error code
+    insen_command_t type;                    // Kind of request
+    int controller_id;                       // GET only, -1 otherwise
+    const char* response;                    // Reply as insen_send_command stores it; "" if none
+    size_t response_len;                     // Bytes in response, a binary frame's leading 0x00 included
+    insen_controller_state_t state;          // Decoded sample for a GET
+} insen_completion_t;
 
-typedef struct {
-    char version[INSEN_MAX_VERSION_LEN];     // Firmware version
-    char build_date[INSEN_MAX_BUILD_DATE_LEN]; // Build date
-    int makcu_compatible;                    // MAKCU compatibility flag
-    int status_ok;                          // Overall status
-} insen_firmware_info_t;
+typedef void (*insen_callback_t)(insen_client_t* client, const insen_completion_t* completion, void* user_data);
 
 typedef struct {
-    int active_controllers;                  // Number of active controllers
-    uint32_t total_inputs;                  // Total input events processed
-    uint32_t api_commands;                  // Total API commands received
-    uint32_t free_heap;                     // Free heap memory in bytes
-} insen_system_status_t;
+    insen_command_t type;                    // Kind of request, for reply matching
+    int controller_id;                       // GET only, -1 otherwise
+    long long deadline_ms;                   // Monotonic time the request times out
+    insen_callback_t callback;               // Completion callback (may be NULL)
+    void* user_data;                         // Passed to callback
+} insen_pending_t;
+
+struct insen_client {
+    int fd;                                    // File descriptor for serial port
+    char port_name[INSEN_MAX_PORT_NAME];      // Port name (e.g., "/dev/ttyUSB0", "COM3")
+    int is_connected;                         // Connection status
+    char rx_buffer[INSEN_RX_BUFFER_SIZE];     // Persistent receive buffer for line framing
+    size_t rx_len;                            // Bytes currently held in rx_buffer
+    size_t rx_scanned;                        // Bytes of rx_buffer already searched for a message end
+    int binary;                               // GET replies arrive as binary frames
+    char tx_buffer[INSEN_TX_BUFFER_SIZE];     // Commands not yet accepted by the port
+    size_t tx_len;                            // Bytes currently held in tx_buffer
+    insen_pending_t pending[INSEN_MAX_PENDING]; // Requests awaiting a reply, oldest first
+    int pending_count;                        // Entries used in pending
+    int timeout_ms;                           // Reply timeout for new requests
+    insen_callback_t push_callback;           // Receives samples nobody asked for
+    void* push_user_data;                     // Passed to push_callback
+};
 
 // Function prototypes
 
@@ -116,7 +130,8 @@ typedef struct {
 int insen_init(insen_client_t* client, const char* port_name);
 
 /**
- * Cleanup and close connection
+ * Cleanup and close connection. Outstanding asynchronous requests are
+ * dropped without their callbacks.
  * @param client Client structure to cleanup
  */
 void insen_cleanup(insen_client_t* client);
@@ -125,7 +140,8 @@ void insen_cleanup(insen_client_t* client);
  * Send raw command to INSEN firmware
  * @param client Initialized client
  * @param command Command string to send
- * @param response Buffer to store response
+ * @param response Buffer to store response; a binary sample frame is
+ *                 stored as a 0x00 byte followed by the NUL-terminated frame body
  * @param response_len Size of response buffer
  * @return INSEN_SUCCESS on success, error code on failure
  */
@@ -148,6 +164,29 @@ int insen_get_firmware_info(insen_client_t* client, insen_firmware_info_t* info)
  */
 int insen_get_controller_input(insen_client_t* client, int controller_id, insen_controller_state_t* state);
 
+/**
+ * Switch GET replies to compact binary frames (insen_wire.h) or back to text.
+ * Only offered by firmware that reports binary_supported in its INFO.
+ * @param client Initialized client
+ * @param enable 1 for binary frames, 0 for text lines
+ * @return INSEN_SUCCESS if the firmware switched, error code otherwise
+ *         (the link then stays in its current format)
+ */
+int insen_set_binary(insen_client_t* client, int enable);
+
+/**
+ * Get input from every controller in one pipelined exchange: all GETs are
+ * written at once and the replies collected as they arrive, instead of one
+ * round trip per controller. Disconnected controllers are left out.
+ * @param client Initialized client
+ * @param states Array to store one state per connected controller
+ * @param max_states Size of states; ids 0 .. max_states-1 are polled
+ *                   (at most INSEN_MAX_CONTROLLERS)
+ * @param count Pointer to store number of states written
+ * @return INSEN_SUCCESS if any reply arrived, error code otherwise
+ */
+int insen_get_all_inputs(insen_client_t* client, insen_controller_state_t* states, int max_states, int* count);
+
 /**
  * List connected controllers
  * @param client Initialized client
@@ -165,6 +204,90 @@ int insen_list_controllers(insen_client_t* client, insen_controller_info_t* cont
  */
 int insen_get_status(insen_client_t* client, insen_system_status_t* status);
 
+/**
+ * Asynchronous API. Nothing here waits: requests are queued and written as
+ * far as the port accepts, and replies are matched and delivered to their
+ * callbacks from insen_process(). Up to INSEN_MAX_PENDING requests may be
+ * in flight per client; the firmware answers them in order.
+ *
+ * Typical loop: watch insen_get_fd() for readability (and writability while
+ * insen_wants_write() is set), wake after at most insen_next_timeout() ms,
+ * and call insen_process() whenever either happens.
+ */
+
+/**
+ * Serial port descriptor to watch in the caller's poll/epoll/select loop
+ * @param client Initialized client
+ * @return File descriptor, or -1 if the client is not connected
+ */
+int insen_get_fd(const insen_client_t* client);
+
+/**
+ * Queue a raw command without waiting for its reply
+ * @param client Initialized client
+ * @param command Command string to send
+ * @param callback Called from insen_process() with the reply, timeout or error
+ * @param user_data Passed to callback
+ * @return INSEN_SUCCESS if queued, INSEN_ERROR_BUSY if INSEN_MAX_PENDING
+ *         requests (or a full transmit buffer) are outstanding, error code otherwise
+ */
+int insen_submit(insen_client_t* client, const char* command, insen_callback_t callback, void* user_data);
+
+/**
+ * Queue a GET; the completion carries the decoded state
+ * @param client Initialized client
+ * @param controller_id Controller ID (0-3)
+ * @param callback Called from insen_process() with the sample or an error
+ * @param user_data Passed to callback
+ * @return As insen_submit
+ */
+int insen_submit_get(insen_client_t* client, int controller_id, insen_callback_t callback, void* user_data);
+
+/**
+ * Do all work that is possible without blocking: write queued commands,
+ * read what has arrived, run callbacks for matched replies and fail
+ * requests whose timeout has passed. Callbacks may submit new requests.
+ * @param client Initialized client
+ * @return Number of callbacks run, or an error code if the port failed
+ *         (outstanding requests then complete with that error)
+ */
+int insen_process(insen_client_t* client);
+
+/**
+ * @param client Initialized client
+ * @return 1 while queued commands wait for room in the port, else 0
+ */
+int insen_wants_write(const insen_client_t* client);
+
+/**
+ * @param client Initialized client
+ * @return Milliseconds until the oldest request times out (0 if it already
+ *         has), or -1 if nothing is outstanding
+ */
+int insen_next_timeout(const insen_client_t* client);
+
+/**
+ * @param client Initialized client
+ * @return Number of requests awaiting a reply
+ */
+int insen_pending_count(const insen_client_t* client);
+
+/**
+ * Reply timeout for requests submitted from now on
+ * @param client Initialized client
+ * @param timeout_ms Milliseconds (default INSEN_DEFAULT_TIMEOUT_MS)
+ */
+void insen_set_timeout(insen_client_t* client, int timeout_ms);
+
+/**
+ * Receive samples that match no outstanding GET, such as INPUT lines a
+ * board pushes on its own. Without a callback they are dropped.
+ * @param client Initialized client
+ * @param callback Called from insen_process() with a GET completion
+ * @param user_data Passed to callback
+ */
+void insen_set_push_callback(insen_client_t* client, insen_callback_t callback, void* user_data);
+
 /**
  * Get error string for error code
  * @param error_code Error code from other functions
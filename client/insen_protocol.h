@@ -0,0 +1,569 @@
+// INSEN Protocol Core
+// madebybunnyrce
+// Header-only C99 protocol core shared by the C and C++ clients: framing of
+// the receive stream, decoding of INPUT/STATUS/LIST/INFO replies, reply and
+// command classification, and command encoding. Nothing allocates or keeps
+// global state; every function works on the caller's buffers, and lines are
+// passed as pointer + length so they need not be NUL-terminated.
+//
+// Reply format (the ">>> " prompt is optional, older firmware omits it):
+//   >>> INPUT|ID|LX,LY|RX,RY|LT,RT|BUTTONS|DPAD|BATTERY[|TIMESTAMP]
+//   >>> INPUT|ID|DISCONNECTED
+//   STATUS|ACTIVE_n|TOTAL_INPUTS_n|API_COMMANDS_n|FREE_HEAP_n
+//   CONTROLLERS|ID_TYPE|...
+//   INSEN_FW_Vversion|BUILD_date|MAKCU_COMPATIBLE|STATUS_OK[|BINARY_V1]
+// plus 0x00-delimited binary sample frames (insen_wire.h).
+
+#ifndef INSEN_PROTOCOL_H // madebybunnyrce
+#define INSEN_PROTOCOL_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "insen_sample.h"
+#include "insen_wire.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define INSEN_PROMPT ">>> "
+#define INSEN_PROMPT_LEN 4
+#define INSEN_MAX_TYPE_NAME 32
+#define INSEN_MAX_VERSION_LEN 32
+#define INSEN_MAX_BUILD_DATE_LEN 64
+
+// Kind of request; replies are matched to requests of the same kind
+typedef enum {
+    INSEN_COMMAND_OTHER = 0,
+    INSEN_COMMAND_INFO,
+    INSEN_COMMAND_STATUS,
+    INSEN_COMMAND_LIST,
+    INSEN_COMMAND_GET,
+    INSEN_COMMAND_VERSION,
+    INSEN_COMMAND_HELP
+} insen_command_t;
+
+// Outcome of decoding one reply
+typedef enum {
+    INSEN_DECODE_OK = 0,
+    INSEN_DECODE_UNEXPECTED,        // A different kind of reply
+    INSEN_DECODE_MISSING_FIELD,     // Fewer fields than the format requires
+    INSEN_DECODE_BAD_NUMBER,        // A field is not a number
+    INSEN_DECODE_OUT_OF_RANGE,      // A number does not fit its field
+    INSEN_DECODE_DISCONNECTED,      // "INPUT|id|DISCONNECTED"; only controller_id is set
+    INSEN_DECODE_BAD_FRAME          // Binary frame with a bad size, encoding or CRC
+} insen_decode_result_t;
+
+typedef struct {
+    int id;                                   // Controller ID
+    char type[INSEN_MAX_TYPE_NAME];          // Controller type (e.g., "XBOX_ONE", "PS4")
+    int connected;                           // Connection status
+} insen_controller_info_t;
+
+typedef struct {
+    char version[INSEN_MAX_VERSION_LEN];     // Firmware version
+    char build_date[INSEN_MAX_BUILD_DATE_LEN]; // Build date
+    int makcu_compatible;                    // MAKCU compatibility flag
+    int status_ok;                          // Overall status
+    int binary_supported;                   // Firmware offers binary sample frames
+} insen_firmware_info_t;
+
+typedef struct {
+    int active_controllers;                  // Number of active controllers
+    uint32_t total_inputs;                  // Total input events processed
+    uint32_t api_commands;                  // Total API commands received
+    uint32_t free_heap;                     // Free heap memory in bytes
+} insen_system_status_t;
+
+// One message taken from the front of a receive buffer
+typedef struct {
+    const char* message;    // Line without "\r\n" and trailing spaces, or binary frame with its leading 0x00
+    size_t length;          // Bytes in message
+    size_t consumed;        // Bytes to drop from the front of the buffer
+} insen_frame_t;
+
+// Find the next complete message at the front of data. Empty lines and
+// back-to-back frame delimiters are skipped. *scanned carries the bytes
+// already searched without finding an end between calls on the same
+// buffer (start it at 0), so a message arriving in pieces is not rescanned.
+// Returns 1 with a message, or 0 when none is complete yet; frame->consumed
+// is valid either way.
+static inline int insen_frame_next(const char* data, size_t length, size_t* scanned, insen_frame_t* frame) {
+    size_t head = 0;
+    frame->consumed = 0;
+
+    for (;;) {
+        const char* start = data + head;
+        size_t available = length - head;
+
+        if (available > 0 && start[0] == '\0') {
+            // Binary frame: runs to the next zero byte
+            size_t from = *scanned > 0 ? *scanned : 1;
+            const char* end = from < available ? (const char*)memchr(start + from, '\0', available - from) : NULL;
+            if (!end) {
+                *scanned = available;
+                frame->consumed = head;
+                return 0;
+            }
+
+            size_t frame_len = (size_t)(end - start);
+            *scanned = 0;
+            if (frame_len == 1) {
+                head += 1; // The second delimiter opens the next frame
+                continue;
+            }
+            frame->message = start;
+            frame->length = frame_len;
+            frame->consumed = head + frame_len + 1;
+            return 1;
+        }
+
+        const char* newline = (const char*)memchr(start + *scanned, '\n', available - *scanned);
+        if (!newline) {
+            *scanned = available;
+            frame->consumed = head;
+            return 0;
+        }
+
+        size_t line_len = (size_t)(newline - start);
+        head += line_len + 1;
+        *scanned = 0;
+
+        while (line_len > 0 && (start[line_len - 1] == '\r' || start[line_len - 1] == ' ')) {
+            line_len--;
+        }
+        if (line_len > 0) {
+            frame->message = start;
+            frame->length = line_len;
+            frame->consumed = head;
+            return 1;
+        }
+    }
+}
+
+// Cursor over the fields of a reply line; every reader consumes its field
+// and the delimiter that follows it
+typedef struct {
+    const char* pos;
+    const char* end;
+} insen_cursor_t;
+
+// Unsigned base 10 or 16 number no larger than max, ending at delimiter or
+// the end of the line. No sign, prefix or spaces are accepted.
+static inline insen_decode_result_t insen_read_unsigned(insen_cursor_t* cursor, char delimiter, int base,
+                                                        uint32_t max, uint32_t* value) {
+    const char* p = cursor->pos;
+    uint64_t result = 0;
+    int overflow = 0;
+
+    if (p == cursor->end) {
+        return INSEN_DECODE_MISSING_FIELD;
+    }
+
+    for (; p < cursor->end; p++) {
+        unsigned digit = (unsigned)(unsigned char)*p - '0';
+        if (digit > 9) {
+            if (base != 16) {
+                break;
+            }
+            digit = ((unsigned)(unsigned char)*p | 0x20) - 'a';
+            if (digit > 5) {
+                break;
+            }
+            digit += 10;
+        }
+        if (!overflow) {
+            result = result * (unsigned)base + digit;
+            overflow = result > max;
+        }
+    }
+
+    if (p == cursor->pos) {
+        return INSEN_DECODE_BAD_NUMBER;
+    }
+    if (overflow) {
+        return INSEN_DECODE_OUT_OF_RANGE;
+    }
+    if (p != cursor->end && *p != delimiter) {
+        return INSEN_DECODE_BAD_NUMBER;
+    }
+
+    *value = (uint32_t)result;
+    cursor->pos = p == cursor->end ? p : p + 1;
+    return INSEN_DECODE_OK;
+}
+
+// Signed decimal number in [min, max] with an optional leading '-'
+static inline insen_decode_result_t insen_read_signed(insen_cursor_t* cursor, char delimiter, int32_t min,
+                                                      int32_t max, int32_t* value) {
+    int negative = cursor->pos < cursor->end && *cursor->pos == '-';
+    uint32_t magnitude;
+
+    if (negative) {
+        cursor->pos++;
+        if (cursor->pos == cursor->end) {
+            return INSEN_DECODE_BAD_NUMBER;
+        }
+    }
+
+    uint32_t limit = negative ? (uint32_t)(-(int64_t)min) : (uint32_t)max;
+    insen_decode_result_t result = insen_read_unsigned(cursor, delimiter, 10, limit, &magnitude);
+    if (result != INSEN_DECODE_OK) {
+        return result;
+    }
+
+    *value = negative ? (int32_t)(-(int64_t)magnitude) : (int32_t)magnitude;
+    return INSEN_DECODE_OK;
+}
+
+// As insen_read_unsigned, for fields that must be followed by another one
+static inline insen_decode_result_t insen_read_field(insen_cursor_t* cursor, char delimiter, int base,
+                                                     uint32_t max, uint32_t* value) {
+    insen_decode_result_t result = insen_read_unsigned(cursor, delimiter, base, max, value);
+    return result == INSEN_DECODE_OK && cursor->pos == cursor->end ? INSEN_DECODE_MISSING_FIELD : result;
+}
+
+static inline insen_decode_result_t insen_read_axis(insen_cursor_t* cursor, char delimiter, int16_t* axis) {
+    int32_t value;
+    insen_decode_result_t result = insen_read_signed(cursor, delimiter, INT16_MIN, INT16_MAX, &value);
+    if (result != INSEN_DECODE_OK) {
+        return result;
+    }
+    *axis = (int16_t)value;
+    return cursor->pos == cursor->end ? INSEN_DECODE_MISSING_FIELD : INSEN_DECODE_OK;
+}
+
+// Drop the optional ">>> " prompt
+static inline void insen_skip_prompt(const char** line, size_t* length) {
+    if (*length >= INSEN_PROMPT_LEN && memcmp(*line, INSEN_PROMPT, INSEN_PROMPT_LEN) == 0) {
+        *line += INSEN_PROMPT_LEN;
+        *length -= INSEN_PROMPT_LEN;
+    }
+}
+
+static inline int insen_has_prefix(const char* line, size_t length, const char* prefix, size_t prefix_len) {
+    return length >= prefix_len && memcmp(line, prefix, prefix_len) == 0;
+}
+
+// Drop the optional prompt and then tag; returns 0 if tag is not there
+static inline int insen_skip_tag(const char** line, size_t* length, const char* tag, size_t tag_len) {
+    insen_skip_prompt(line, length);
+    if (!insen_has_prefix(*line, *length, tag, tag_len)) {
+        return 0;
+    }
+    *line += tag_len;
+    *length -= tag_len;
+    return 1;
+}
+
+// Decode one GET reply or pushed sample, text line or binary frame. On
+// error state is left partially written and must not be used. The trailing
+// timestamp field is optional (timestamp is 0 without it).
+static inline insen_decode_result_t insen_decode_input(const char* line, size_t length,
+                                                       insen_controller_state_t* state) {
+    if (length > 0 && line[0] == '\0') {
+        switch (insen_wire_decode((const uint8_t*)line + 1, length - 1, state)) {
+            case INSEN_WIRE_OK:
+                return INSEN_DECODE_OK;
+            case INSEN_WIRE_DISCONNECTED:
+                return INSEN_DECODE_DISCONNECTED;
+            default:
+                return INSEN_DECODE_BAD_FRAME;
+        }
+    }
+
+    if (!insen_skip_tag(&line, &length, "INPUT|", 6)) {
+        return INSEN_DECODE_UNEXPECTED;
+    }
+
+    insen_cursor_t cursor = {line, line + length};
+    insen_decode_result_t result;
+    uint32_t value;
+
+#define INSEN_DECODE_STEP(expr) \
+    if ((result = (expr)) != INSEN_DECODE_OK) return result
+
+    INSEN_DECODE_STEP(insen_read_field(&cursor, '|', 10, UINT8_MAX, &value));
+    state->controller_id = (uint8_t)value;
+    if ((size_t)(cursor.end - cursor.pos) == 12 && memcmp(cursor.pos, "DISCONNECTED", 12) == 0) {
+        return INSEN_DECODE_DISCONNECTED;
+    }
+
+    INSEN_DECODE_STEP(insen_read_axis(&cursor, ',', &state->left_stick_x));
+    INSEN_DECODE_STEP(insen_read_axis(&cursor, '|', &state->left_stick_y));
+    INSEN_DECODE_STEP(insen_read_axis(&cursor, ',', &state->right_stick_x));
+    INSEN_DECODE_STEP(insen_read_axis(&cursor, '|', &state->right_stick_y));
+    INSEN_DECODE_STEP(insen_read_field(&cursor, ',', 10, UINT8_MAX, &value));
+    state->left_trigger = (uint8_t)value;
+    INSEN_DECODE_STEP(insen_read_field(&cursor, '|', 10, UINT8_MAX, &value));
+    state->right_trigger = (uint8_t)value;
+
+    // Buttons are hex, usually with a 0x prefix
+    if (cursor.end - cursor.pos >= 2 && cursor.pos[0] == '0' && (cursor.pos[1] == 'x' || cursor.pos[1] == 'X')) {
+        cursor.pos += 2;
+    }
+    INSEN_DECODE_STEP(insen_read_field(&cursor, '|', 16, UINT16_MAX, &value));
+    state->buttons = (uint16_t)value;
+    INSEN_DECODE_STEP(insen_read_field(&cursor, '|', 10, UINT8_MAX, &value));
+    state->dpad = (uint8_t)value;
+    INSEN_DECODE_STEP(insen_read_unsigned(&cursor, '|', 10, UINT8_MAX, &value));
+    state->battery_level = (uint8_t)value;
+
+    state->timestamp = 0;
+    if (cursor.pos != cursor.end) {
+        INSEN_DECODE_STEP(insen_read_unsigned(&cursor, '|', 10, UINT32_MAX, &state->timestamp));
+    }
+
+#undef INSEN_DECODE_STEP
+
+    return INSEN_DECODE_OK;
+}
+
+// Next '|'-separated field of a STATUS/LIST/INFO reply. Empty fields are
+// skipped. Returns 0 when none is left.
+static inline int insen_next_field(insen_cursor_t* cursor, const char** field, size_t* length) {
+    while (cursor->pos < cursor->end && *cursor->pos == '|') {
+        cursor->pos++;
+    }
+    if (cursor->pos == cursor->end) {
+        return 0;
+    }
+
+    const char* bar = (const char*)memchr(cursor->pos, '|', (size_t)(cursor->end - cursor->pos));
+    *field = cursor->pos;
+    *length = (size_t)((bar ? bar : cursor->end) - cursor->pos);
+    cursor->pos += *length;
+    return 1;
+}
+
+static inline int insen_field_is(const char* field, size_t length, const char* text, size_t text_len) {
+    return length == text_len && memcmp(field, text, text_len) == 0;
+}
+
+// "PREFIXnumber" field: the number after prefix, which must fill the rest
+static inline int insen_field_number(const char* field, size_t length, const char* prefix, size_t prefix_len,
+                                     uint32_t* value) {
+    if (!insen_has_prefix(field, length, prefix, prefix_len)) {
+        return 0;
+    }
+    insen_cursor_t cursor = {field + prefix_len, field + length};
+    return insen_read_unsigned(&cursor, '|', 10, UINT32_MAX, value) == INSEN_DECODE_OK;
+}
+
+// Copy a field into a fixed-size string member, always NUL-terminated
+static inline void insen_copy_text(char* dest, size_t dest_len, const char* field, size_t length) {
+    size_t copy_len = length < dest_len - 1 ? length : dest_len - 1;
+    memcpy(dest, field, copy_len);
+    dest[copy_len] = '\0';
+}
+
+// Decode a STATUS reply; unknown fields are ignored
+static inline insen_decode_result_t insen_decode_status(const char* line, size_t length,
+                                                        insen_system_status_t* status) {
+    if (!insen_skip_tag(&line, &length, "STATUS|", 7)) {
+        return INSEN_DECODE_UNEXPECTED;
+    }
+
+    memset(status, 0, sizeof(*status));
+    insen_cursor_t cursor = {line, line + length};
+    const char* field;
+    size_t field_len;
+    uint32_t value;
+    while (insen_next_field(&cursor, &field, &field_len)) {
+        if (insen_field_number(field, field_len, "ACTIVE_", 7, &value)) {
+            status->active_controllers = (int)value;
+        } else if (insen_field_number(field, field_len, "TOTAL_INPUTS_", 13, &value)) {
+            status->total_inputs = value;
+        } else if (insen_field_number(field, field_len, "API_COMMANDS_", 13, &value)) {
+            status->api_commands = value;
+        } else if (insen_field_number(field, field_len, "FREE_HEAP_", 10, &value)) {
+            status->free_heap = value;
+        }
+    }
+    return INSEN_DECODE_OK;
+}
+
+// Decode a LIST reply into at most max_controllers entries. Fields that do
+// not start with an id are skipped.
+static inline insen_decode_result_t insen_decode_list(const char* line, size_t length,
+                                                      insen_controller_info_t* controllers, int max_controllers,
+                                                      int* count) {
+    if (!insen_skip_tag(&line, &length, "CONTROLLERS", 11)) {
+        return INSEN_DECODE_UNEXPECTED;
+    }
+
+    *count = 0;
+    insen_cursor_t cursor = {line, line + length};
+    const char* field;
+    size_t field_len;
+    while (*count < max_controllers && insen_next_field(&cursor, &field, &field_len)) {
+        // ID_TYPE
+        insen_cursor_t id_cursor = {field, field + field_len};
+        uint32_t id;
+        if (insen_read_unsigned(&id_cursor, '_', 10, INT32_MAX, &id) != INSEN_DECODE_OK) {
+            continue;
+        }
+
+        insen_controller_info_t* controller = &controllers[(*count)++];
+        controller->id = (int)id;
+        insen_copy_text(controller->type, sizeof(controller->type), id_cursor.pos,
+                        (size_t)(id_cursor.end - id_cursor.pos));
+        controller->connected = 1;
+    }
+    return INSEN_DECODE_OK;
+}
+
+// Decode an INFO reply; unknown fields are ignored
+static inline insen_decode_result_t insen_decode_info(const char* line, size_t length,
+                                                      insen_firmware_info_t* info) {
+    insen_skip_prompt(&line, &length);
+    if (!insen_has_prefix(line, length, "INSEN_FW", 8)) {
+        return INSEN_DECODE_UNEXPECTED;
+    }
+
+    memset(info, 0, sizeof(*info));
+    insen_cursor_t cursor = {line, line + length};
+    const char* field;
+    size_t field_len;
+    while (insen_next_field(&cursor, &field, &field_len)) {
+        if (insen_has_prefix(field, field_len, "INSEN_FW_V", 10)) {
+            insen_copy_text(info->version, sizeof(info->version), field + 10, field_len - 10);
+        } else if (insen_has_prefix(field, field_len, "BUILD_", 6)) {
+            insen_copy_text(info->build_date, sizeof(info->build_date), field + 6, field_len - 6);
+            for (char* c = info->build_date; *c; c++) {
+                if (*c == '_') {
+                    *c = ' ';
+                }
+            }
+        } else if (insen_field_is(field, field_len, "MAKCU_COMPATIBLE", 16)) {
+            info->makcu_compatible = 1;
+        } else if (insen_field_is(field, field_len, "STATUS_OK", 9)) {
+            info->status_ok = 1;
+        } else if (insen_field_is(field, field_len, INSEN_WIRE_CAPABILITY, sizeof(INSEN_WIRE_CAPABILITY) - 1)) {
+            info->binary_supported = 1;
+        }
+    }
+    return INSEN_DECODE_OK;
+}
+
+// Leading decimal id after optional spaces, or -1 if there is none
+static inline int insen_leading_id(const char* text, size_t length) {
+    size_t i = 0;
+    int id = 0;
+    while (i < length && text[i] == ' ') {
+        i++;
+    }
+    if (i == length || text[i] < '0' || text[i] > '9') {
+        return -1;
+    }
+    for (; i < length && text[i] >= '0' && text[i] <= '9' && id < 100000; i++) {
+        id = id * 10 + (text[i] - '0');
+    }
+    return id;
+}
+
+// Kind of request a command is, and the controller id of a GET (-1 otherwise)
+static inline insen_command_t insen_classify_command(const char* command, size_t length, int* controller_id) {
+    *controller_id = -1;
+
+    if (insen_has_prefix(command, length, "GET", 3)) {
+        *controller_id = insen_leading_id(command + 3, length - 3);
+        return INSEN_COMMAND_GET;
+    }
+    if (insen_field_is(command, length, "INFO", 4)) {
+        return INSEN_COMMAND_INFO;
+    }
+    if (insen_field_is(command, length, "STATUS", 6)) {
+        return INSEN_COMMAND_STATUS;
+    }
+    if (insen_field_is(command, length, "LIST", 4)) {
+        return INSEN_COMMAND_LIST;
+    }
+    if (insen_field_is(command, length, "VERSION", 7)) {
+        return INSEN_COMMAND_VERSION;
+    }
+    if (insen_field_is(command, length, "HELP", 4)) {
+        return INSEN_COMMAND_HELP;
+    }
+    return INSEN_COMMAND_OTHER;
+}
+
+// Kind of request a reply (or binary frame) answers, and the controller id
+// of a sample. Errors and acknowledgements are INSEN_COMMAND_OTHER.
+static inline insen_command_t insen_classify_reply(const char* line, size_t length, int* controller_id) {
+    *controller_id = -1;
+
+    if (length > 0 && line[0] == '\0') {
+        *controller_id = insen_wire_peek_id((const uint8_t*)line + 1, length - 1);
+        return INSEN_COMMAND_GET;
+    }
+    insen_skip_prompt(&line, &length);
+
+    if (insen_has_prefix(line, length, "INPUT|", 6)) {
+        *controller_id = insen_leading_id(line + 6, length - 6);
+        return INSEN_COMMAND_GET;
+    }
+    if (insen_has_prefix(line, length, "STATUS|", 7)) {
+        return INSEN_COMMAND_STATUS;
+    }
+    if (insen_has_prefix(line, length, "CONTROLLERS", 11)) {
+        return INSEN_COMMAND_LIST;
+    }
+    if (insen_has_prefix(line, length, "INSEN_FW", 8)) {
+        return INSEN_COMMAND_INFO;
+    }
+    if (insen_has_prefix(line, length, "VERSION|", 8)) {
+        return INSEN_COMMAND_VERSION;
+    }
+    if (insen_has_prefix(line, length, "COMMANDS|", 9)) {
+        return INSEN_COMMAND_HELP;
+    }
+    return INSEN_COMMAND_OTHER;
+}
+
+// Encode command + "\r\n" into out. Returns the bytes written, or 0 if it
+// does not fit.
+static inline size_t insen_encode_command(char* out, size_t capacity, const char* command, size_t length) {
+    if (length + 2 > capacity) {
+        return 0;
+    }
+    memcpy(out, command, length);
+    out[length] = '\r';
+    out[length + 1] = '\n';
+    return length + 2;
+}
+
+// Encode "GET id\r\n" into out without printf. Returns the bytes written,
+// or 0 if it does not fit or id is negative.
+static inline size_t insen_encode_get(char* out, size_t capacity, int controller_id) {
+    char digits[10];
+    size_t count = 0;
+    unsigned id = (unsigned)controller_id;
+
+    if (controller_id < 0) {
+        return 0;
+    }
+    do {
+        digits[count++] = (char)('0' + id % 10);
+        id /= 10;
+    } while (id > 0);
+
+    if (4 + count + 2 > capacity) {
+        return 0;
+    }
+    memcpy(out, "GET ", 4);
+    for (size_t i = 0; i < count; i++) {
+        out[4 + i] = digits[count - 1 - i];
+    }
+    out[4 + count] = '\r';
+    out[5 + count] = '\n';
+    return 6 + count;
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // INSEN_PROTOCOL_H
@@ -0,0 +1,46 @@
+// INSEN Controller Sample
+// madebybunnyrce
+// Packed per-sample controller state shared by the C and C++ clients
+
+#ifndef INSEN_SAMPLE_H // madebybunnyrce
+#define INSEN_SAMPLE_H
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// One controller sample, 20 bytes with no padding holes beyond one byte.
+// Used for GET results, long histories and recordings on both sides.
+typedef struct {
+    // Analog inputs (normalized -32768 to 32767)
+    int16_t left_stick_x;
+    int16_t left_stick_y;
+    int16_t right_stick_x;
+    int16_t right_stick_y;
+    
+    // Triggers (0-255)
+    uint8_t left_trigger;
+    uint8_t right_trigger;
+    
+    // Digital inputs
+    uint16_t buttons;        // Bitmask of pressed buttons
+    uint8_t dpad;           // D-pad state
+    
+    // Metadata
+    uint8_t controller_id;   // Controller ID (0-3)
+    uint8_t battery_level;   // Battery level (0-100%)
+    uint32_t timestamp;      // Timestamp from firmware
+} insen_controller_state_t;
+
+#define INSEN_SAMPLE_SIZE 20
+
+// Compile-time layout check (C99-compatible)
+typedef char insen_sample_size_check[(sizeof(insen_controller_state_t) == INSEN_SAMPLE_SIZE) ? 1 : -1];
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // INSEN_SAMPLE_H
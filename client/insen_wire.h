@@ -0,0 +1,222 @@
+// INSEN Binary Wire Format
+// madebybunnyrce
+// Compact framing for GET replies and pushed samples, shared by the C and
+// C++ clients and the device emulator
+
+#ifndef INSEN_WIRE_H // madebybunnyrce
+#define INSEN_WIRE_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "insen_sample.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Negotiation. Firmware that supports binary samples lists the capability
+// in its INFO reply; the host then sends the enable command and switches
+// only once the firmware acknowledges it. Anything else (old firmware
+// answers ERROR|UNKNOWN_COMMAND) keeps the text protocol.
+#define INSEN_WIRE_CAPABILITY    "BINARY_V1"
+#define INSEN_WIRE_ENABLE        "BINARY 1"
+#define INSEN_WIRE_ENABLE_ACK    "BINARY|1"
+#define INSEN_WIRE_DISABLE       "BINARY 0"
+#define INSEN_WIRE_DISABLE_ACK   "BINARY|0"
+
+// Once enabled, INPUT replies and pushes are sent as frames:
+//   0x00, COBS(payload + CRC-16), 0x00
+// The leading zero tells a frame from a text line (which never starts
+// with one) and resynchronizes after noise; COBS keeps zeros out of the
+// body. Other commands keep answering with text lines.
+//
+// Payload, 18 bytes, multi-byte fields little-endian:
+//   0      controller id (low nibble) | dpad << 4
+//   1-8    left x, left y, right x, right y (int16)
+//   9-10   left trigger, right trigger
+//   11-12  buttons
+//   13     battery level, bit 7 set if the controller is disconnected
+//   14-17  firmware timestamp
+// followed by CRC-16/CCITT-FALSE of the payload.
+#define INSEN_WIRE_PAYLOAD_SIZE  18
+#define INSEN_WIRE_BODY_SIZE     (INSEN_WIRE_PAYLOAD_SIZE + 2 + 1)  // CRC, COBS overhead
+#define INSEN_WIRE_FRAME_SIZE    (INSEN_WIRE_BODY_SIZE + 2)         // Delimiters
+
+#define INSEN_WIRE_DISCONNECTED_FLAG 0x80
+
+// insen_wire_decode() results
+#define INSEN_WIRE_OK            0
+#define INSEN_WIRE_DISCONNECTED  1      // Only controller_id is set
+#define INSEN_WIRE_CORRUPT       (-1)   // Wrong size, bad COBS or CRC mismatch
+
+// CRC-16/CCITT-FALSE (polynomial 0x1021, initial value 0xFFFF), one table
+// lookup per byte
+static const uint16_t insen_wire_crc_table[256] = {
+    0x0000, 0x1021, 0x2042, 0x3063, 0x4084, 0x50A5, 0x60C6, 0x70E7,
+    0x8108, 0x9129, 0xA14A, 0xB16B, 0xC18C, 0xD1AD, 0xE1CE, 0xF1EF,
+    0x1231, 0x0210, 0x3273, 0x2252, 0x52B5, 0x4294, 0x72F7, 0x62D6,
+    0x9339, 0x8318, 0xB37B, 0xA35A, 0xD3BD, 0xC39C, 0xF3FF, 0xE3DE,
+    0x2462, 0x3443, 0x0420, 0x1401, 0x64E6, 0x74C7, 0x44A4, 0x5485,
+    0xA56A, 0xB54B, 0x8528, 0x9509, 0xE5EE, 0xF5CF, 0xC5AC, 0xD58D,
+    0x3653, 0x2672, 0x1611, 0x0630, 0x76D7, 0x66F6, 0x5695, 0x46B4,
+    0xB75B, 0xA77A, 0x9719, 0x8738, 0xF7DF, 0xE7FE, 0xD79D, 0xC7BC,
+    0x48C4, 0x58E5, 0x6886, 0x78A7, 0x0840, 0x1861, 0x2802, 0x3823,
+    0xC9CC, 0xD9ED, 0xE98E, 0xF9AF, 0x8948, 0x9969, 0xA90A, 0xB92B,
+    0x5AF5, 0x4AD4, 0x7AB7, 0x6A96, 0x1A71, 0x0A50, 0x3A33, 0x2A12,
+    0xDBFD, 0xCBDC, 0xFBBF, 0xEB9E, 0x9B79, 0x8B58, 0xBB3B, 0xAB1A,
+    0x6CA6, 0x7C87, 0x4CE4, 0x5CC5, 0x2C22, 0x3C03, 0x0C60, 0x1C41,
+    0xEDAE, 0xFD8F, 0xCDEC, 0xDDCD, 0xAD2A, 0xBD0B, 0x8D68, 0x9D49,
+    0x7E97, 0x6EB6, 0x5ED5, 0x4EF4, 0x3E13, 0x2E32, 0x1E51, 0x0E70,
+    0xFF9F, 0xEFBE, 0xDFDD, 0xCFFC, 0xBF1B, 0xAF3A, 0x9F59, 0x8F78,
+    0x9188, 0x81A9, 0xB1CA, 0xA1EB, 0xD10C, 0xC12D, 0xF14E, 0xE16F,
+    0x1080, 0x00A1, 0x30C2, 0x20E3, 0x5004, 0x4025, 0x7046, 0x6067,
+    0x83B9, 0x9398, 0xA3FB, 0xB3DA, 0xC33D, 0xD31C, 0xE37F, 0xF35E,
+    0x02B1, 0x1290, 0x22F3, 0x32D2, 0x4235, 0x5214, 0x6277, 0x7256,
+    0xB5EA, 0xA5CB, 0x95A8, 0x8589, 0xF56E, 0xE54F, 0xD52C, 0xC50D,
+    0x34E2, 0x24C3, 0x14A0, 0x0481, 0x7466, 0x6447, 0x5424, 0x4405,
+    0xA7DB, 0xB7FA, 0x8799, 0x97B8, 0xE75F, 0xF77E, 0xC71D, 0xD73C,
+    0x26D3, 0x36F2, 0x0691, 0x16B0, 0x6657, 0x7676, 0x4615, 0x5634,
+    0xD94C, 0xC96D, 0xF90E, 0xE92F, 0x99C8, 0x89E9, 0xB98A, 0xA9AB,
+    0x5844, 0x4865, 0x7806, 0x6827, 0x18C0, 0x08E1, 0x3882, 0x28A3,
+    0xCB7D, 0xDB5C, 0xEB3F, 0xFB1E, 0x8BF9, 0x9BD8, 0xABBB, 0xBB9A,
+    0x4A75, 0x5A54, 0x6A37, 0x7A16, 0x0AF1, 0x1AD0, 0x2AB3, 0x3A92,
+    0xFD2E, 0xED0F, 0xDD6C, 0xCD4D, 0xBDAA, 0xAD8B, 0x9DE8, 0x8DC9,
+    0x7C26, 0x6C07, 0x5C64, 0x4C45, 0x3CA2, 0x2C83, 0x1CE0, 0x0CC1,
+    0xEF1F, 0xFF3E, 0xCF5D, 0xDF7C, 0xAF9B, 0xBFBA, 0x8FD9, 0x9FF8,
+    0x6E17, 0x7E36, 0x4E55, 0x5E74, 0x2E93, 0x3EB2, 0x0ED1, 0x1EF0,
+};
+
+static inline uint16_t insen_wire_crc16(const uint8_t* data, size_t length) {
+    uint16_t crc = 0xFFFF;
+    for (size_t i = 0; i < length; i++) {
+        crc = (uint16_t)((crc << 8) ^ insen_wire_crc_table[(crc >> 8) ^ data[i]]);
+    }
+    return crc;
+}
+
+// Encode length bytes (at most 254) into dst, which needs length + 1 bytes.
+// Returns the encoded length.
+static inline size_t insen_cobs_encode(const uint8_t* src, size_t length, uint8_t* dst) {
+    size_t code_at = 0;
+    size_t out = 1;
+    uint8_t code = 1;
+
+    for (size_t i = 0; i < length; i++) {
+        if (src[i] == 0) {
+            dst[code_at] = code;
+            code_at = out++;
+            code = 1;
+        } else {
+            dst[out++] = src[i];
+            code++;
+        }
+    }
+    dst[code_at] = code;
+    return out;
+}
+
+// Decode a COBS body (no delimiters) into dst. Returns the decoded length,
+// or 0 if the body is malformed or does not fit.
+static inline size_t insen_cobs_decode(const uint8_t* src, size_t length, uint8_t* dst, size_t capacity) {
+    size_t in = 0;
+    size_t out = 0;
+
+    while (in < length) {
+        uint8_t code = src[in++];
+        if (code == 0 || in + code - 1 > length) {
+            return 0;
+        }
+        for (uint8_t i = 1; i < code; i++) {
+            if (out == capacity || src[in] == 0) {
+                return 0;
+            }
+            dst[out++] = src[in++];
+        }
+        // A zero follows every group except a full one or the last
+        if (code != 0xFF && in < length) {
+            if (out == capacity) {
+                return 0;
+            }
+            dst[out++] = 0;
+        }
+    }
+    return out;
+}
+
+// Write a complete frame, delimiters included, into frame
+// (INSEN_WIRE_FRAME_SIZE bytes). Returns INSEN_WIRE_FRAME_SIZE.
+static inline size_t insen_wire_encode(const insen_controller_state_t* state, int connected, uint8_t* frame) {
+    uint8_t raw[INSEN_WIRE_PAYLOAD_SIZE + 2];
+    const int16_t sticks[4] = {state->left_stick_x, state->left_stick_y, state->right_stick_x, state->right_stick_y};
+
+    raw[0] = (uint8_t)((state->controller_id & 0x0F) | (state->dpad << 4));
+    for (int i = 0; i < 4; i++) {
+        raw[1 + i * 2] = (uint8_t)((uint16_t)sticks[i] & 0xFF);
+        raw[2 + i * 2] = (uint8_t)((uint16_t)sticks[i] >> 8);
+    }
+    raw[9] = state->left_trigger;
+    raw[10] = state->right_trigger;
+    raw[11] = (uint8_t)(state->buttons & 0xFF);
+    raw[12] = (uint8_t)(state->buttons >> 8);
+    raw[13] = (uint8_t)((state->battery_level & 0x7F) | (connected ? 0 : INSEN_WIRE_DISCONNECTED_FLAG));
+    for (int i = 0; i < 4; i++) {
+        raw[14 + i] = (uint8_t)(state->timestamp >> (8 * i));
+    }
+
+    uint16_t crc = insen_wire_crc16(raw, INSEN_WIRE_PAYLOAD_SIZE);
+    raw[INSEN_WIRE_PAYLOAD_SIZE] = (uint8_t)(crc & 0xFF);
+    raw[INSEN_WIRE_PAYLOAD_SIZE + 1] = (uint8_t)(crc >> 8);
+
+    frame[0] = 0;
+    insen_cobs_encode(raw, sizeof(raw), frame + 1);
+    frame[INSEN_WIRE_FRAME_SIZE - 1] = 0;
+    return INSEN_WIRE_FRAME_SIZE;
+}
+
+// Controller id of a frame body without checking it, for matching a reply
+// to its request before decoding
+static inline int insen_wire_peek_id(const uint8_t* body, size_t length) {
+    if (length < 2) {
+        return -1;
+    }
+    return body[0] == 1 ? 0 : body[1] & 0x0F;  // A code of 1 means the first byte was zero
+}
+
+// Decode the body of one frame (the bytes between its delimiters)
+static inline int insen_wire_decode(const uint8_t* body, size_t length, insen_controller_state_t* state) {
+    uint8_t raw[INSEN_WIRE_PAYLOAD_SIZE + 2];
+
+    if (length != INSEN_WIRE_BODY_SIZE ||
+        insen_cobs_decode(body, length, raw, sizeof(raw)) != sizeof(raw)) {
+        return INSEN_WIRE_CORRUPT;
+    }
+    uint16_t crc = (uint16_t)(raw[INSEN_WIRE_PAYLOAD_SIZE] | (raw[INSEN_WIRE_PAYLOAD_SIZE + 1] << 8));
+    if (crc != insen_wire_crc16(raw, INSEN_WIRE_PAYLOAD_SIZE)) {
+        return INSEN_WIRE_CORRUPT;
+    }
+
+    state->controller_id = raw[0] & 0x0F;
+    if (raw[13] & INSEN_WIRE_DISCONNECTED_FLAG) {
+        return INSEN_WIRE_DISCONNECTED;
+    }
+
+    state->dpad = raw[0] >> 4;
+    state->left_stick_x = (int16_t)(uint16_t)(raw[1] | (raw[2] << 8));
+    state->left_stick_y = (int16_t)(uint16_t)(raw[3] | (raw[4] << 8));
+    state->right_stick_x = (int16_t)(uint16_t)(raw[5] | (raw[6] << 8));
+    state->right_stick_y = (int16_t)(uint16_t)(raw[7] | (raw[8] << 8));
+    state->left_trigger = raw[9];
+    state->right_trigger = raw[10];
+    state->buttons = (uint16_t)(raw[11] | (raw[12] << 8));
+    state->battery_level = raw[13];
+    state->timestamp = (uint32_t)raw[14] | ((uint32_t)raw[15] << 8) |
+                       ((uint32_t)raw[16] << 16) | ((uint32_t)raw[17] << 24);
+    return INSEN_WIRE_OK;
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // INSEN_WIRE_H
@@ -0,0 +1,118 @@
+/*
+ * INSEN Controller Client - Command arbitration
+ * //madebybunnyrce
+ * Serializes command/response exchanges on one serial link between
+ * threads. Input polling (GET) uses the Input lane and always goes ahead
+ * of waiting Admin commands (STATUS, INFO, LIST, ...), so an admin command
+ * can delay a GET by at most the one exchange already on the wire.
+ */
+
+#ifndef INSEN_ARBITER_HPP
+#define INSEN_ARBITER_HPP
+
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+
+namespace insen {
+
+enum class CommandLane {
+    Input,      // GET polling; latency-critical
+    Admin       // Everything else
+};
+
+struct LaneStats {
+    uint64_t acquisitions = 0;
+    uint64_t total_wait_ns = 0;     // Time spent waiting for the link
+    uint64_t max_wait_ns = 0;
+
+    double meanWaitNs() const {
+        return acquisitions ? static_cast<double>(total_wait_ns) / static_cast<double>(acquisitions) : 0.0;
+    }
+};
+
+class CommandArbiter {
+private:
+    mutable std::mutex mutex;
+    std::condition_variable released;
+    bool busy;
+    size_t input_waiting;
+    LaneStats stats[2];
+
+    void record(CommandLane lane, std::chrono::steady_clock::time_point started) {
+        auto waited = static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now() - started).count());
+        LaneStats& lane_stats = stats[static_cast<size_t>(lane)];
+        lane_stats.acquisitions++;
+        lane_stats.total_wait_ns += waited;
+        if (waited > lane_stats.max_wait_ns) {
+            lane_stats.max_wait_ns = waited;
+        }
+    }
+
+public:
+    CommandArbiter() : busy(false), input_waiting(0) {}
+
+    CommandArbiter(const CommandArbiter&) = delete;
+    CommandArbiter& operator=(const CommandArbiter&) = delete;
+
+    // Block until the link is free. Admin waits while any Input waiter is
+    // queued; Input only waits for the exchange in progress.
+    void acquire(CommandLane lane) {
+        auto started = std::chrono::steady_clock::now();
+        std::unique_lock<std::mutex> lock(mutex);
+
+        if (lane == CommandLane::Input) {
+            input_waiting++;
+            released.wait(lock, [this]() { return !busy; });
+            input_waiting--;
+        } else {
+            released.wait(lock, [this]() { return !busy && input_waiting == 0; });
+        }
+
+        busy = true;
+        record(lane, started);
+    }
+
+    void release() {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            busy = false;
+        }
+        released.notify_all();
+    }
+
+    LaneStats laneStats(CommandLane lane) const {
+        std::lock_guard<std::mutex> lock(mutex);
+        return stats[static_cast<size_t>(lane)];
+    }
+
+    void resetStats() {
+        std::lock_guard<std::mutex> lock(mutex);
+        stats[0] = stats[1] = LaneStats();
+    }
+
+    // Holds the link for one scope
+    class Guard {
+    private:
+        CommandArbiter& arbiter;
+
+    public:
+        Guard(CommandArbiter& owner, CommandLane lane) : arbiter(owner) {
+            arbiter.acquire(lane);
+        }
+
+        ~Guard() {
+            arbiter.release();
+        }
+
+        Guard(const Guard&) = delete;
+        Guard& operator=(const Guard&) = delete;
+    };
+};
+
+} // namespace insen
+
+#endif // INSEN_ARBITER_HPP
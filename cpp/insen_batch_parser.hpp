@@ -0,0 +1,697 @@
+/*
+ * INSEN Controller Client - Batch INPUT parser
+ * //madebybunnyrce
+ * Parses large buffers of captured ">>> INPUT|..." lines into columnar
+ * arrays. Stage one finds every '|', ',' and '\n' with SIMD compares
+ * (AVX2 or SSE4.2, picked at runtime, scalar elsewhere). Stage two
+ * right-aligns the decimal fields of a line in 64-bit lanes and converts
+ * four (AVX2), two (SSE4.2) or one (scalar SWAR) of them per step. Lines
+ * that do not have the common shape go to parseInputLine, i.e. the shared
+ * protocol core, so results always match it.
+ */
+
+#ifndef INSEN_BATCH_PARSER_HPP
+#define INSEN_BATCH_PARSER_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <string_view>
+#include <vector>
+
+#include "insen_parser.hpp"
+#include "insen_state.hpp"
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define INSEN_BATCH_X86 1
+#include <immintrin.h>
+#endif
+
+namespace insen {
+
+// Column-per-field storage for parsed samples
+struct InputColumns {
+    std::vector<uint8_t> id;
+    std::vector<int16_t> left_stick_x, left_stick_y;
+    std::vector<int16_t> right_stick_x, right_stick_y;
+    std::vector<uint8_t> left_trigger, right_trigger;
+    std::vector<uint16_t> buttons;
+    std::vector<uint8_t> dpad;
+    std::vector<uint8_t> battery;
+    std::vector<uint32_t> device_time;
+
+    size_t size() const {
+        return id.size();
+    }
+
+    void reserve(size_t count) {
+        id.reserve(count);
+        left_stick_x.reserve(count);
+        left_stick_y.reserve(count);
+        right_stick_x.reserve(count);
+        right_stick_y.reserve(count);
+        left_trigger.reserve(count);
+        right_trigger.reserve(count);
+        buttons.reserve(count);
+        dpad.reserve(count);
+        battery.reserve(count);
+        device_time.reserve(count);
+    }
+
+    void clear() {
+        id.clear();
+        left_stick_x.clear();
+        left_stick_y.clear();
+        right_stick_x.clear();
+        right_stick_y.clear();
+        left_trigger.clear();
+        right_trigger.clear();
+        buttons.clear();
+        dpad.clear();
+        battery.clear();
+        device_time.clear();
+    }
+
+    void resize(size_t count) {
+        id.resize(count);
+        left_stick_x.resize(count);
+        left_stick_y.resize(count);
+        right_stick_x.resize(count);
+        right_stick_y.resize(count);
+        left_trigger.resize(count);
+        right_trigger.resize(count);
+        buttons.resize(count);
+        dpad.resize(count);
+        battery.resize(count);
+        device_time.resize(count);
+    }
+
+    void push_back(const ControllerState& state) {
+        id.push_back(state.id);
+        left_stick_x.push_back(state.left_stick_x);
+        left_stick_y.push_back(state.left_stick_y);
+        right_stick_x.push_back(state.right_stick_x);
+        right_stick_y.push_back(state.right_stick_y);
+        left_trigger.push_back(state.left_trigger);
+        right_trigger.push_back(state.right_trigger);
+        buttons.push_back(state.buttons);
+        dpad.push_back(state.dpad);
+        battery.push_back(state.battery);
+        device_time.push_back(state.device_time);
+    }
+
+    // Overwrite row i
+    void assign(size_t i, const ControllerState& state) {
+        id[i] = state.id;
+        left_stick_x[i] = state.left_stick_x;
+        left_stick_y[i] = state.left_stick_y;
+        right_stick_x[i] = state.right_stick_x;
+        right_stick_y[i] = state.right_stick_y;
+        left_trigger[i] = state.left_trigger;
+        right_trigger[i] = state.right_trigger;
+        buttons[i] = state.buttons;
+        dpad[i] = state.dpad;
+        battery[i] = state.battery;
+        device_time[i] = state.device_time;
+    }
+
+    // Reassemble row i (host timestamps are left default)
+    ControllerState state(size_t i) const {
+        ControllerState state{};
+        state.id = id[i];
+        state.left_stick_x = left_stick_x[i];
+        state.left_stick_y = left_stick_y[i];
+        state.right_stick_x = right_stick_x[i];
+        state.right_stick_y = right_stick_y[i];
+        state.left_trigger = left_trigger[i];
+        state.right_trigger = right_trigger[i];
+        state.buttons = buttons[i];
+        state.dpad = dpad[i];
+        state.battery = battery[i];
+        state.device_time = device_time[i];
+        return state;
+    }
+};
+
+struct BatchParseStats {
+    size_t lines;       // Non-empty lines seen
+    size_t parsed;      // Lines appended to the columns
+    size_t rejected;    // Lines parseInputLine would reject
+};
+
+enum class BatchKernel {
+    Scalar,
+    Sse42,
+    Avx2
+};
+
+inline const char* batchKernelName(BatchKernel kernel) {
+    switch (kernel) {
+        case BatchKernel::Sse42:
+            return "sse4.2";
+        case BatchKernel::Avx2:
+            return "avx2";
+        default:
+            return "scalar";
+    }
+}
+
+namespace detail {
+
+// High bit set in every byte of word equal to the byte repeated in pattern
+inline uint64_t matchBytes(uint64_t word, uint64_t pattern) {
+    uint64_t diff = word ^ pattern;
+    return ~(((diff & 0x7F7F7F7F7F7F7F7FULL) + 0x7F7F7F7F7F7F7F7FULL) | diff) & 0x8080808080808080ULL;
+}
+
+// Byte at a time, for what the wide loops leave over
+inline size_t scanDelimitersTail(const char* data, size_t from, size_t length, uint32_t* out, size_t count,
+                                 uint32_t* line_ends, size_t& lines) {
+    for (size_t i = from; i < length; i++) {
+        char c = data[i];
+        if (c == '|' || c == ',' || c == '\n') {
+            line_ends[lines] = static_cast<uint32_t>(count);
+            lines += c == '\n';
+            out[count++] = static_cast<uint32_t>(i);
+        }
+    }
+    return count;
+}
+
+// Stage one: record the offset of every '|', ',' and '\n' in [0, length)
+// in out, and for the n-th '\n' its index in out in line_ends[n]. Returns
+// the number of delimiters; lines receives the number of '\n'. Without
+// SIMD, eight bytes are compared at a time in a 64-bit word.
+inline size_t scanDelimitersScalar(const char* data, size_t length, uint32_t* out, uint32_t* line_ends,
+                                   size_t& lines) {
+    size_t count = 0;
+    size_t i = 0;
+    lines = 0;
+
+    for (; i + 8 <= length; i += 8) {
+        uint64_t word;
+        std::memcpy(&word, data + i, sizeof(word));
+        uint64_t newlines = matchBytes(word, 0x0A0A0A0A0A0A0A0AULL);
+        uint64_t mask = matchBytes(word, 0x7C7C7C7C7C7C7C7CULL) |   // '|'
+                        matchBytes(word, 0x2C2C2C2C2C2C2C2CULL) |   // ','
+                        newlines;
+
+        while (mask) {
+            unsigned bit = static_cast<unsigned>(__builtin_ctzll(mask));
+            line_ends[lines] = static_cast<uint32_t>(count);
+            lines += (newlines >> bit) & 1;
+            out[count++] = static_cast<uint32_t>(i + bit / 8);
+            mask &= mask - 1;
+        }
+    }
+
+    return scanDelimitersTail(data, i, length, out, count, line_ends, lines);
+}
+
+#ifdef INSEN_BATCH_X86
+
+inline void emitDelimiters(size_t base, uint32_t mask, uint32_t newlines, uint32_t* out, size_t& count,
+                           uint32_t* line_ends, size_t& lines) {
+    while (mask) {
+        unsigned bit = static_cast<unsigned>(__builtin_ctz(mask));
+        line_ends[lines] = static_cast<uint32_t>(count);
+        lines += (newlines >> bit) & 1;
+        out[count++] = static_cast<uint32_t>(base + bit);
+        mask &= mask - 1;
+    }
+}
+
+__attribute__((target("sse4.2")))
+inline size_t scanDelimitersSse42(const char* data, size_t length, uint32_t* out, uint32_t* line_ends,
+                                  size_t& lines) {
+    const __m128i pipe = _mm_set1_epi8('|');
+    const __m128i comma = _mm_set1_epi8(',');
+    const __m128i newline = _mm_set1_epi8('\n');
+    size_t count = 0;
+    size_t i = 0;
+    lines = 0;
+
+    for (; i + 16 <= length; i += 16) {
+        __m128i block = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + i));
+        __m128i breaks = _mm_cmpeq_epi8(block, newline);
+        __m128i hits = _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(block, pipe), _mm_cmpeq_epi8(block, comma)),
+                                    breaks);
+        emitDelimiters(i, static_cast<uint32_t>(_mm_movemask_epi8(hits)),
+                       static_cast<uint32_t>(_mm_movemask_epi8(breaks)), out, count, line_ends, lines);
+    }
+
+    return scanDelimitersTail(data, i, length, out, count, line_ends, lines);
+}
+
+__attribute__((target("avx2")))
+inline size_t scanDelimitersAvx2(const char* data, size_t length, uint32_t* out, uint32_t* line_ends,
+                                 size_t& lines) {
+    const __m256i pipe = _mm256_set1_epi8('|');
+    const __m256i comma = _mm256_set1_epi8(',');
+    const __m256i newline = _mm256_set1_epi8('\n');
+    size_t count = 0;
+    size_t i = 0;
+    lines = 0;
+
+    for (; i + 32 <= length; i += 32) {
+        __m256i block = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data + i));
+        __m256i breaks = _mm256_cmpeq_epi8(block, newline);
+        __m256i hits = _mm256_or_si256(
+            _mm256_or_si256(_mm256_cmpeq_epi8(block, pipe), _mm256_cmpeq_epi8(block, comma)), breaks);
+        emitDelimiters(i, static_cast<uint32_t>(_mm256_movemask_epi8(hits)),
+                       static_cast<uint32_t>(_mm256_movemask_epi8(breaks)), out, count, line_ends, lines);
+    }
+
+    return scanDelimitersTail(data, i, length, out, count, line_ends, lines);
+}
+
+#endif // INSEN_BATCH_X86
+
+// Stage two works on lines of the common shape
+//   >>> INPUT|id|lx,ly|rx,ry|lt,rt|buttons|dpad|battery[|timestamp]
+// Every decimal field is a slot: the eight bytes ending at the field are
+// read as one 64-bit lane, the bytes in front of the field are replaced by
+// '0', and the digits are combined in pairs, quads and octets. The first
+// eight slots lie between consecutive delimiters of the line; the last four
+// (battery, the low eight and high two timestamp digits, and padding so the
+// slots split evenly into lanes) are passed explicitly.
+enum FieldSlot {
+    SlotId,
+    SlotLeftX,
+    SlotLeftY,
+    SlotRightX,
+    SlotRightY,
+    SlotLeftTrigger,
+    SlotRightTrigger,
+    SlotDpad,
+    SlotBattery,
+    SlotTimeLow,
+    SlotTimeHigh,
+    SlotPad
+};
+
+constexpr size_t field_slots = 12;
+
+// Delimiters (indices into the line's offsets) that close and open the
+// first eight slots; buttons, between delimiters 7 and 8, are hex
+constexpr uint8_t slot_close[8] = {1, 2, 3, 4, 5, 6, 7, 9};
+constexpr uint8_t slot_open[8] = {0, 1, 2, 3, 4, 5, 6, 8};
+constexpr uint32_t slot_max[field_slots] = {UINT8_MAX, INT16_MAX, INT16_MAX, INT16_MAX, INT16_MAX, UINT8_MAX,
+                                            UINT8_MAX, UINT8_MAX, UINT8_MAX, 99999999, 99, 0};
+
+struct LineFields {
+    const uint32_t* q;          // Block offsets of the line's delimiters
+    uint32_t negative;          // Bit per slot whose field starts with '-'
+    uint32_t tail_end[4];       // Slots 8-11: offset one past the last digit
+    uint32_t tail_length[4];    // Slots 8-11: digits
+};
+
+// Offset one past the slot's last digit, and its digits without the sign
+inline uint32_t slotEnd(const LineFields& fields, size_t slot) {
+    return slot < 8 ? fields.q[slot_close[slot]] : fields.tail_end[slot - 8];
+}
+
+inline uint32_t slotLength(const LineFields& fields, size_t slot) {
+    if (slot >= 8) {
+        return fields.tail_length[slot - 8];
+    }
+    return fields.q[slot_close[slot]] - fields.q[slot_open[slot]] - 1 - ((fields.negative >> slot) & 1);
+}
+
+// Keep the top length bytes of a little-endian lane
+inline uint64_t laneMask(uint32_t length) {
+    return length ? ~0ULL << (64 - 8 * length) : 0;
+}
+
+// Convert every slot into value; false if a slot holds a non-digit or
+// exceeds its maximum. Slot lengths must already be checked (at most 8).
+inline bool convertSlotsScalar(const char* text, const LineFields& fields, uint64_t* value) {
+    bool valid = true;
+
+    for (size_t i = 0; i < field_slots; i++) {
+        uint64_t word;
+        std::memcpy(&word, text + slotEnd(fields, i) - 8, sizeof(word));
+        uint64_t keep = laneMask(slotLength(fields, i));
+        word = (word & keep) | (0x3030303030303030ULL & ~keep);
+
+        valid &= ((word & 0xF0F0F0F0F0F0F0F0ULL) | (((word + 0x0606060606060606ULL) & 0xF0F0F0F0F0F0F0F0ULL) >> 4))
+                 == 0x3333333333333333ULL;
+
+        word = ((word & 0x0F0F0F0F0F0F0F0FULL) * 2561) >> 8;
+        word = ((word & 0x00FF00FF00FF00FFULL) * 6553601) >> 16;
+        value[i] = static_cast<uint32_t>(((word & 0x0000FFFF0000FFFFULL) * 42949672960001ULL) >> 32);
+        valid &= value[i] <= slot_max[i] + ((fields.negative >> i) & 1);
+    }
+
+    return valid;
+}
+
+#ifdef INSEN_BATCH_X86
+
+inline uint64_t loadLane(const char* text, uint32_t end) {
+    uint64_t word;
+    std::memcpy(&word, text + end - 8, sizeof(word));
+    return word;
+}
+
+__attribute__((target("sse4.2")))
+inline bool convertSlotsSse42(const char* text, const LineFields& fields, uint64_t* value) {
+    const __m128i zeros = _mm_set1_epi8('0');
+    const __m128i nine = _mm_set1_epi8(9);
+    __m128i bad = _mm_setzero_si128();
+
+    for (size_t i = 0; i < field_slots; i += 2) {
+        __m128i words = _mm_set_epi64x(static_cast<long long>(loadLane(text, slotEnd(fields, i + 1))),
+                                       static_cast<long long>(loadLane(text, slotEnd(fields, i))));
+        __m128i keep = _mm_set_epi64x(static_cast<long long>(laneMask(slotLength(fields, i + 1))),
+                                      static_cast<long long>(laneMask(slotLength(fields, i))));
+        __m128i max = _mm_set_epi64x(slot_max[i + 1] + ((fields.negative >> (i + 1)) & 1),
+                                     slot_max[i] + ((fields.negative >> i) & 1));
+
+        __m128i digits = _mm_sub_epi8(_mm_blendv_epi8(zeros, words, keep), zeros);
+        bad = _mm_or_si128(bad, _mm_subs_epu8(digits, nine));
+
+        __m128i pairs = _mm_maddubs_epi16(digits, _mm_set1_epi16(0x010A));
+        __m128i quads = _mm_madd_epi16(pairs, _mm_set1_epi32(0x00010064));
+        __m128i lanes = _mm_add_epi64(_mm_mul_epu32(quads, _mm_set1_epi64x(10000)), _mm_srli_epi64(quads, 32));
+        bad = _mm_or_si128(bad, _mm_cmpgt_epi64(lanes, max));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(value + i), lanes);
+    }
+
+    return _mm_testz_si128(bad, bad);
+}
+
+// Four slots ending at ends[0..3], with their lengths and maxima already
+// widened to 64-bit lanes. The lanes are loaded one by one: a gather is
+// slower for four short loads.
+__attribute__((target("avx2")))
+inline __m256i convertLanesAvx2(const char* text, const uint32_t* ends, __m256i lengths, __m256i max,
+                                __m256i& bad) {
+    const __m256i zeros = _mm256_set1_epi8('0');
+
+    __m256i words = _mm256_set_epi64x(static_cast<long long>(loadLane(text, ends[3])),
+                                      static_cast<long long>(loadLane(text, ends[2])),
+                                      static_cast<long long>(loadLane(text, ends[1])),
+                                      static_cast<long long>(loadLane(text, ends[0])));
+    __m256i keep = _mm256_sllv_epi64(_mm256_set1_epi64x(-1),
+                                     _mm256_sub_epi64(_mm256_set1_epi64x(64), _mm256_slli_epi64(lengths, 3)));
+
+    __m256i digits = _mm256_sub_epi8(_mm256_blendv_epi8(zeros, words, keep), zeros);
+    bad = _mm256_or_si256(bad, _mm256_subs_epu8(digits, _mm256_set1_epi8(9)));
+
+    __m256i pairs = _mm256_maddubs_epi16(digits, _mm256_set1_epi16(0x010A));
+    __m256i quads = _mm256_madd_epi16(pairs, _mm256_set1_epi32(0x00010064));
+    __m256i lanes = _mm256_add_epi64(_mm256_mul_epu32(quads, _mm256_set1_epi64x(10000)),
+                                     _mm256_srli_epi64(quads, 32));
+    bad = _mm256_or_si256(bad, _mm256_cmpgt_epi64(lanes, max));
+    return lanes;
+}
+
+// The first eight slots come straight from two loads of the delimiter
+// offsets, so only the last four are assembled from scalars
+__attribute__((target("avx2")))
+inline bool convertSlotsAvx2(const char* text, const LineFields& fields, uint64_t* value) {
+    const uint32_t* q = fields.q;
+    __m256i close = _mm256_insert_epi32(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(q + 1)),
+                                        static_cast<int>(q[9]), 7);
+    __m256i open = _mm256_insert_epi32(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(q)),
+                                       static_cast<int>(q[8]), 7);
+    __m256i sign = _mm256_and_si256(_mm256_srlv_epi32(_mm256_set1_epi32(static_cast<int>(fields.negative)),
+                                                      _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7)),
+                                    _mm256_set1_epi32(1));
+    __m256i lengths = _mm256_sub_epi32(_mm256_sub_epi32(close, open),
+                                       _mm256_add_epi32(sign, _mm256_set1_epi32(1)));
+    __m256i max = _mm256_add_epi32(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(slot_max)), sign);
+    __m256i bad = _mm256_setzero_si256();
+    uint32_t ends[8] = {q[1], q[2], q[3], q[4], q[5], q[6], q[7], q[9]};
+
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(value),
+                        convertLanesAvx2(text, ends,
+                                         _mm256_cvtepu32_epi64(_mm256_castsi256_si128(lengths)),
+                                         _mm256_cvtepu32_epi64(_mm256_castsi256_si128(max)), bad));
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(value + 4),
+                        convertLanesAvx2(text, ends + 4,
+                                         _mm256_cvtepu32_epi64(_mm256_extracti128_si256(lengths, 1)),
+                                         _mm256_cvtepu32_epi64(_mm256_extracti128_si256(max, 1)), bad));
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(value + 8),
+                        convertLanesAvx2(text, fields.tail_end,
+                                         _mm256_set_epi64x(fields.tail_length[3], fields.tail_length[2],
+                                                           fields.tail_length[1], fields.tail_length[0]),
+                                         _mm256_set_epi64x(slot_max[11], slot_max[10], slot_max[9], slot_max[8]),
+                                         bad));
+
+    return _mm256_testz_si256(bad, bad);
+}
+
+#endif // INSEN_BATCH_X86
+
+// One to four hex digits, as the buttons field is nearly always written.
+// Decoded in one 32-bit word like the decimal lanes; end must be at least 4.
+inline bool decodeButtons(const char* text, uint32_t start, uint32_t end, uint16_t& value) {
+    if (end - start >= 2 && text[start] == '0' && (text[start + 1] | 0x20) == 'x') {
+        start += 2;
+    }
+    uint32_t length = end - start;
+    if (length - 1 >= 4) {
+        return false;
+    }
+
+    uint32_t word;
+    std::memcpy(&word, text + end - 4, sizeof(word));
+    uint32_t keep = ~0U << (32 - 8 * length);
+    word = (word & keep) | (0x30303030U & ~keep);
+
+    bool valid = true;
+    for (int shift = 0; shift < 32; shift += 8) {
+        uint32_t c = (word >> shift) & 0xFF;
+        valid &= (c - '0' <= 9) | ((c | 0x20) - 'a' <= 5);
+    }
+
+    // '0'-'9' are 0x3X; 'A'-'F' and 'a'-'f' are 0x4X and 0x6X holding nibble - 9
+    word = (word & 0x0F0F0F0FU) + ((word >> 6) & 0x01010101U) * 9;
+    word = ((word << 4) | (word >> 8)) & 0x00FF00FFU;
+    value = static_cast<uint16_t>(((word & 0xFF) << 8) | (word >> 16));
+    return valid;
+}
+
+// Decode the line [line, end) of text whose delimiters are q[0..count).
+// Returns false, leaving the line to parseInputLine, when it is not of the
+// common shape or a field is not plain digits within range.
+template <bool (*Convert)(const char*, const LineFields&, uint64_t*)>
+inline bool decodeLine(const char* text, uint32_t line, uint32_t end, const uint32_t* q, size_t count,
+                       ControllerState& state) {
+    static constexpr char shape[] = "||,|,|,|||";
+
+    constexpr std::string_view tag = ">>> INPUT";
+
+    // Every lane reads the eight bytes before its end, the first of which
+    // is q[1], so q[1] >= 8 always holds once the tag is there
+    if (count < 10 || end - line < tag.size() || std::memcmp(text + line, tag.data(), tag.size()) != 0 ||
+        q[0] != line + tag.size()) {
+        return false;
+    }
+
+    bool valid = true;
+    for (size_t k = 0; k < 10; k++) {
+        valid &= text[q[k]] == shape[k];
+    }
+
+    // Battery may end the line; otherwise "|timestamp", which may be empty
+    // at the end of the line and is followed by '|' or nothing
+    LineFields fields;
+    uint32_t battery_end = end;
+    uint32_t time_end = q[1];
+    uint32_t time_digits = 0;
+    if (count > 10) {
+        battery_end = q[10];
+        time_end = count > 11 ? q[11] : end;
+        time_digits = time_end - q[10] - 1;
+        valid &= text[q[10]] == '|' && (count == 11 || text[q[11]] == '|');
+        valid &= time_digits <= 10 && (time_digits > 0 || time_end == end);
+    }
+
+    fields.q = q;
+    fields.negative = 0;
+    for (size_t k = 1; k <= 4; k++) {
+        fields.negative |= static_cast<uint32_t>(text[q[k] + 1] == '-') << k;
+    }
+
+    uint32_t time_low = time_digits < 8 ? time_digits : 8;
+    fields.tail_end[0] = battery_end;
+    fields.tail_length[0] = battery_end - q[9] - 1;
+    fields.tail_end[1] = time_end;
+    fields.tail_length[1] = time_low;
+    fields.tail_end[2] = time_end - time_low;
+    fields.tail_length[2] = time_digits - time_low;
+    fields.tail_end[3] = q[1];          // Padding, always zero
+    fields.tail_length[3] = 0;
+
+    for (size_t slot = SlotId; slot <= SlotBattery; slot++) {
+        valid &= slotLength(fields, slot) - 1 < 8;
+    }
+
+    uint64_t value[field_slots];
+    if (!valid || !decodeButtons(text, q[7] + 1, q[8], state.buttons) || !Convert(text, fields, value)) {
+        return false;
+    }
+
+    uint64_t device_time = value[SlotTimeHigh] * 100000000 + value[SlotTimeLow];
+    if (device_time > UINT32_MAX) {
+        return false;
+    }
+
+    auto axis = [&](size_t slot) {
+        int32_t magnitude = static_cast<int32_t>(value[slot]);
+        return static_cast<int16_t>((fields.negative >> slot) & 1 ? -magnitude : magnitude);
+    };
+    state.id = static_cast<uint8_t>(value[SlotId]);
+    state.left_stick_x = axis(SlotLeftX);
+    state.left_stick_y = axis(SlotLeftY);
+    state.right_stick_x = axis(SlotRightX);
+    state.right_stick_y = axis(SlotRightY);
+    state.left_trigger = static_cast<uint8_t>(value[SlotLeftTrigger]);
+    state.right_trigger = static_cast<uint8_t>(value[SlotRightTrigger]);
+    state.dpad = static_cast<uint8_t>(value[SlotDpad]);
+    state.battery = static_cast<uint8_t>(value[SlotBattery]);
+    state.device_time = static_cast<uint32_t>(device_time);
+    return true;
+}
+
+} // namespace detail
+
+inline BatchKernel detectBatchKernel() {
+#ifdef INSEN_BATCH_X86
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2")) {
+        return BatchKernel::Avx2;
+    }
+    if (__builtin_cpu_supports("sse4.2")) {
+        return BatchKernel::Sse42;
+    }
+#endif
+    return BatchKernel::Scalar;
+}
+
+class BatchParser {
+private:
+    using ScanFn = size_t (*)(const char*, size_t, uint32_t*, uint32_t*, size_t&);
+    using ConvertFn = bool (*)(const char*, const detail::LineFields&, uint64_t*);
+
+    static constexpr size_t block_size = 64 * 1024;
+
+    BatchKernel active_kernel;
+    std::vector<uint32_t> delimiters;   // Scratch, reused across blocks and calls
+    std::vector<uint32_t> line_ends;
+
+    // Parse the line [line, end) of block into row; returns true if it was
+    // appended
+    template <ConvertFn Convert>
+    bool parseLine(const char* block, uint32_t line, uint32_t end, const uint32_t* q, size_t count,
+                   InputColumns& out, size_t row, BatchParseStats& stats) {
+        while (end > line && (block[end - 1] == '\r' || block[end - 1] == ' ')) {
+            end--;
+        }
+        if (end == line) {
+            return false;
+        }
+
+        stats.lines++;
+        ControllerState state{};
+
+        if (detail::decodeLine<Convert>(block, line, end, q, count, state) ||
+            parseInputLine(std::string_view(block + line, end - line), state) == ParseError::None) {
+            out.assign(row, state);
+            stats.parsed++;
+            return true;
+        }
+
+        stats.rejected++;
+        return false;
+    }
+
+    template <ScanFn Scan, ConvertFn Convert>
+    BatchParseStats parseWith(std::string_view buffer, InputColumns& out) {
+        BatchParseStats stats{0, 0, 0};
+        const char* data = buffer.data();
+        size_t length = buffer.size();
+        size_t start = 0;
+        size_t row = out.size();
+
+        while (start < length) {
+            // Cut blocks on a line boundary so no line spans two scans
+            size_t end = start + block_size < length ? start + block_size : length;
+            if (end < length) {
+                size_t cut = end;
+                while (cut > start && data[cut - 1] != '\n') {
+                    cut--;
+                }
+                if (cut == start) {
+                    const void* next = std::memchr(data + end, '\n', length - end);
+                    cut = next ? static_cast<size_t>(static_cast<const char*>(next) - data) + 1 : length;
+                }
+                end = cut;
+            }
+
+            const char* block = data + start;
+            uint32_t block_len = static_cast<uint32_t>(end - start);
+            if (delimiters.size() < block_len) {
+                delimiters.resize(block_len);
+                line_ends.resize(block_len);
+            }
+
+            size_t lines;
+            size_t count = Scan(block, block_len, delimiters.data(), line_ends.data(), lines);
+            const uint32_t* q = delimiters.data();
+
+            // Rows are written in place; the columns are trimmed at the end
+            out.resize(row + lines + 1);
+
+            size_t first = 0;
+            uint32_t line_start = 0;
+            for (size_t n = 0; n < lines; n++) {
+                size_t last = line_ends[n];
+                row += parseLine<Convert>(block, line_start, q[last], q + first, last - first, out, row, stats);
+                first = last + 1;
+                line_start = q[last] + 1;
+            }
+
+            if (line_start < block_len) {
+                row += parseLine<Convert>(block, line_start, block_len, q + first, count - first, out, row, stats);
+            }
+
+            start = end;
+        }
+
+        out.resize(row);
+        return stats;
+    }
+
+public:
+    explicit BatchParser(BatchKernel kernel = detectBatchKernel()) : active_kernel(kernel) {
+#ifndef INSEN_BATCH_X86
+        active_kernel = BatchKernel::Scalar;
+#endif
+    }
+
+    BatchKernel kernel() const {
+        return active_kernel;
+    }
+
+    // Parse every line in buffer, appending parsed samples to out
+    BatchParseStats parse(std::string_view buffer, InputColumns& out) {
+        switch (active_kernel) {
+#ifdef INSEN_BATCH_X86
+            case BatchKernel::Avx2:
+                return parseWith<detail::scanDelimitersAvx2, detail::convertSlotsAvx2>(buffer, out);
+            case BatchKernel::Sse42:
+                return parseWith<detail::scanDelimitersSse42, detail::convertSlotsSse42>(buffer, out);
+#endif
+            default:
+                return parseWith<detail::scanDelimitersScalar, detail::convertSlotsScalar>(buffer, out);
+        }
+    }
+};
+
+} // namespace insen
+
+#endif // INSEN_BATCH_PARSER_HPP
@@ -0,0 +1,1998 @@
+/*
+ * INSEN Controller Client - Microbenchmarks
+ * //madebybunnyrce
+ * Measures the hot paths of the client library, and on Linux end-to-end
+ * scenarios against emulated boards on pseudo-terminals. Build in Release
+ * (the default) for meaningful numbers.
+ *
+ * Usage: insen_bench [--filter TEXT] [--json FILE]
+ *   --filter  only run benchmarks whose name contains TEXT
+ *   --json    also write every reported metric to FILE, for diffing runs
+ */
+
+#include <algorithm>
+#include <atomic>
+#include <charconv>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <random>
+#include <sstream>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+#ifdef __linux__
+#include <fcntl.h>
+#include <poll.h>
+#include <unistd.h>
+
+#include "insen_client.h"
+#endif
+
+#include "insen_arbiter.hpp"
+#include "insen_batch_parser.hpp"
+#include "insen_change_filter.hpp"
+#include "insen_clock_sync.hpp"
+#include "insen_controller.hpp"
+#include "insen_emulator.hpp"
+#include "insen_history.hpp"
+#include "insen_hub.hpp"
+#include "insen_latency.hpp"
+#include "insen_parser.hpp"
+#include "insen_protocol.h"
+#include "insen_recording.hpp"
+#include "insen_replay.hpp"
+#include "insen_scheduler.hpp"
+#include "insen_serial.hpp"
+#include "insen_state.hpp"
+#include "insen_state_table.hpp"
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+// Keeps the optimizer from discarding benchmark results
+volatile uint64_t sink;
+
+// Every figure a benchmark reports, in run order, for --json
+struct Metric {
+    std::string name;
+    double value;
+    std::string unit;
+};
+
+std::vector<Metric> metrics;
+
+void report(const std::string& name, double value, const char* unit) {
+    metrics.push_back(Metric{name, value, unit});
+}
+
+// The stringstream/stoi parser the library used before parseInputLine,
+// kept here as the comparison baseline.
+bool legacyParseControllerInput(const std::string& response, insen::ControllerState& state) {
+    if (response.length() < 4 || response.substr(0, 4) != ">>> ") {
+        return false;
+    }
+
+    std::string data = response.substr(4);
+    std::vector<std::string> parts;
+    std::stringstream ss(data);
+    std::string item;
+
+    while (std::getline(ss, item, '|')) {
+        parts.push_back(item);
+    }
+
+    if (parts.size() >= 8 && parts[0] == "INPUT") {
+        try {
+            state.id = std::stoi(parts[1]);
+
+            size_t comma = parts[2].find(',');
+            state.left_stick_x = std::stoi(parts[2].substr(0, comma));
+            state.left_stick_y = std::stoi(parts[2].substr(comma + 1));
+
+            comma = parts[3].find(',');
+            state.right_stick_x = std::stoi(parts[3].substr(0, comma));
+            state.right_stick_y = std::stoi(parts[3].substr(comma + 1));
+
+            comma = parts[4].find(',');
+            state.left_trigger = std::stoi(parts[4].substr(0, comma));
+            state.right_trigger = std::stoi(parts[4].substr(comma + 1));
+
+            state.buttons = static_cast<uint16_t>(std::stoul(parts[5], nullptr, 16));
+            state.dpad = static_cast<uint8_t>(std::stoi(parts[6]));
+            state.battery = static_cast<uint8_t>(std::stoi(parts[7]));
+            state.timestamp = Clock::now();
+            return true;
+
+        } catch (const std::exception&) {
+        }
+    }
+
+    return false;
+}
+
+std::vector<std::string> makeInputLines(size_t count, uint32_t seed = 1) {
+    std::mt19937 rng(seed);
+    std::uniform_int_distribution<int> stick(-32768, 32767);
+    std::uniform_int_distribution<int> trigger(0, 255);
+    std::uniform_int_distribution<int> buttons(0, 0x1FFF);
+    std::uniform_int_distribution<int> dpad(0, 8);
+    std::uniform_int_distribution<int> battery(0, 100);
+
+    std::vector<std::string> lines;
+    lines.reserve(count);
+
+    char line[128];
+    for (size_t i = 0; i < count; i++) {
+        std::snprintf(line, sizeof(line), ">>> INPUT|%zu|%d,%d|%d,%d|%d,%d|0x%04X|%d|%d|%zu",
+                      i % 4, stick(rng), stick(rng), stick(rng), stick(rng),
+                      trigger(rng), trigger(rng), buttons(rng), dpad(rng), battery(rng), i * 16);
+        lines.emplace_back(line);
+    }
+
+    return lines;
+}
+
+template <typename Fn>
+double nsPerItem(size_t items, Fn&& fn) {
+    // Warm up, then time enough repetitions to cover ~200ms
+    fn();
+    size_t reps = 1;
+    for (;;) {
+        auto start = Clock::now();
+        for (size_t r = 0; r < reps; r++) {
+            fn();
+        }
+        auto elapsed = std::chrono::duration<double, std::nano>(Clock::now() - start).count();
+        if (elapsed > 2e8) {
+            return elapsed / static_cast<double>(reps * items);
+        }
+        reps *= 2;
+    }
+}
+
+void benchParseInput() {
+    auto lines = makeInputLines(4096);
+    insen::ControllerState state{};
+
+    double legacy = nsPerItem(lines.size(), [&]() {
+        for (const auto& line : lines) {
+            sink = sink + legacyParseControllerInput(line, state) + state.left_stick_x;
+        }
+    });
+
+    double current = nsPerItem(lines.size(), [&]() {
+        for (const auto& line : lines) {
+            sink = sink + (insen::parseInputLine(line, state) == insen::ParseError::None) + state.left_stick_x;
+        }
+    });
+
+    report("parse_input.legacy", legacy, "ns/line");
+    report("parse_input.core", current, "ns/line");
+    std::cout << "parse_input legacy        " << legacy << " ns/line" << std::endl;
+    std::cout << "parse_input core          " << current << " ns/line" << std::endl;
+    std::cout << "parse_input speedup       " << legacy / current << "x" << std::endl;
+}
+
+// Binary sample frames against text lines: encode/decode cost and bytes
+// on the wire. Checks every frame decodes to what the text parser reads,
+// that frames and text lines interleaved and split across reads come out
+// of LineReader intact, and that a corrupted byte is always rejected.
+void benchWireCodec() {
+    auto lines = makeInputLines(4096);
+    std::vector<insen::ControllerState> expected(lines.size());
+    std::string frames;
+    size_t text_bytes = 0;
+    for (size_t i = 0; i < lines.size(); i++) {
+        insen::parseInputLine(lines[i], expected[i]);
+        insen::Sample sample = insen::toSample(expected[i]);
+        uint8_t frame[INSEN_WIRE_FRAME_SIZE];
+        insen_wire_encode(&sample, 1, frame);
+        frames.append(reinterpret_cast<const char*>(frame), sizeof(frame));
+        text_bytes += lines[i].size() + 2;
+    }
+
+    auto sameSample = [](const insen::ControllerState& a, const insen::ControllerState& b) {
+        return a.id == b.id && a.left_stick_x == b.left_stick_x && a.left_stick_y == b.left_stick_y &&
+               a.right_stick_x == b.right_stick_x && a.right_stick_y == b.right_stick_y &&
+               a.left_trigger == b.left_trigger && a.right_trigger == b.right_trigger &&
+               a.buttons == b.buttons && a.dpad == b.dpad && a.battery == b.battery &&
+               a.device_time == b.device_time;
+    };
+
+    // Every other message as text, fed in awkward chunk sizes
+    std::string stream;
+    for (size_t i = 0; i < lines.size(); i++) {
+        if (i % 2) {
+            stream += lines[i] + "\r\n";
+        } else {
+            stream.append(frames, i * INSEN_WIRE_FRAME_SIZE, INSEN_WIRE_FRAME_SIZE);
+        }
+    }
+    insen::LineReader<> rx;
+    size_t decoded = 0;
+    for (size_t offset = 0, chunk = 1; offset < stream.size(); offset += chunk, chunk = chunk % 37 + 1) {
+        size_t length = std::min(chunk, stream.size() - offset);
+        std::memcpy(rx.writePtr(), stream.data() + offset, length);
+        rx.commit(length);
+
+        std::string_view message;
+        while (rx.nextLine(message)) {
+            insen::ControllerState state{};
+            if (decoded >= expected.size() || insen::isBinaryFrame(message) != (decoded % 2 == 0) ||
+                insen::parseInputLine(message, state) != insen::ParseError::None ||
+                !sameSample(state, expected[decoded])) {
+                std::cerr << "wire_codec message " << decoded << " does not match its text line" << std::endl;
+                std::exit(1);
+            }
+            decoded++;
+        }
+    }
+    if (decoded != expected.size()) {
+        std::cerr << "wire_codec framed " << decoded << " of " << expected.size() << " messages" << std::endl;
+        std::exit(1);
+    }
+
+    for (size_t i = 1; i < INSEN_WIRE_FRAME_SIZE - 1; i++) {
+        std::string corrupt = frames.substr(0, INSEN_WIRE_FRAME_SIZE - 1);
+        corrupt[i] = static_cast<char>(corrupt[i] ^ 0x5A);
+        insen::ControllerState state{};
+        if (insen::parseInputLine(corrupt, state) != insen::ParseError::BadFrame) {
+            std::cerr << "wire_codec accepted a frame with byte " << i << " corrupted" << std::endl;
+            std::exit(1);
+        }
+    }
+
+    std::vector<insen::Sample> samples(expected.size());
+    for (size_t i = 0; i < expected.size(); i++) {
+        samples[i] = insen::toSample(expected[i]);
+    }
+    uint8_t frame[INSEN_WIRE_FRAME_SIZE];
+    double encode = nsPerItem(samples.size(), [&]() {
+        for (const auto& sample : samples) {
+            insen_wire_encode(&sample, 1, frame);
+            sink = sink + frame[1];
+        }
+    });
+
+    insen::ControllerState state{};
+    double text = nsPerItem(lines.size(), [&]() {
+        for (const auto& line : lines) {
+            sink = sink + (insen::parseInputLine(line, state) == insen::ParseError::None) + state.left_stick_x;
+        }
+    });
+    double binary = nsPerItem(lines.size(), [&]() {
+        for (size_t i = 0; i < lines.size(); i++) {
+            std::string_view view(frames.data() + i * INSEN_WIRE_FRAME_SIZE, INSEN_WIRE_FRAME_SIZE - 1);
+            sink = sink + (insen::parseInputLine(view, state) == insen::ParseError::None) + state.left_stick_x;
+        }
+    });
+
+    double text_size = static_cast<double>(text_bytes) / static_cast<double>(lines.size());
+    report("wire_codec.encode", encode, "ns/frame");
+    report("wire_codec.decode_text", text, "ns/sample");
+    report("wire_codec.decode_binary", binary, "ns/sample");
+    report("wire_codec.text_bytes", text_size, "bytes/sample");
+    report("wire_codec.binary_bytes", INSEN_WIRE_FRAME_SIZE, "bytes/sample");
+    std::printf("wire_codec encode         %.1f ns/frame\n", encode);
+    std::printf("wire_codec decode         text %.1f ns/sample  binary %.1f ns/sample\n", text, binary);
+    std::printf("wire_codec size           text %.1f bytes/sample  binary %d bytes/sample\n",
+                text_size, INSEN_WIRE_FRAME_SIZE);
+}
+
+// The std::from_chars parser the C++ client used before the shared
+// protocol core, kept as the reference the core must agree with (the
+// prompt made optional, as the core treats it)
+insen::ParseError fromCharsParseInputLine(std::string_view line, insen::ControllerState& state) {
+    using insen::ParseError;
+    if (line.substr(0, 4) == ">>> ") {
+        line.remove_prefix(4);
+    }
+    if (line.substr(0, 6) != "INPUT|") {
+        return ParseError::NotInput;
+    }
+    line.remove_prefix(6);
+
+    const char* pos = line.data();
+    const char* end = line.data() + line.size();
+    auto number = [&](auto& value, char delimiter, bool required, int base = 10) {
+        if (pos == end) {
+            return ParseError::MissingField;
+        }
+        auto [ptr, ec] = std::from_chars(pos, end, value, base);
+        if (ec == std::errc::result_out_of_range) {
+            return ParseError::OutOfRange;
+        }
+        if (ec != std::errc() || (ptr != end && *ptr != delimiter)) {
+            return ParseError::BadNumber;
+        }
+        pos = (ptr == end) ? end : ptr + 1;
+        return required && pos == end ? ParseError::MissingField : ParseError::None;
+    };
+
+    ParseError error;
+#define INSEN_REFERENCE_FIELD(expr) \
+    if ((error = (expr)) != ParseError::None) return error
+
+    INSEN_REFERENCE_FIELD(number(state.id, '|', true));
+    if (std::string_view(pos, static_cast<size_t>(end - pos)) == "DISCONNECTED") {
+        return ParseError::Disconnected;
+    }
+    INSEN_REFERENCE_FIELD(number(state.left_stick_x, ',', true));
+    INSEN_REFERENCE_FIELD(number(state.left_stick_y, '|', true));
+    INSEN_REFERENCE_FIELD(number(state.right_stick_x, ',', true));
+    INSEN_REFERENCE_FIELD(number(state.right_stick_y, '|', true));
+    INSEN_REFERENCE_FIELD(number(state.left_trigger, ',', true));
+    INSEN_REFERENCE_FIELD(number(state.right_trigger, '|', true));
+    if (end - pos >= 2 && pos[0] == '0' && (pos[1] == 'x' || pos[1] == 'X')) {
+        pos += 2;
+    }
+    INSEN_REFERENCE_FIELD(number(state.buttons, '|', true, 16));
+    INSEN_REFERENCE_FIELD(number(state.dpad, '|', true));
+    INSEN_REFERENCE_FIELD(number(state.battery, '|', false));
+    state.device_time = 0;
+    if (pos != end) {
+        INSEN_REFERENCE_FIELD(number(state.device_time, '|', false));
+    }
+#undef INSEN_REFERENCE_FIELD
+    return ParseError::None;
+}
+
+// One random edit: flip, replace, insert or delete a byte, or truncate
+std::string mutateLine(std::string line, std::mt19937& rng) {
+    static const char alphabet[] = "0123456789-+|,xXaF \r\n>_DISCONNECTED";
+    std::uniform_int_distribution<int> op(0, 4);
+    std::uniform_int_distribution<size_t> letter(0, sizeof(alphabet) - 2);
+    size_t edits = 1 + rng() % 3;
+    for (size_t e = 0; e < edits && !line.empty(); e++) {
+        size_t at = rng() % line.size();
+        switch (op(rng)) {
+            case 0:
+                line[at] = static_cast<char>(line[at] ^ (1 << (rng() % 8)));
+                break;
+            case 1:
+                line[at] = alphabet[letter(rng)];
+                break;
+            case 2:
+                line.insert(at, 1, alphabet[letter(rng)]);
+                break;
+            case 3:
+                line.erase(at, 1);
+                break;
+            default:
+                line.resize(at);
+                break;
+        }
+    }
+    return line;
+}
+
+// The shared protocol core (insen_protocol.h) under fuzzing and against
+// references: mutated INPUT lines must decode exactly as the from_chars
+// parser did (prompt aside), mutated STATUS/LIST/INFO replies must stay in
+// bounds, a random message stream must frame the same whole or in pieces
+// through LineReader and the C framing, and command encoding must match
+// snprintf. Finally the C client reads text replies with and without the
+// ">>> " prompt from an emulated board, which it could not before.
+void benchProtocolCore() {
+    std::mt19937 rng(25);
+    auto lines = makeInputLines(512, 7);
+    lines.push_back(">>> INPUT|3|DISCONNECTED");
+    lines.push_back("INPUT|1|-32768,32767|0,-1|255,0|0xFFFF|8|100");
+    lines.push_back("INPUT|0|1,2|3,4|5,6|7|8|9|4294967295");
+    std::vector<std::string> seeds = lines;
+    for (const auto& line : lines) {
+        if (line.compare(0, 4, ">>> ") == 0) {
+            seeds.push_back(line.substr(4)); // Older firmware: no prompt
+        }
+    }
+
+    auto sameState = [](const insen::ControllerState& a, const insen::ControllerState& b) {
+        return a.id == b.id && a.left_stick_x == b.left_stick_x && a.left_stick_y == b.left_stick_y &&
+               a.right_stick_x == b.right_stick_x && a.right_stick_y == b.right_stick_y &&
+               a.left_trigger == b.left_trigger && a.right_trigger == b.right_trigger &&
+               a.buttons == b.buttons && a.dpad == b.dpad && a.battery == b.battery &&
+               a.device_time == b.device_time;
+    };
+
+    size_t fuzzed = 0, accepted = 0;
+    for (size_t i = 0; i < 200000; i++) {
+        std::string line = i < seeds.size() ? seeds[i] : mutateLine(seeds[rng() % seeds.size()], rng);
+        insen::ControllerState core{}, reference{};
+        insen::ParseError core_error = insen::parseInputLine(line, core);
+        insen::ParseError reference_error = fromCharsParseInputLine(line, reference);
+        bool agree = core_error == reference_error &&
+                     (core_error != insen::ParseError::None || sameState(core, reference)) &&
+                     (core_error != insen::ParseError::Disconnected || core.id == reference.id);
+
+        // A decoded sample is always classified as one, for the same controller
+        int id;
+        insen_command_t kind = insen_classify_reply(line.data(), line.size(), &id);
+        if (core_error == insen::ParseError::None || core_error == insen::ParseError::Disconnected) {
+            agree = agree && kind == INSEN_COMMAND_GET && id == core.id;
+        }
+        if (i < seeds.size()) {
+            agree = agree && (core_error == insen::ParseError::None || core_error == insen::ParseError::Disconnected);
+        }
+        if (!agree) {
+            std::cerr << "protocol_core disagrees with the reference parser on \"" << line << "\" ("
+                      << insen::parseErrorString(core_error) << " vs "
+                      << insen::parseErrorString(reference_error) << ")" << std::endl;
+            std::exit(1);
+        }
+        fuzzed++;
+        accepted += core_error == insen::ParseError::None;
+    }
+
+    const std::string replies[] = {
+        "STATUS|ACTIVE_2|TOTAL_INPUTS_123456|API_COMMANDS_789|FREE_HEAP_234567",
+        "CONTROLLERS|0_XBOX_ONE|1_PS4|2_SWITCH_PRO|3_GENERIC_HID_WITH_A_VERY_LONG_TYPE_NAME_INDEED",
+        "INSEN_FW_V1.2.0|BUILD_Jan_1_2025|MAKCU_COMPATIBLE|STATUS_OK|BINARY_V1",
+    };
+    insen_system_status_t status;
+    insen_controller_info_t listed[INSEN_MAX_CONTROLLERS];
+    insen_firmware_info_t info;
+    int count = 0;
+    bool replies_ok = insen_decode_status(replies[0].data(), replies[0].size(), &status) == INSEN_DECODE_OK &&
+                      status.active_controllers == 2 && status.total_inputs == 123456 &&
+                      status.api_commands == 789 && status.free_heap == 234567 &&
+                      insen_decode_list(replies[1].data(), replies[1].size(), listed, INSEN_MAX_CONTROLLERS,
+                                        &count) == INSEN_DECODE_OK &&
+                      count == 4 && listed[2].id == 2 && std::strcmp(listed[2].type, "SWITCH_PRO") == 0 &&
+                      insen_decode_info(replies[2].data(), replies[2].size(), &info) == INSEN_DECODE_OK &&
+                      std::strcmp(info.version, "1.2.0") == 0 && std::strcmp(info.build_date, "Jan 1 2025") == 0 &&
+                      info.makcu_compatible && info.status_ok && info.binary_supported;
+    for (size_t i = 0; replies_ok && i < 100000; i++) {
+        std::string reply = mutateLine(replies[i % 3], rng);
+        insen_decode_status(reply.data(), reply.size(), &status);
+        insen_decode_info(reply.data(), reply.size(), &info);
+        count = -1;
+        if (insen_decode_list(reply.data(), reply.size(), listed, 2, &count) == INSEN_DECODE_OK) {
+            replies_ok = count >= 0 && count <= 2;
+            for (int c = 0; replies_ok && c < count; c++) {
+                replies_ok = std::strlen(listed[c].type) < sizeof(listed[c].type);
+            }
+        }
+        replies_ok = replies_ok && std::strlen(info.version) < sizeof(info.version) &&
+                     std::strlen(info.build_date) < sizeof(info.build_date);
+    }
+    if (!replies_ok) {
+        std::cerr << "protocol_core decoded a STATUS/LIST/INFO reply wrongly" << std::endl;
+        std::exit(1);
+    }
+
+    // Framing: random lines, frames, blank lines and stray delimiters
+    std::string stream;
+    std::vector<std::string> messages;
+    for (size_t i = 0; i < 4000; i++) {
+        switch (rng() % 4) {
+            case 0: {
+                insen::Sample sample = {};
+                sample.controller_id = static_cast<uint8_t>(i % 4);
+                sample.timestamp = static_cast<uint32_t>(i);
+                uint8_t frame[INSEN_WIRE_FRAME_SIZE];
+                insen_wire_encode(&sample, 1, frame);
+                stream.append(reinterpret_cast<const char*>(frame), sizeof(frame));
+                messages.emplace_back(reinterpret_cast<const char*>(frame), sizeof(frame) - 1);
+                break;
+            }
+            case 1:
+                stream += "\r\n \r\n";
+                break;
+            default: {
+                const std::string& line = lines[rng() % lines.size()];
+                stream += line + (rng() % 2 ? "\r\n" : " \n");
+                messages.push_back(line);
+                break;
+            }
+        }
+    }
+    insen::LineReader<> rx;
+    std::vector<char> c_buffer;
+    size_t c_scanned = 0, cpp_framed = 0, c_framed = 0;
+    bool framing_ok = true;
+    for (size_t offset = 0; framing_ok && offset < stream.size();) {
+        size_t length = std::min<size_t>(1 + rng() % 61, stream.size() - offset);
+        std::memcpy(rx.writePtr(), stream.data() + offset, length);
+        rx.commit(length);
+        c_buffer.insert(c_buffer.end(), stream.begin() + static_cast<std::ptrdiff_t>(offset),
+                        stream.begin() + static_cast<std::ptrdiff_t>(offset + length));
+        offset += length;
+
+        std::string_view message;
+        while (framing_ok && rx.nextLine(message)) {
+            framing_ok = cpp_framed < messages.size() && message == messages[cpp_framed++];
+        }
+        insen_frame_t frame;
+        for (;;) {
+            int found = insen_frame_next(c_buffer.data(), c_buffer.size(), &c_scanned, &frame);
+            if (found) {
+                framing_ok = framing_ok && c_framed < messages.size() &&
+                             std::string_view(frame.message, frame.length) == messages[c_framed++];
+            }
+            c_buffer.erase(c_buffer.begin(), c_buffer.begin() + static_cast<std::ptrdiff_t>(frame.consumed));
+            if (!found) {
+                break;
+            }
+        }
+    }
+    if (!framing_ok || cpp_framed != messages.size() || c_framed != messages.size()) {
+        std::cerr << "protocol_core framed " << cpp_framed << "/" << c_framed << " of " << messages.size()
+                  << " messages" << std::endl;
+        std::exit(1);
+    }
+
+    for (int id = 0; id < 100000; id += (id < 100 ? 1 : 997)) {
+        char encoded[32], expected[32];
+        size_t length = insen_encode_get(encoded, sizeof(encoded), id);
+        int expected_length = std::snprintf(expected, sizeof(expected), "GET %d\r\n", id);
+        int classified;
+        if (length != static_cast<size_t>(expected_length) || std::memcmp(encoded, expected, length) != 0 ||
+            insen_classify_command(encoded, length - 2, &classified) != INSEN_COMMAND_GET || classified != id) {
+            std::cerr << "protocol_core encoded GET " << id << " wrongly" << std::endl;
+            std::exit(1);
+        }
+    }
+
+    insen::ControllerState state{};
+    double core = nsPerItem(lines.size(), [&]() {
+        for (const auto& line : lines) {
+            sink = sink + (insen::parseInputLine(line, state) == insen::ParseError::None) + state.left_stick_x;
+        }
+    });
+    double reference = nsPerItem(lines.size(), [&]() {
+        for (const auto& line : lines) {
+            sink = sink + (fromCharsParseInputLine(line, state) == insen::ParseError::None) + state.left_stick_x;
+        }
+    });
+
+#ifdef __linux__
+    // The C client against text replies, prompted and not
+    for (bool prompt : {true, false}) {
+        insen::EmulatorConfig config;
+        config.controllers = INSEN_MAX_CONTROLLERS;
+        config.prompt = prompt;
+        insen::DeviceEmulator emulator(config);
+        emulator.start();
+        insen_client_t client;
+        if (insen_init(&client, emulator.ports().at(0).c_str()) != INSEN_SUCCESS) {
+            return;
+        }
+        insen_controller_state_t states[INSEN_MAX_CONTROLLERS];
+        int polled = 0;
+        bool ok = insen_get_all_inputs(&client, states, INSEN_MAX_CONTROLLERS, &polled) == INSEN_SUCCESS &&
+                  polled == INSEN_MAX_CONTROLLERS;
+        for (int i = 0; ok && i < polled; i++) {
+            ok = states[i].controller_id == i && states[i].timestamp > 0 && states[i].battery_level <= 100;
+        }
+        insen_cleanup(&client);
+        if (!ok) {
+            std::cerr << "protocol_core: the C client could not read text INPUT lines "
+                      << (prompt ? "with" : "without") << " the prompt" << std::endl;
+            std::exit(1);
+        }
+    }
+#endif
+
+    report("protocol_core.decode", core, "ns/line");
+    report("protocol_core.from_chars_reference", reference, "ns/line");
+    report("protocol_core.fuzzed", static_cast<double>(fuzzed), "lines");
+    std::printf("protocol_core decode      %.1f ns/line  (from_chars reference %.1f ns/line)\n", core, reference);
+    std::printf("protocol_core fuzz        %zu INPUT lines agree with the reference (%zu accepted), "
+                "%zu messages framed identically\n", fuzzed, accepted, messages.size());
+}
+
+void benchButtonDecode() {
+    std::mt19937 rng(5);
+    std::uniform_int_distribution<int> any(0, 0x7FF);
+    std::uniform_int_distribution<int> bit(0, 10);
+
+    std::vector<uint16_t> random_masks(4096), single_masks(4096);
+    for (size_t i = 0; i < random_masks.size(); i++) {
+        random_masks[i] = static_cast<uint16_t>(any(rng));
+        single_masks[i] = static_cast<uint16_t>(1u << bit(rng));
+    }
+
+    auto decode = [](const std::vector<uint16_t>& masks) {
+        return nsPerItem(masks.size(), [&]() {
+            for (uint16_t mask : masks) {
+                sink = sink + insen::Controller::getButtonNames(mask).size();
+            }
+        });
+    };
+    double random_ns = decode(random_masks);
+    double single_ns = decode(single_masks);
+
+    report("button_names.random", random_ns, "ns/mask");
+    report("button_names.single", single_ns, "ns/mask");
+    std::printf("button_names random       %.1f ns/mask\n", random_ns);
+    std::printf("button_names one button   %.1f ns/mask\n", single_ns);
+}
+
+// Publishing a parsed state to consumers: the latest-state table and the
+// event queue (pushed and drained in batches, as a consumer thread would)
+void benchStatePublish() {
+    auto lines = makeInputLines(1024);
+    std::vector<insen::ControllerState> states(lines.size());
+    for (size_t i = 0; i < lines.size(); i++) {
+        insen::parseInputLine(lines[i], states[i]);
+    }
+
+    insen::StateTable<> table;
+    double store_ns = nsPerItem(states.size(), [&]() {
+        for (const auto& state : states) {
+            sink = sink + table.store(state.id, state);
+        }
+    });
+
+    insen::ControllerState loaded{};
+    double load_ns = nsPerItem(states.size(), [&]() {
+        for (const auto& state : states) {
+            sink = sink + table.load(state.id, loaded) + loaded.buttons;
+        }
+    });
+
+    constexpr size_t batch_size = 64;
+    insen::SpscQueue<insen::ControllerState> queue(4096);
+    std::vector<insen::ControllerState> batch(batch_size);
+    double queue_ns = nsPerItem(states.size(), [&]() {
+        for (size_t i = 0; i < states.size(); i += batch_size) {
+            for (size_t j = 0; j < batch_size; j++) {
+                queue.tryPush(states[i + j]);
+            }
+            sink = sink + queue.popBatch(batch.data(), batch.size());
+        }
+    });
+
+    report("state_table.store", store_ns, "ns/state");
+    report("state_table.load", load_ns, "ns/state");
+    report("event_queue.push_pop", queue_ns, "ns/state");
+    std::printf("state_table store         %.2f ns/state\n", store_ns);
+    std::printf("state_table load          %.2f ns/state\n", load_ns);
+    std::printf("event_queue push+pop      %.2f ns/state (batches of %zu)\n", queue_ns, batch_size);
+}
+
+// Pacing accuracy of the poll scheduler alone, with no work between ticks
+void benchScheduler() {
+    for (auto strategy : {insen::WaitStrategy::Sleep, insen::WaitStrategy::Hybrid}) {
+        insen::PollScheduler scheduler(1000.0, strategy);
+        scheduler.start();
+        auto end = Clock::now() + std::chrono::milliseconds(500);
+        while (Clock::now() < end) {
+            scheduler.wait();
+        }
+
+        insen::PacingStats stats = scheduler.stats();
+        std::string name = strategy == insen::WaitStrategy::Sleep ? "sleep" : "hybrid";
+        report("scheduler." + name + ".rate", stats.achieved_hz, "Hz");
+        report("scheduler." + name + ".jitter", stats.jitter_ns / 1e3, "us");
+        report("scheduler." + name + ".late_p50", stats.lateness.percentile(50) / 1e3, "us");
+        report("scheduler." + name + ".late_p99", stats.lateness.percentile(99) / 1e3, "us");
+        std::printf("scheduler %-6s 1000 Hz    %.2f Hz  jitter %.1f us  late p50 %.1f us  p99 %.1f us  (%llu missed)\n",
+                    name.c_str(), stats.achieved_hz, stats.jitter_ns / 1e3, stats.lateness.percentile(50) / 1e3,
+                    stats.lateness.percentile(99) / 1e3, static_cast<unsigned long long>(stats.missed));
+    }
+}
+
+bool sameState(const insen::ControllerState& a, const insen::ControllerState& b) {
+    return a.id == b.id &&
+           a.left_stick_x == b.left_stick_x && a.left_stick_y == b.left_stick_y &&
+           a.right_stick_x == b.right_stick_x && a.right_stick_y == b.right_stick_y &&
+           a.left_trigger == b.left_trigger && a.right_trigger == b.right_trigger &&
+           a.buttons == b.buttons && a.dpad == b.dpad && a.battery == b.battery &&
+           a.device_time == b.device_time;
+}
+
+void benchBatchParse() {
+    // Mix in the irregular lines a capture can contain so the fallback
+    // path is exercised by the equivalence check below.
+    const char* irregular[] = {
+        ">>> INPUT|0|1,2|3,4|5,6|0x000F|3|85",
+        ">>> INPUT|0|1,2|3,4|5,6|0x000F|3|85,7",
+        ">>> INPUT|0|1,2|3,4|5,6|0xF|3|300|1",
+        ">>> INPUT|0|-,2|3,4|5,6|0x000F|3|85|1",
+        ">>> INPUT|12345678901|1,2|3,4|5,6|0x000F|3|85|1",
+        ">>> INPUT|0|1,2|3,4|5,6|1FFF|3|85  ",
+        ">>> INPUT|0|1,2|3,4|5,6|0x000F|3|85|4294967295|extra",
+        ">>> INPUT|0|1,2|3,4|5,6|0x000F|3|85|12ms",
+        ">>> STATUS|ACTIVE_1|TOTAL_INPUTS_1|API_COMMANDS_2|FREE_HEAP_3",
+        "INPUT|0|1,2|3,4|5,6|0x000F|3|85|1",
+        "",
+    };
+
+    auto lines = makeInputLines(200000);
+    std::string buffer;
+    for (size_t i = 0; i < lines.size(); i++) {
+        if (i % 97 == 0) {
+            lines[i] = irregular[(i / 97) % (sizeof(irregular) / sizeof(irregular[0]))];
+        }
+        buffer += lines[i];
+        buffer += (i % 2) ? "\r\n" : "\n";
+    }
+
+    // Reference, and the baseline the kernels have to beat: one
+    // parseInputLine call per line, trimmed like LineReader does
+    insen::InputColumns expected;
+    auto parsePerLine = [&]() {
+        expected.clear();
+        for (const auto& line : lines) {
+            std::string_view view = line;
+            while (!view.empty() && (view.back() == '\r' || view.back() == ' ')) {
+                view.remove_suffix(1);
+            }
+            insen::ControllerState state{};
+            if (insen::parseInputLine(view, state) == insen::ParseError::None) {
+                expected.push_back(state);
+            }
+        }
+    };
+
+    double per_line_ns = nsPerItem(lines.size(), parsePerLine);
+    report("batch_parse.per_line", per_line_ns, "ns/line");
+    std::printf("batch_parse %-13s %.2f ns/line\n", "per_line", per_line_ns);
+
+    for (auto kernel : {insen::BatchKernel::Scalar, insen::BatchKernel::Sse42, insen::BatchKernel::Avx2}) {
+        insen::BatchParser parser(kernel);
+        if (parser.kernel() != kernel) {
+            continue; // Not available on this CPU
+        }
+
+        insen::InputColumns columns;
+        parser.parse(buffer, columns);
+
+        bool equivalent = columns.size() == expected.size();
+        for (size_t i = 0; equivalent && i < columns.size(); i++) {
+            equivalent = sameState(columns.state(i), expected.state(i));
+        }
+        if (!equivalent) {
+            std::cerr << "batch_parse " << insen::batchKernelName(kernel)
+                      << " disagrees with parseInputLine" << std::endl;
+            std::exit(1);
+        }
+
+        double ns_per_line = nsPerItem(lines.size(), [&]() {
+            columns.clear();
+            sink = sink + parser.parse(buffer, columns).parsed;
+        });
+        double mb_per_sec = (buffer.size() / static_cast<double>(lines.size())) / ns_per_line * 1e3;
+
+        report(std::string("batch_parse.") + insen::batchKernelName(kernel), ns_per_line, "ns/line");
+        report(std::string("batch_parse.") + insen::batchKernelName(kernel) + ".throughput", mb_per_sec, "MB/s");
+        std::printf("batch_parse %-13s %.2f ns/line  %.0f MB/s  %.2fx per_line\n",
+                    insen::batchKernelName(kernel), ns_per_line, mb_per_sec, per_line_ns / ns_per_line);
+    }
+}
+
+void benchChangeFilter() {
+    // A mostly idle 240 Hz stream: repeated samples, small stick noise,
+    // and occasional real moves and button presses
+    std::mt19937 rng(7);
+    std::uniform_int_distribution<int> kind(0, 99);
+    std::uniform_int_distribution<int> noise(-40, 40);
+    std::uniform_int_distribution<int> move(-20000, 20000);
+
+    std::vector<insen::ControllerState> stream(1 << 16);
+    insen::ControllerState current[4] = {};
+    for (size_t i = 0; i < stream.size(); i++) {
+        insen::ControllerState& state = current[i % 4];
+        state.id = static_cast<uint8_t>(i % 4);
+        int roll = kind(rng);
+        if (roll < 8) {
+            state.left_stick_x = static_cast<int16_t>(state.left_stick_x + noise(rng));
+        } else if (roll < 10) {
+            state.left_stick_x = static_cast<int16_t>(move(rng));
+        } else if (roll < 11) {
+            state.buttons = static_cast<uint16_t>(state.buttons ^ (1u << (i % 11)));
+        }
+        stream[i] = state;
+    }
+
+    insen::ChangeFilter filter(insen::Deadzones::uniform(256, 4));
+    uint64_t events = 0;
+    insen::ChangeEvent event;
+
+    for (const auto& state : stream) {
+        events += filter.update(state, event);
+    }
+
+    double ns = nsPerItem(stream.size(), [&]() {
+        for (const auto& state : stream) {
+            sink = sink + filter.update(state, event);
+        }
+    });
+
+    report("change_filter.update", ns, "ns/sample");
+    std::printf("change_filter update      %.2f ns/sample  %.1f%% of samples delivered\n", ns,
+                100.0 * static_cast<double>(events) / static_cast<double>(stream.size()));
+}
+
+void benchLatencyHistogram() {
+    // Log-normal-ish round trips from a few us to tens of ms
+    std::mt19937 rng(3);
+    std::lognormal_distribution<double> rtt(11.0, 1.2);
+    std::vector<uint64_t> values(1 << 16);
+    for (auto& value : values) {
+        value = static_cast<uint64_t>(rtt(rng));
+    }
+
+    insen::LatencyHistogram histogram;
+    for (uint64_t value : values) {
+        histogram.record(value);
+    }
+
+    // Every reported percentile must sit within one sub-bucket (~3%) of exact
+    insen::LatencySnapshot snap = histogram.snapshot();
+    std::vector<uint64_t> sorted = values;
+    std::sort(sorted.begin(), sorted.end());
+    for (double p : {50.0, 90.0, 99.0, 99.9}) {
+        auto rank = static_cast<size_t>(p / 100.0 * static_cast<double>(sorted.size()) + 0.5);
+        double exact = static_cast<double>(sorted[rank - 1]);
+        double reported = static_cast<double>(snap.percentile(p));
+        if (reported < exact || reported > exact * (1.0 + 1.0 / insen::detail::latency_sub_count) + 1) {
+            std::cerr << "latency_histogram p" << p << " reported " << reported
+                      << " ns, exact " << exact << " ns" << std::endl;
+            std::exit(1);
+        }
+    }
+
+    double ns = nsPerItem(values.size(), [&]() {
+        for (uint64_t value : values) {
+            histogram.record(value);
+        }
+    });
+
+    report("latency_histogram.record", ns, "ns/sample");
+    std::printf("latency_histogram record  %.2f ns/sample  (p99 %.1f us)\n", ns, snap.percentile(99) / 1e3);
+}
+
+void benchClockSync() {
+    // Simulated board: 1 ms ticks, a clock 50 ppm slower than the host,
+    // booted 3.7 s after the host epoch; 250 Hz round trips of 100-400 us
+    // with every tenth one stuck behind 2 ms of queueing
+    using Nanos = std::chrono::nanoseconds;
+    constexpr double true_drift_ppm = 50.0;
+    constexpr int64_t boot_ns = 3700000000LL;
+
+    std::mt19937 rng(11);
+    std::uniform_int_distribution<int64_t> leg(50000, 200000);
+    auto deviceTicks = [&](int64_t host_ns) {
+        double device_ns = static_cast<double>(host_ns - boot_ns) / (1.0 + true_drift_ppm * 1e-6);
+        return static_cast<uint32_t>(static_cast<int64_t>(device_ns) / 1000000);
+    };
+    auto hostTime = [](int64_t ns) { return Clock::time_point(std::chrono::duration_cast<Clock::duration>(Nanos(ns))); };
+
+    insen::ClockSync sync;
+    double worst_error_ns = 0;
+    int64_t host_ns = boot_ns + 1000000000LL;
+    size_t round_trips = 120 * 250;
+
+    auto started = Clock::now();
+    for (size_t i = 0; i < round_trips; i++, host_ns += 4000000) {
+        int64_t sent = host_ns - leg(rng) - (i % 10 == 0 ? 2000000 : 0);
+        int64_t received = host_ns + leg(rng);
+        uint32_t ticks = deviceTicks(host_ns);
+        sync.addSample(ticks, hostTime(sent), hostTime(received));
+
+        // After a minute of history, every mapped sample should land within
+        // a tick of when the device actually took it
+        if (i > 60 * 250) {
+            double mapped = static_cast<double>(
+                std::chrono::duration_cast<Nanos>(sync.toHost(ticks, {}).time_since_epoch()).count());
+            double error = std::abs(mapped - static_cast<double>(host_ns));
+            worst_error_ns = error > worst_error_ns ? error : worst_error_ns;
+        }
+    }
+    double ns_per_sample = std::chrono::duration<double, std::nano>(Clock::now() - started).count() /
+                           static_cast<double>(round_trips);
+
+    insen::ClockEstimate estimate = sync.estimate();
+    if (std::abs(estimate.drift_ppm - true_drift_ppm) > 10.0 || worst_error_ns > 1e6) {
+        std::cerr << "clock_sync drift " << estimate.drift_ppm << " ppm (expected " << true_drift_ppm
+                  << "), worst mapping error " << worst_error_ns / 1e3 << " us" << std::endl;
+        std::exit(1);
+    }
+
+    report("clock_sync.add_sample", ns_per_sample, "ns/round_trip");
+    report("clock_sync.drift_error", std::abs(estimate.drift_ppm - true_drift_ppm), "ppm");
+    report("clock_sync.worst_error", worst_error_ns / 1e3, "us");
+    std::printf("clock_sync                %.0f ns/round trip  drift %.1f ppm (true %.0f)  worst error %.0f us\n",
+                ns_per_sample, estimate.drift_ppm, true_drift_ppm, worst_error_ns / 1e3);
+}
+
+void benchHistory() {
+    constexpr size_t window = 1024;
+    auto lines = makeInputLines(window);
+
+    // Array-of-structs baseline: the same window kept as ControllerState rows
+    std::vector<insen::ControllerState> rows(window);
+    auto history = std::make_unique<insen::SampleHistory<window>>();
+    for (size_t i = 0; i < window; i++) {
+        insen::parseInputLine(lines[i], rows[i]);
+        history->push(rows[i]);
+    }
+
+    double aos = nsPerItem(window, [&]() {
+        int64_t sum = 0;
+        for (const auto& row : rows) {
+            sum += row.left_stick_x;
+        }
+        sink = sink + static_cast<uint64_t>(sum);
+    });
+
+    double soa = nsPerItem(window, [&]() {
+        sink = sink + static_cast<uint64_t>(insen::columnSum(history->leftStickX(window), window));
+    });
+
+    report("history_column_sum.aos", aos, "ns/sample");
+    report("history_column_sum.soa", soa, "ns/sample");
+    std::printf("history_column_sum aos    %.3f ns/sample (%zu-byte rows)\n", aos, sizeof(insen::ControllerState));
+    std::printf("history_column_sum soa    %.3f ns/sample\n", soa);
+}
+
+// Smooth, rig-like motion: small random walks per controller rather than
+// the uniformly random fields of makeInputLines, which no delta coder can
+// compress.
+std::vector<insen::Sample> makeMotionSamples(size_t count, uint32_t seed = 1) {
+    std::mt19937 rng(seed);
+    std::uniform_int_distribution<int> step(-300, 300);
+    std::uniform_int_distribution<int> press(0, 63);
+
+    std::vector<insen::Sample> samples(count);
+    insen::Sample current[4] = {};
+
+    for (size_t i = 0; i < count; i++) {
+        insen::Sample& sample = current[i % 4];
+        sample.controller_id = static_cast<uint8_t>(i % 4);
+        sample.left_stick_x = static_cast<int16_t>(sample.left_stick_x + step(rng));
+        sample.left_stick_y = static_cast<int16_t>(sample.left_stick_y + step(rng));
+        sample.right_stick_x = static_cast<int16_t>(sample.right_stick_x + step(rng) / 4);
+        sample.left_trigger = static_cast<uint8_t>(press(rng) == 0 ? 255 - sample.left_trigger : sample.left_trigger);
+        sample.buttons = static_cast<uint16_t>(press(rng) == 0 ? sample.buttons ^ (1u << (i % 11)) : sample.buttons);
+        sample.battery_level = 87;
+        sample.timestamp = static_cast<uint32_t>(i * 4);
+        samples[i] = sample;
+    }
+
+    return samples;
+}
+
+void benchRecording() {
+    auto samples = makeMotionSamples(16384);
+    auto start_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now().time_since_epoch()).count();
+
+    insen::recording::ChunkEncoder encoder;
+    std::vector<uint8_t> chunk;
+    auto encodeAll = [&]() {
+        encoder.reset();
+        for (size_t i = 0; i < samples.size(); i++) {
+            encoder.add(samples[i], start_ns + static_cast<int64_t>(i) * 1000000);
+        }
+        chunk.clear();
+        encoder.finish(chunk);
+    };
+
+    double encode_ns = nsPerItem(samples.size(), encodeAll);
+
+    // Round trip: every field and host time must come back unchanged
+    insen::recording::ChunkHeader header;
+    size_t index = 0;
+    bool equivalent = insen::recording::decodeChunkHeader(chunk.data(), chunk.size(), header);
+    if (equivalent) {
+        auto check = [&](const insen::Sample& sample, int64_t host_ns) {
+            equivalent = equivalent && index < samples.size() &&
+                         std::memcmp(&sample, &samples[index], sizeof(sample)) == 0 &&
+                         host_ns == start_ns + static_cast<int64_t>(index) * 1000000;
+            index++;
+        };
+        equivalent = insen::recording::decodeChunk(header, chunk.data() + insen::recording::chunk_header_size,
+                                                   check) == samples.size() && equivalent;
+    }
+    if (!equivalent) {
+        std::cerr << "recording round trip mismatch at sample " << index << std::endl;
+        std::exit(1);
+    }
+
+    double decode_ns = nsPerItem(samples.size(), [&]() {
+        sink = sink + insen::recording::decodeChunk(header, chunk.data() + insen::recording::chunk_header_size,
+                                                    [](const insen::Sample& sample, int64_t) {
+                                                        sink = sink + static_cast<uint64_t>(sample.left_stick_x);
+                                                    });
+    });
+
+    // The I/O-thread side: record() only enqueues; the flusher writes
+    std::string path = (std::filesystem::temp_directory_path() / "insen_bench.rec").string();
+    {
+        insen::SessionRecorder recorder;
+        if (recorder.open(path, "INSEN bench")) {
+            auto started = Clock::now();
+            for (const auto& sample : samples) {
+                recorder.record(sample, Clock::now());
+            }
+            double record_ns = std::chrono::duration<double, std::nano>(Clock::now() - started).count() /
+                               static_cast<double>(samples.size());
+            recorder.close();
+            report("recording.record", record_ns, "ns/sample");
+            std::printf("recording record()        %.2f ns/sample  (%llu dropped)\n", record_ns,
+                        static_cast<unsigned long long>(recorder.samplesDropped()));
+        }
+        std::remove(path.c_str());
+    }
+
+    report("recording.encode", encode_ns, "ns/sample");
+    report("recording.encoded_size", static_cast<double>(chunk.size()) / static_cast<double>(samples.size()),
+           "bytes/sample");
+    report("recording.decode", decode_ns, "ns/sample");
+    std::printf("recording encode          %.2f ns/sample  %.2f bytes/sample (raw %zu)\n", encode_ns,
+                static_cast<double>(chunk.size()) / static_cast<double>(samples.size()), sizeof(insen::Sample));
+    std::printf("recording decode          %.2f ns/sample\n", decode_ns);
+}
+
+void benchReplay() {
+    // ~1M samples: large enough that chunk boundaries and page faults on
+    // the mapping are part of the measurement
+    auto samples = makeMotionSamples(1 << 20);
+    std::string path = (std::filesystem::temp_directory_path() / "insen_bench_replay.rec").string();
+
+    insen::recording::FileHeader file_header = {};
+    file_header.device_info = "INSEN bench";
+    std::vector<uint8_t> bytes = insen::recording::encodeFileHeader(file_header);
+    insen::recording::ChunkEncoder encoder;
+    uint64_t expected_sum = 0;
+    for (size_t i = 0; i < samples.size(); i++) {
+        encoder.add(samples[i], static_cast<int64_t>(i) * 1000000);
+        expected_sum += static_cast<uint16_t>(samples[i].left_stick_x) + samples[i].buttons;
+        if (encoder.payloadSize() >= 64 * 1024 || i + 1 == samples.size()) {
+            encoder.finish(bytes);
+            encoder.reset();
+        }
+    }
+
+    std::FILE* file = std::fopen(path.c_str(), "wb");
+    if (!file) {
+        return;
+    }
+    std::fwrite(bytes.data(), 1, bytes.size(), file);
+    std::fclose(file);
+
+    insen::SessionReplay replay;
+    if (!replay.open(path)) {
+        std::remove(path.c_str());
+        return;
+    }
+
+    // Through the live consumer path: callback per ControllerState
+    uint64_t sum = 0;
+    replay.setInputCallback([&sum](const insen::ControllerState& state) {
+        sum += static_cast<uint16_t>(state.left_stick_x) + state.buttons;
+    });
+
+    auto started = Clock::now();
+    uint64_t delivered = replay.run(0);
+    double callback_secs = std::chrono::duration<double>(Clock::now() - started).count();
+
+    if (delivered != samples.size() || sum != expected_sum || replay.wasTruncated()) {
+        std::cerr << "replay delivered " << delivered << " of " << samples.size()
+                  << " samples or altered them" << std::endl;
+        std::exit(1);
+    }
+
+    started = Clock::now();
+    uint64_t visited = replay.visit([](const insen::Sample& sample, int64_t) {
+        sink = sink + static_cast<uint64_t>(sample.left_stick_x);
+    });
+    double visit_secs = std::chrono::duration<double>(Clock::now() - started).count();
+
+    report("replay.callback", static_cast<double>(delivered) / callback_secs / 1e6, "M samples/s");
+    report("replay.visit", static_cast<double>(visited) / visit_secs / 1e6, "M samples/s");
+    std::printf("replay callback           %.1f M samples/s (%.2f bytes/sample on disk)\n",
+                static_cast<double>(delivered) / callback_secs / 1e6,
+                static_cast<double>(bytes.size()) / static_cast<double>(samples.size()));
+    std::printf("replay visit              %.1f M samples/s\n", static_cast<double>(visited) / visit_secs / 1e6);
+
+    replay.close();
+    std::remove(path.c_str());
+}
+
+#ifdef __linux__
+// Connects quietly; Controller reports connection progress on stdout
+bool connectQuietly(insen::Controller& controller) {
+    std::cout.setstate(std::ios::failbit);
+    bool connected = controller.connect();
+    std::cout.clear();
+    return connected;
+}
+
+void disconnectQuietly(insen::Controller& controller) {
+    std::cout.setstate(std::ios::failbit);
+    controller.disconnect();
+    std::cout.clear();
+}
+
+// GET round trip through Controller::getControllerInput against an
+// emulated board, with an unthrottled link and at the stock 115200 baud
+void benchGetRoundTrip() {
+    for (int baud : {0, 115200}) {
+        insen::EmulatorConfig config;
+        config.baud_rate = baud;
+        insen::DeviceEmulator emulator(config);
+        emulator.start();
+
+        insen::Controller controller(emulator.ports().at(0));
+        if (!connectQuietly(controller)) {
+            continue;
+        }
+
+        controller.latencyStats().reset();
+        size_t exchanges = baud ? 400 : 4000;
+        size_t failed = 0;
+        for (size_t i = 0; i < exchanges; i++) {
+            failed += !controller.getControllerInput(0);
+        }
+        insen::LatencySnapshot snap =
+            controller.latencyStats().histogram(insen::CommandType::Get, 0, insen::LatencyMetric::Line).snapshot();
+        disconnectQuietly(controller);
+
+        std::string name = baud ? "get_rtt.baud" + std::to_string(baud) : "get_rtt.unthrottled";
+        report(name + ".p50", snap.percentile(50) / 1e3, "us");
+        report(name + ".p99", snap.percentile(99) / 1e3, "us");
+        report(name + ".max", snap.max_ns / 1e3, "us");
+        report(name + ".failed", static_cast<double>(failed), "exchanges");
+        std::printf("get_rtt %-17s p50 %.0f us  p99 %.0f us  max %.0f us  (%zu failed)\n",
+                    baud ? ("baud=" + std::to_string(baud)).c_str() : "unthrottled",
+                    snap.percentile(50) / 1e3, snap.percentile(99) / 1e3, snap.max_ns / 1e3, failed);
+    }
+}
+
+// Sustained delivery rate and pacing of the monitor loop at several poll
+// rates. Jitter is measured on the intervals between delivered samples.
+void benchMonitorLoop() {
+    insen::DeviceEmulator emulator;
+    emulator.start();
+    insen::Controller controller(emulator.ports().at(0));
+    if (!connectQuietly(controller)) {
+        return;
+    }
+
+    std::vector<Clock::time_point> arrivals;
+    controller.setInputCallback([&arrivals](const insen::ControllerState&) {
+        arrivals.push_back(Clock::now());
+    });
+
+    struct Variant {
+        const char* name;
+        insen::MonitorMode mode;
+        insen::WaitStrategy wait;
+    };
+    const Variant variants[] = {
+        {"polling", insen::MonitorMode::Polling, insen::WaitStrategy::Sleep},
+        {"hybrid", insen::MonitorMode::Polling, insen::WaitStrategy::Hybrid},
+        {"event", insen::MonitorMode::EventDriven, insen::WaitStrategy::Sleep},
+    };
+
+    for (const Variant& variant : variants) {
+        for (int fps : {60, 250, 1000}) {
+            arrivals.clear();
+            arrivals.reserve(static_cast<size_t>(fps) * 2 + 64);
+
+            std::cout.setstate(std::ios::failbit);
+            controller.setPollWait(variant.wait);
+            controller.startMonitoring(0, fps, variant.mode);
+            std::this_thread::sleep_for(std::chrono::seconds(1));
+            controller.stopMonitoring();
+            std::cout.clear();
+
+            // Skip the first few samples while the loop settles
+            constexpr size_t settle = 5;
+            if (arrivals.size() < settle + 3) {
+                continue;
+            }
+            std::vector<double> intervals;
+            for (size_t i = settle + 1; i < arrivals.size(); i++) {
+                intervals.push_back(std::chrono::duration<double, std::micro>(arrivals[i] - arrivals[i - 1]).count());
+            }
+
+            double period_us = 1e6 / fps;
+            double mean = 0, variance = 0;
+            for (double interval : intervals) {
+                mean += interval;
+            }
+            mean /= static_cast<double>(intervals.size());
+            std::vector<double> deviations;
+            for (double interval : intervals) {
+                variance += (interval - mean) * (interval - mean);
+                deviations.push_back(std::abs(interval - period_us));
+            }
+            double stddev = std::sqrt(variance / static_cast<double>(intervals.size()));
+            std::sort(deviations.begin(), deviations.end());
+            double p99 = deviations[deviations.size() * 99 / 100];
+            double rate = 1e6 / mean;
+
+            const char* mode_name = variant.name;
+            std::string name = std::string("monitor.") + mode_name + "." + std::to_string(fps) + "hz";
+            report(name + ".rate", rate, "samples/s");
+            report(name + ".jitter_stddev", stddev, "us");
+            report(name + ".jitter_p99", p99, "us");
+            std::printf("monitor %-7s %4d Hz    %7.1f samples/s  jitter sd %.0f us  p99 %.0f us\n",
+                        mode_name, fps, rate, stddev, p99);
+        }
+    }
+
+    disconnectQuietly(controller);
+}
+
+// Polling a 4-pad board: LIST before every round of GETs (what the C
+// example used to do) against one pipelined burst per round on a cached
+// topology. Runs at 115200 baud, where bytes on the wire dominate, and on
+// an unthrottled link with 1 ms of USB-like transport delay per reply and
+// 100 us of firmware time per command, where round trips dominate.
+void benchPollAll() {
+    constexpr int pads = 4;
+    for (int baud : {115200, 0}) {
+        insen::EmulatorConfig config;
+        config.controllers = pads;
+        config.baud_rate = baud;
+        if (!baud) {
+            config.setLatency(std::chrono::microseconds(100));
+            config.link_delay = std::chrono::milliseconds(1);
+        }
+        insen::DeviceEmulator emulator(config);
+        emulator.start();
+
+        insen::Controller controller(emulator.ports().at(0));
+        if (!connectQuietly(controller)) {
+            continue;
+        }
+        std::cout.setstate(std::ios::failbit);
+
+        auto run = [&](auto&& round) {
+            size_t samples = 0;
+            auto started = Clock::now();
+            auto end = started + std::chrono::milliseconds(800);
+            while (Clock::now() < end) {
+                samples += round();
+            }
+            return static_cast<double>(samples) / std::chrono::duration<double>(Clock::now() - started).count();
+        };
+
+        double list_each_round = run([&]() {
+            controller.sendCommand("LIST");
+            size_t received = 0;
+            for (int id = 0; id < pads; id++) {
+                received += controller.getControllerInput(id);
+            }
+            return received;
+        });
+        double cached_burst = run([&]() { return controller.pollAllControllers(); });
+
+        // Unplugging a pad must shrink the cached topology within a few rounds
+        emulator.setControllers(pads - 1);
+        for (int round = 0; round < 5; round++) {
+            controller.pollAllControllers();
+        }
+        size_t remaining = controller.connectedControllers().size();
+        emulator.setControllers(pads);
+        std::cout.clear();
+        disconnectQuietly(controller);
+
+        if (remaining != pads - 1) {
+            std::cerr << "poll_all still lists " << remaining << " controllers after one disconnected" << std::endl;
+            std::exit(1);
+        }
+
+        std::string name = baud ? "poll_all.baud" + std::to_string(baud) : "poll_all.usb_delay";
+        report(name + ".list_each_round", list_each_round, "samples/s");
+        report(name + ".cached_burst", cached_burst, "samples/s");
+        std::printf("poll_all %-16s LIST each round %6.0f samples/s  cached burst %6.0f samples/s  (%.2fx)\n",
+                    baud ? ("baud=" + std::to_string(baud)).c_str() : "usb_delay=1ms",
+                    list_each_round, cached_burst, cached_burst / list_each_round);
+    }
+}
+
+// Streaming a 1-pad board at 100 Hz, 115200 baud: firmware pushes against
+// event-driven GETs at the same rate. Reports delivered samples, bytes the
+// host sends per sample and how old each sample is on arrival. Also checks
+// that stream mode keeps sampling by polling while the firmware is silent,
+// and stops polling once pushes resume.
+void benchStream() {
+    constexpr int fps = 100;
+    insen::EmulatorConfig config;
+    config.controllers = 1;
+    config.baud_rate = 115200;
+    insen::DeviceEmulator emulator(config);
+    emulator.start();
+
+    insen::Controller controller(emulator.ports().at(0));
+    if (!connectQuietly(controller)) {
+        return;
+    }
+
+    std::mutex mutex;
+    size_t samples = 0;
+    double age_sum_us = 0;
+    controller.setInputCallback([&](const insen::ControllerState& state) {
+        std::lock_guard<std::mutex> lock(mutex);
+        samples++;
+        age_sum_us += std::chrono::duration<double, std::micro>(
+            state.timestamp - emulator.sampleTime(state.device_time)).count();
+    });
+
+    struct Result {
+        double rate;
+        double bytes_per_sample;
+        double age_us;
+    };
+    auto run = [&](insen::MonitorMode mode, double push_hz) {
+        emulator.setStreamRate(push_hz);
+        std::cout.setstate(std::ios::failbit);
+        controller.startMonitoring(0, fps, mode);
+        std::this_thread::sleep_for(std::chrono::milliseconds(200)); // Settle
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            samples = 0;
+            age_sum_us = 0;
+        }
+        uint64_t received_before = emulator.bytesReceived();
+        auto started = Clock::now();
+        std::this_thread::sleep_for(std::chrono::seconds(1));
+
+        Result result{};
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            double elapsed = std::chrono::duration<double>(Clock::now() - started).count();
+            result.rate = static_cast<double>(samples) / elapsed;
+            result.bytes_per_sample = samples ? static_cast<double>(emulator.bytesReceived() - received_before) / samples : 0;
+            result.age_us = samples ? age_sum_us / static_cast<double>(samples) : 0;
+        }
+        controller.stopMonitoring();
+        emulator.setStreamRate(0);
+        std::cout.clear();
+        return result;
+    };
+
+    Result polled = run(insen::MonitorMode::EventDriven, 0);
+    Result pushed = run(insen::MonitorMode::Stream, fps);
+    Result fallback = run(insen::MonitorMode::Stream, 0);
+
+    if (fallback.rate < fps * 0.8) {
+        std::cerr << "stream mode fell back to only " << fallback.rate << " samples/s without pushes" << std::endl;
+        std::exit(1);
+    }
+    if (pushed.bytes_per_sample > 1.0) {
+        std::cerr << "stream mode still sends " << pushed.bytes_per_sample << " bytes per pushed sample" << std::endl;
+        std::exit(1);
+    }
+    disconnectQuietly(controller);
+
+    const std::pair<const char*, Result> results[] = {{"polled", polled}, {"pushed", pushed}, {"fallback", fallback}};
+    for (const auto& entry : results) {
+        std::string name = std::string("stream.") + entry.first;
+        report(name + ".rate", entry.second.rate, "samples/s");
+        report(name + ".host_bytes_per_sample", entry.second.bytes_per_sample, "bytes");
+        report(name + ".sample_age", entry.second.age_us, "us");
+        std::printf("stream %-8s %4d Hz    %7.1f samples/s  %5.1f host bytes/sample  age %6.0f us\n",
+                    entry.first, fps, entry.second.rate, entry.second.bytes_per_sample, entry.second.age_us);
+    }
+}
+
+// Samples per second one board delivers over its link in text and binary,
+// at 115200 and 921600 baud: firmware pushes for 4 pads faster than the
+// line can carry (stream), and back-to-back pipelined GET bursts (poll).
+// Also checks that a board without binary support stays on text.
+void benchWireLink() {
+    constexpr int pads = 4;
+    {
+        insen::EmulatorConfig config;
+        config.binary = false;
+        insen::DeviceEmulator emulator(config);
+        emulator.start();
+        insen::Controller controller(emulator.ports().at(0));
+        if (!connectQuietly(controller)) {
+            return;
+        }
+        std::cout.setstate(std::ios::failbit);
+        bool fell_back = !controller.binaryActive() && controller.getControllerInput(0);
+        std::cout.clear();
+        disconnectQuietly(controller);
+        if (!fell_back) {
+            std::cerr << "wire_link did not fall back to text on a board without binary support" << std::endl;
+            std::exit(1);
+        }
+    }
+
+    for (int baud : {115200, 921600}) {
+        insen::EmulatorConfig config;
+        config.controllers = pads;
+        config.baud_rate = baud;
+        insen::DeviceEmulator emulator(config);
+        emulator.start();
+
+        insen::Controller controller(emulator.ports().at(0));
+        if (!connectQuietly(controller)) {
+            continue;
+        }
+
+        std::atomic<size_t> samples{0};
+        controller.setInputCallback([&samples](const insen::ControllerState&) {
+            samples.fetch_add(1, std::memory_order_relaxed);
+        });
+
+        auto measure = [&](auto&& body) {
+            samples.store(0);
+            auto started = Clock::now();
+            body();
+            return static_cast<double>(samples.load()) / std::chrono::duration<double>(Clock::now() - started).count();
+        };
+
+        double rates[2][2];     // [binary][stream]
+        std::cout.setstate(std::ios::failbit);
+        for (bool binary : {false, true}) {
+            controller.setBinaryProtocol(binary);
+            if (controller.binaryActive() != binary) {
+                std::cout.clear();
+                std::cerr << "wire_link could not switch the sample format" << std::endl;
+                std::exit(1);
+            }
+
+            rates[binary][0] = measure([&]() {
+                auto end = Clock::now() + std::chrono::milliseconds(800);
+                while (Clock::now() < end) {
+                    controller.pollAllControllers();
+                }
+            });
+
+            emulator.setStreamRate(2000);
+            controller.startMonitoring(insen::all_controllers, 100, insen::MonitorMode::Stream);
+            std::this_thread::sleep_for(std::chrono::milliseconds(200)); // Fill the link
+            rates[binary][1] = measure([]() { std::this_thread::sleep_for(std::chrono::seconds(1)); });
+            controller.stopMonitoring();
+            emulator.setStreamRate(0);
+            std::this_thread::sleep_for(std::chrono::milliseconds(100)); // Let the backlog drain
+        }
+        std::cout.clear();
+        disconnectQuietly(controller);
+
+        std::string name = "wire_link.baud" + std::to_string(baud);
+        for (int stream = 0; stream < 2; stream++) {
+            const char* kind = stream ? "stream" : "poll";
+            report(name + "." + kind + ".text", rates[0][stream], "samples/s");
+            report(name + "." + kind + ".binary", rates[1][stream], "samples/s");
+            std::printf("wire_link baud=%-7d %-6s text %6.0f samples/s  binary %6.0f samples/s  (%.2fx)\n",
+                        baud, kind, rates[0][stream], rates[1][stream], rates[1][stream] / rates[0][stream]);
+        }
+    }
+}
+
+// Controller::probeLink over emulated links at standard and non-standard
+// rates (1843200 needs termios2), in text and binary. Checks the port
+// reports the rate that was asked for.
+void benchLinkProbe() {
+    for (int baud : {115200, 921600, 1843200, 3000000}) {
+        insen::EmulatorConfig config;
+        config.baud_rate = baud;
+        insen::DeviceEmulator emulator(config);
+        emulator.start();
+
+        insen::Controller controller(emulator.ports().at(0), baud);
+        if (!connectQuietly(controller)) {
+            continue;
+        }
+        int configured = controller.linkBaudRate();
+        if (configured != baud) {
+            disconnectQuietly(controller);
+            std::cerr << "link_probe asked for " << baud << " baud, port reports " << configured << std::endl;
+            std::exit(1);
+        }
+
+        for (bool binary : {false, true}) {
+            std::cout.setstate(std::ios::failbit);
+            controller.setBinaryProtocol(binary);
+            insen::LinkProbeResult result = controller.probeLink(std::chrono::milliseconds(400));
+            std::cout.clear();
+
+            std::string name = "link_probe.baud" + std::to_string(baud) + (binary ? ".binary" : ".text");
+            double rtt_us = static_cast<double>(result.rtt.percentile(50)) / 1000.0;
+            double utilization = result.bytes_per_sec / (baud / 10.0);
+            report(name + ".rtt_p50", rtt_us, "us");
+            report(name + ".samples", result.samples_per_sec, "samples/s");
+            report(name + ".bytes", result.bytes_per_sec, "bytes/s");
+            std::printf("link_probe baud=%-8d %-6s rtt p50 %6.0f us  %7.0f samples/s  %8.0f bytes/s (%.0f%% of line)\n",
+                        baud, binary ? "binary" : "text", rtt_us, result.samples_per_sec, result.bytes_per_sec,
+                        utilization * 100.0);
+        }
+        disconnectQuietly(controller);
+    }
+}
+
+// The C library from several threads, one client and board each: every
+// thread checks its own INFO/STATUS/LIST/GET results, which strtok's shared
+// state used to corrupt. Then one GET round trip per controller against
+// insen_get_all_inputs' single pipelined exchange, over a link with 1 ms of
+// transport delay. Binary samples, which the C text parser reads correctly.
+void benchCClient() {
+    constexpr int pads = 4;
+    constexpr size_t threads = 4;
+    insen::EmulatorConfig config;
+    config.controllers = pads;
+    insen::DeviceEmulator emulator(config, threads);
+    emulator.start();
+
+    std::atomic<bool> failed{false};
+    std::atomic<size_t> exchanges{0};
+    std::vector<std::thread> workers;
+    auto started = Clock::now();
+    for (size_t t = 0; t < threads; t++) {
+        workers.emplace_back([&, port = emulator.ports().at(t)]() {
+            insen_client_t client;
+            if (insen_init(&client, port.c_str()) != INSEN_SUCCESS) {
+                failed.store(true);
+                return;
+            }
+            insen_set_binary(&client, 1);
+
+            for (int round = 0; round < 200 && !failed.load(); round++) {
+                insen_firmware_info_t info;
+                insen_system_status_t status;
+                insen_controller_info_t list[INSEN_MAX_CONTROLLERS];
+                insen_controller_state_t states[INSEN_MAX_CONTROLLERS];
+                int listed = 0, polled = 0;
+
+                bool ok = insen_get_firmware_info(&client, &info) == INSEN_SUCCESS &&
+                          std::strcmp(info.version, config.firmware_version.c_str()) == 0 && info.status_ok &&
+                          insen_get_status(&client, &status) == INSEN_SUCCESS &&
+                          status.active_controllers == pads && status.free_heap == 234567 &&
+                          insen_list_controllers(&client, list, &listed) == INSEN_SUCCESS && listed == pads &&
+                          std::strcmp(list[1].type, "PS4") == 0 &&
+                          insen_get_all_inputs(&client, states, pads, &polled) == INSEN_SUCCESS && polled == pads;
+                for (int i = 0; ok && i < polled; i++) {
+                    ok = states[i].controller_id == i && states[i].timestamp > 0;
+                }
+                if (!ok) {
+                    failed.store(true);
+                }
+                exchanges.fetch_add(4 + pads, std::memory_order_relaxed);
+            }
+            insen_cleanup(&client);
+        });
+    }
+    for (auto& worker : workers) {
+        worker.join();
+    }
+    double threaded_rate = static_cast<double>(exchanges.load()) /
+                           std::chrono::duration<double>(Clock::now() - started).count();
+    if (failed.load()) {
+        std::cerr << "c_client returned wrong results with one client per thread" << std::endl;
+        std::exit(1);
+    }
+
+    insen::EmulatorConfig usb_config;
+    usb_config.controllers = pads;
+    usb_config.setLatency(std::chrono::microseconds(100));
+    usb_config.link_delay = std::chrono::milliseconds(1);
+    insen::DeviceEmulator usb(usb_config);
+    usb.start();
+
+    insen_client_t client;
+    if (insen_init(&client, usb.ports().at(0).c_str()) != INSEN_SUCCESS) {
+        return;
+    }
+    insen_set_binary(&client, 1);
+
+    auto rate = [&](auto&& round) {
+        size_t samples = 0;
+        auto begin = Clock::now();
+        while (Clock::now() - begin < std::chrono::milliseconds(800)) {
+            samples += static_cast<size_t>(round());
+        }
+        return static_cast<double>(samples) / std::chrono::duration<double>(Clock::now() - begin).count();
+    };
+    double sequential = rate([&]() {
+        int received = 0;
+        for (int id = 0; id < pads; id++) {
+            insen_controller_state_t state;
+            received += insen_get_controller_input(&client, id, &state) == INSEN_SUCCESS;
+        }
+        return received;
+    });
+    double batched = rate([&]() {
+        insen_controller_state_t states[INSEN_MAX_CONTROLLERS];
+        int polled = 0;
+        insen_get_all_inputs(&client, states, pads, &polled);
+        return polled;
+    });
+    insen_cleanup(&client);
+
+    report("c_client.threaded", threaded_rate, "exchanges/s");
+    report("c_client.usb_delay.sequential", sequential, "samples/s");
+    report("c_client.usb_delay.get_all_inputs", batched, "samples/s");
+    std::printf("c_client %zu threads      %7.0f exchanges/s (results checked)\n", threads, threaded_rate);
+    std::printf("c_client usb_delay=1ms   one GET at a time %6.0f samples/s  get_all_inputs %6.0f samples/s  (%.2fx)\n",
+                sequential, batched, batched / sequential);
+}
+
+// One board driven through the asynchronous C API; its completion callback
+// keeps the window of GETs full by submitting the next one
+struct AsyncBoard {
+    insen_client_t client;
+    size_t samples = 0;
+    size_t pushed = 0;
+    bool failed = false;
+    bool stop = false;
+};
+
+void asyncResubmit(insen_client_t* client, const insen_completion_t* completion, void* user_data) {
+    auto* board = static_cast<AsyncBoard*>(user_data);
+    if (completion->status != INSEN_SUCCESS || completion->type != INSEN_COMMAND_GET ||
+        completion->state.timestamp == 0) {
+        board->failed = true;
+        return;
+    }
+    board->samples++;
+    if (!board->stop) {
+        insen_submit_get(client, (completion->controller_id + 1) % INSEN_MAX_CONTROLLERS, asyncResubmit, board);
+    }
+}
+
+void asyncCountPush(insen_client_t*, const insen_completion_t* completion, void* user_data) {
+    auto* board = static_cast<AsyncBoard*>(user_data);
+    if (completion->status == INSEN_SUCCESS) {
+        board->pushed++;
+    } else {
+        board->failed = true;
+    }
+}
+
+// One poll() round over every board's descriptor, then a process step each
+void asyncPollRound(std::vector<AsyncBoard>& boards) {
+    std::vector<struct pollfd> fds;
+    int timeout_ms = 50;
+    for (auto& board : boards) {
+        short events = POLLIN;
+        if (insen_wants_write(&board.client)) {
+            events |= POLLOUT;
+        }
+        fds.push_back({insen_get_fd(&board.client), events, 0});
+        int next = insen_next_timeout(&board.client);
+        if (next >= 0 && next < timeout_ms) {
+            timeout_ms = next;
+        }
+    }
+    poll(fds.data(), fds.size(), timeout_ms);
+    for (size_t i = 0; i < boards.size(); i++) {
+        if (fds[i].revents != 0 && insen_process(&boards[i].client) < 0) {
+            boards[i].failed = true;
+        }
+    }
+}
+
+// Several USB-like boards (1 ms link delay) from one thread: the blocking
+// get_all_inputs visiting them in turn, against one poll() loop over the
+// asynchronous API with a window of GETs in flight per board. Also checks
+// that pushed samples reach the push callback while blocking calls run.
+void benchCAsync() {
+    constexpr size_t board_count = 4;
+    constexpr int window = 8;
+    insen::EmulatorConfig config;
+    config.controllers = INSEN_MAX_CONTROLLERS;
+    config.setLatency(std::chrono::microseconds(100));
+    config.link_delay = std::chrono::milliseconds(1);
+    insen::DeviceEmulator emulator(config, board_count);
+    emulator.start();
+
+    std::vector<AsyncBoard> boards(board_count);
+    for (size_t i = 0; i < board_count; i++) {
+        if (insen_init(&boards[i].client, emulator.ports().at(i).c_str()) != INSEN_SUCCESS) {
+            return;
+        }
+        insen_set_binary(&boards[i].client, 1);
+    }
+
+    auto measure = std::chrono::milliseconds(800);
+    size_t blocking_samples = 0;
+    auto begin = Clock::now();
+    while (Clock::now() - begin < measure) {
+        for (auto& board : boards) {
+            insen_controller_state_t states[INSEN_MAX_CONTROLLERS];
+            int polled = 0;
+            insen_get_all_inputs(&board.client, states, INSEN_MAX_CONTROLLERS, &polled);
+            blocking_samples += static_cast<size_t>(polled);
+        }
+    }
+    double blocking = static_cast<double>(blocking_samples) /
+                      std::chrono::duration<double>(Clock::now() - begin).count();
+
+    for (auto& board : boards) {
+        for (int i = 0; i < window; i++) {
+            insen_submit_get(&board.client, i % INSEN_MAX_CONTROLLERS, asyncResubmit, &board);
+        }
+    }
+    begin = Clock::now();
+    while (Clock::now() - begin < measure) {
+        asyncPollRound(boards);
+    }
+    double elapsed = std::chrono::duration<double>(Clock::now() - begin).count();
+    size_t async_samples = 0;
+    for (auto& board : boards) {
+        async_samples += board.samples;
+        board.stop = true;
+    }
+    double async_rate = static_cast<double>(async_samples) / elapsed;
+
+    // Drain: every outstanding GET must still complete
+    auto drain_deadline = Clock::now() + std::chrono::seconds(1);
+    auto outstanding = [&]() {
+        int pending = 0;
+        for (auto& board : boards) {
+            pending += insen_pending_count(&board.client);
+        }
+        return pending;
+    };
+    while (outstanding() > 0 && Clock::now() < drain_deadline) {
+        asyncPollRound(boards);
+    }
+    bool failed = outstanding() > 0;
+    for (auto& board : boards) {
+        failed = failed || board.failed;
+        insen_cleanup(&board.client);
+    }
+    if (failed) {
+        std::cerr << "c_async lost or corrupted a completion" << std::endl;
+        std::exit(1);
+    }
+
+    // A streaming board: pushed samples go to the push callback, and the
+    // blocking STATUS calls in between still get their own replies
+    insen::EmulatorConfig stream_config;
+    stream_config.controllers = 2;
+    insen::DeviceEmulator streaming(stream_config);
+    streaming.start();
+    std::vector<AsyncBoard> stream_board(1);
+    insen_client_t* client = &stream_board[0].client;
+    if (insen_init(client, streaming.ports().at(0).c_str()) != INSEN_SUCCESS) {
+        return;
+    }
+    insen_set_binary(client, 1);
+    insen_set_push_callback(client, asyncCountPush, &stream_board[0]);
+    streaming.setStreamRate(500.0);
+    int status_ok = 0;
+    for (int i = 0; i < 20; i++) {
+        insen_system_status_t status;
+        status_ok += insen_get_status(client, &status) == INSEN_SUCCESS && status.free_heap == 234567;
+        std::this_thread::sleep_for(std::chrono::milliseconds(5));
+    }
+    insen_process(client);
+    streaming.setStreamRate(0.0);
+    insen_cleanup(client);
+    if (status_ok != 20 || stream_board[0].pushed == 0 || stream_board[0].failed) {
+        std::cerr << "c_async mixed up pushed samples and replies (" << status_ok << "/20 STATUS, "
+                  << stream_board[0].pushed << " pushed)" << std::endl;
+        std::exit(1);
+    }
+
+    report("c_async.blocking_round_robin", blocking, "samples/s");
+    report("c_async.poll_loop", async_rate, "samples/s");
+    report("c_async.pushed", static_cast<double>(stream_board[0].pushed), "samples");
+    std::printf("c_async %zu boards usb_delay=1ms  blocking round robin %6.0f samples/s  "
+                "poll loop (window %d) %6.0f samples/s  (%.2fx)\n",
+                board_count, blocking, window, async_rate, async_rate / blocking);
+    std::printf("c_async push callback     %zu pushed samples, %d/20 STATUS replies matched\n",
+                stream_board[0].pushed, status_ok);
+}
+
+// Event-driven monitoring at 50 Hz on a 115200 baud board, alone and
+// while a second thread sends STATUS and LIST through sendCommand(). The
+// Input lane's wait is how late each GET went out; the round trip comes
+// from the controller's own histogram.
+void benchCommandLanes() {
+    insen::EmulatorConfig config;
+    config.baud_rate = 115200;
+    insen::DeviceEmulator emulator(config);
+    emulator.start();
+
+    for (bool admin_load : {false, true}) {
+        // A fresh controller per run, so the lane statistics start at zero
+        insen::Controller controller(emulator.ports().at(0));
+        if (!connectQuietly(controller)) {
+            return;
+        }
+        controller.latencyStats().reset();
+
+        std::cout.setstate(std::ios::failbit);
+        controller.startMonitoring(0, 50, insen::MonitorMode::EventDriven);
+
+        std::atomic<bool> running(true);
+        std::atomic<uint64_t> admin_commands(0);
+        std::thread admin;
+        if (admin_load) {
+            admin = std::thread([&]() {
+                while (running.load()) {
+                    for (const char* command : {"STATUS", "LIST"}) {
+                        try {
+                            admin_commands += !controller.sendCommand(command).empty();
+                        } catch (const std::exception&) {
+                            return;
+                        }
+                    }
+                }
+            });
+        }
+
+        std::this_thread::sleep_for(std::chrono::seconds(1));
+        running.store(false);
+        if (admin.joinable()) {
+            admin.join();
+        }
+        controller.stopMonitoring();
+        std::cout.clear();
+
+        insen::LaneStats input = controller.laneStats(insen::CommandLane::Input);
+        insen::LatencySnapshot snap =
+            controller.latencyStats().histogram(insen::CommandType::Get, 0, insen::LatencyMetric::Line).snapshot();
+        disconnectQuietly(controller);
+        if (input.acquisitions == 0 || snap.total == 0) {
+            continue;
+        }
+
+        const char* label = admin_load ? "admin_load" : "idle";
+        std::string name = std::string("command_lanes.") + label;
+        report(name + ".get_p50", snap.percentile(50) / 1e3, "us");
+        report(name + ".get_p99", snap.percentile(99) / 1e3, "us");
+        report(name + ".lane_wait_mean", input.meanWaitNs() / 1e3, "us");
+        report(name + ".lane_wait_max", static_cast<double>(input.max_wait_ns) / 1e3, "us");
+        report(name + ".admin_commands", static_cast<double>(admin_commands.load()), "commands");
+        std::printf("command_lanes %-11s GET p50 %.0f us  p99 %.0f us  late by mean %.0f us  max %.0f us  "
+                    "(%llu admin)\n",
+                    label, snap.percentile(50) / 1e3, snap.percentile(99) / 1e3, input.meanWaitNs() / 1e3,
+                    static_cast<double>(input.max_wait_ns) / 1e3,
+                    static_cast<unsigned long long>(admin_commands.load()));
+    }
+}
+
+void benchHubScaling() {
+    for (size_t reactors : {1, 2}) {
+        for (size_t boards : {1, 2, 4, 8, 16, 32}) {
+            insen::DeviceEmulator emulator(insen::EmulatorConfig(), boards);
+            emulator.start();
+            insen::ControllerHub hub;
+
+            std::cout.setstate(std::ios::failbit); // Silence hub chatter
+            for (const auto& port : emulator.ports()) {
+                hub.addDevice(port, {0});
+            }
+            hub.start(0, reactors);
+            std::this_thread::sleep_for(std::chrono::milliseconds(200));
+            uint64_t before = hub.samplesReceived();
+            auto start = Clock::now();
+            std::this_thread::sleep_for(std::chrono::milliseconds(500));
+            uint64_t samples = hub.samplesReceived() - before;
+            double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+            hub.stop();
+            std::cout.clear();
+
+            report("hub_scaling.reactors" + std::to_string(reactors) + ".boards" + std::to_string(boards),
+                   samples / seconds, "samples/s");
+            std::printf("hub_scaling reactors=%zu boards=%-3zu %10.0f samples/s\n",
+                        reactors, boards, samples / seconds);
+        }
+    }
+}
+#endif
+
+std::string jsonEscape(const std::string& text) {
+    std::string escaped;
+    for (char c : text) {
+        if (c == '"' || c == '\\') {
+            escaped += '\\';
+        }
+        escaped += (static_cast<unsigned char>(c) < 0x20) ? ' ' : c;
+    }
+    return escaped;
+}
+
+bool writeJson(const std::string& path) {
+    std::FILE* file = std::fopen(path.c_str(), "w");
+    if (!file) {
+        return false;
+    }
+
+#if defined(__VERSION__)
+    std::string compiler = __VERSION__;
+#else
+    std::string compiler = "unknown";
+#endif
+    auto now = std::chrono::duration_cast<std::chrono::seconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count();
+
+    std::fprintf(file, "{\n  \"suite\": \"insen_bench\",\n  \"schema\": 1,\n");
+    std::fprintf(file, "  \"compiler\": \"%s\",\n  \"timestamp\": %lld,\n  \"metrics\": [\n",
+                 jsonEscape(compiler).c_str(), static_cast<long long>(now));
+    for (size_t i = 0; i < metrics.size(); i++) {
+        const Metric& metric = metrics[i];
+        std::fprintf(file, "    {\"name\": \"%s\", \"value\": ", jsonEscape(metric.name).c_str());
+        if (std::isfinite(metric.value)) {
+            std::fprintf(file, "%.6g", metric.value);
+        } else {
+            std::fprintf(file, "null");
+        }
+        std::fprintf(file, ", \"unit\": \"%s\"}%s\n", jsonEscape(metric.unit).c_str(),
+                     i + 1 < metrics.size() ? "," : "");
+    }
+    std::fprintf(file, "  ]\n}\n");
+    return std::fclose(file) == 0;
+}
+
+struct Benchmark {
+    const char* name;
+    void (*run)();
+};
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    std::string filter;
+    std::string json_path;
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "--filter" && i + 1 < argc) {
+            filter = argv[++i];
+        } else if (arg == "--json" && i + 1 < argc) {
+            json_path = argv[++i];
+        } else {
+            std::cerr << "Usage: " << argv[0] << " [--filter TEXT] [--json FILE]" << std::endl;
+            return 1;
+        }
+    }
+
+    const Benchmark benchmarks[] = {
+        {"parse_input", benchParseInput},
+        {"wire_codec", benchWireCodec},
+        {"protocol_core", benchProtocolCore},
+        {"batch_parse", benchBatchParse},
+        {"button_names", benchButtonDecode},
+        {"state_publish", benchStatePublish},
+        {"scheduler", benchScheduler},
+        {"change_filter", benchChangeFilter},
+        {"history", benchHistory},
+        {"latency_histogram", benchLatencyHistogram},
+        {"clock_sync", benchClockSync},
+        {"recording", benchRecording},
+        {"replay", benchReplay},
+#ifdef __linux__
+        {"get_rtt", benchGetRoundTrip},
+        {"monitor", benchMonitorLoop},
+        {"poll_all", benchPollAll},
+        {"stream", benchStream},
+        {"wire_link", benchWireLink},
+        {"link_probe", benchLinkProbe},
+        {"c_client", benchCClient},
+        {"c_async", benchCAsync},
+        {"hub_scaling", benchHubScaling},
+        {"command_lanes", benchCommandLanes},
+#endif
+    };
+
+    std::cout << "INSEN Client Benchmarks" << std::endl;
+    for (const Benchmark& benchmark : benchmarks) {
+        if (filter.empty() || std::string(benchmark.name).find(filter) != std::string::npos) {
+            benchmark.run();
+        }
+    }
+
+    if (!json_path.empty()) {
+        if (!writeJson(json_path)) {
+            std::cerr << "Failed to write " << json_path << std::endl;
+            return 1;
+        }
+        std::cout << "Wrote " << metrics.size() << " metrics to " << json_path << std::endl;
+    }
+    return 0;
+}
@@ -0,0 +1,187 @@
+/*
+ * INSEN Controller Client - Change detection
+ * //madebybunnyrce
+ * Turns the raw poll stream into change events: button-down/up edges,
+ * dpad and battery changes, and analog moves larger than a per-axis
+ * deadzone. Identical samples are rejected with a two-word XOR against
+ * the last reported state, so idle polls cost a few instructions.
+ */
+
+#ifndef INSEN_CHANGE_FILTER_HPP
+#define INSEN_CHANGE_FILTER_HPP
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+
+#include "insen_state.hpp"
+
+namespace insen {
+
+// Minimum movement, in raw units, before an axis counts as moved
+struct Deadzones {
+    uint16_t left_stick_x = 0, left_stick_y = 0;
+    uint16_t right_stick_x = 0, right_stick_y = 0;
+    uint8_t left_trigger = 0, right_trigger = 0;
+
+    static Deadzones uniform(uint16_t stick, uint8_t trigger) {
+        Deadzones zones;
+        zones.left_stick_x = zones.left_stick_y = stick;
+        zones.right_stick_x = zones.right_stick_y = stick;
+        zones.left_trigger = zones.right_trigger = trigger;
+        return zones;
+    }
+};
+
+struct ChangeEvent {
+    enum : uint8_t {
+        LeftStick = 1 << 0,
+        RightStick = 1 << 1,
+        Triggers = 1 << 2,
+        Buttons = 1 << 3,
+        Dpad = 1 << 4,
+        Battery = 1 << 5,
+        FirstSample = 1 << 6    // First state seen for this controller id
+    };
+
+    ControllerState state;      // The full current state
+    uint16_t buttons_down;      // Pressed since the last event
+    uint16_t buttons_up;        // Released since the last event
+    uint8_t changes;            // Bitwise OR of the flags above
+
+    bool analogMoved() const {
+        return (changes & (LeftStick | RightStick | Triggers)) != 0;
+    }
+};
+
+class ChangeFilter {
+private:
+    // Sticks, triggers, buttons, dpad and battery: everything but id/timestamp
+    static constexpr size_t compared_bytes = offsetof(ControllerState, id);
+    static_assert(compared_bytes <= 16, "compared fields must fit in two words");
+
+    struct Slot {
+        uint64_t words[2];
+        ControllerState reference;  // Last reported value of each field
+        bool seen;
+    };
+
+    std::array<Slot, 256> slots;
+    Deadzones deadzones;
+    uint64_t samples;
+    uint64_t events;
+
+    static void pack(const ControllerState& state, uint64_t (&words)[2]) {
+        words[0] = words[1] = 0;
+        std::memcpy(words, &state, compared_bytes);
+    }
+
+    static bool beyond(int current, int reference, int deadzone) {
+        return std::abs(current - reference) > deadzone;
+    }
+
+public:
+    explicit ChangeFilter(const Deadzones& zones = Deadzones()) : deadzones(zones) {
+        reset();
+    }
+
+    void setDeadzones(const Deadzones& zones) {
+        deadzones = zones;
+    }
+
+    const Deadzones& getDeadzones() const {
+        return deadzones;
+    }
+
+    // Forget every controller; the next sample of each is a FirstSample
+    void reset() {
+        for (auto& slot : slots) {
+            slot.words[0] = slot.words[1] = 0;
+            slot.reference = ControllerState{};
+            slot.seen = false;
+        }
+        samples = events = 0;
+    }
+
+    // Feed one polled state. Returns true and fills event if anything
+    // changed beyond the deadzones since the last event for this id.
+    bool update(const ControllerState& state, ChangeEvent& event) {
+        samples++;
+        Slot& slot = slots[state.id];
+
+        uint64_t words[2];
+        pack(state, words);
+
+        if (slot.seen && ((words[0] ^ slot.words[0]) | (words[1] ^ slot.words[1])) == 0) {
+            return false; // Idle poll: identical to the last reported state
+        }
+
+        ControllerState& ref = slot.reference;
+        uint8_t changes = 0;
+
+        if (!slot.seen) {
+            changes = ChangeEvent::FirstSample | ChangeEvent::LeftStick | ChangeEvent::RightStick |
+                      ChangeEvent::Triggers | ChangeEvent::Buttons | ChangeEvent::Dpad | ChangeEvent::Battery;
+            ref = state;
+            slot.seen = true;
+            event.buttons_down = state.buttons;
+            event.buttons_up = 0;
+        } else {
+            // Analog groups keep their old reference until they move far
+            // enough, so slow drift still adds up to a reported move
+            if (beyond(state.left_stick_x, ref.left_stick_x, deadzones.left_stick_x) ||
+                beyond(state.left_stick_y, ref.left_stick_y, deadzones.left_stick_y)) {
+                changes |= ChangeEvent::LeftStick;
+                ref.left_stick_x = state.left_stick_x;
+                ref.left_stick_y = state.left_stick_y;
+            }
+            if (beyond(state.right_stick_x, ref.right_stick_x, deadzones.right_stick_x) ||
+                beyond(state.right_stick_y, ref.right_stick_y, deadzones.right_stick_y)) {
+                changes |= ChangeEvent::RightStick;
+                ref.right_stick_x = state.right_stick_x;
+                ref.right_stick_y = state.right_stick_y;
+            }
+            if (beyond(state.left_trigger, ref.left_trigger, deadzones.left_trigger) ||
+                beyond(state.right_trigger, ref.right_trigger, deadzones.right_trigger)) {
+                changes |= ChangeEvent::Triggers;
+                ref.left_trigger = state.left_trigger;
+                ref.right_trigger = state.right_trigger;
+            }
+
+            uint16_t flipped = static_cast<uint16_t>(state.buttons ^ ref.buttons);
+            event.buttons_down = static_cast<uint16_t>(flipped & state.buttons);
+            event.buttons_up = static_cast<uint16_t>(flipped & ref.buttons);
+            changes |= flipped ? ChangeEvent::Buttons : 0;
+            changes |= (state.dpad != ref.dpad) ? ChangeEvent::Dpad : 0;
+            changes |= (state.battery != ref.battery) ? ChangeEvent::Battery : 0;
+            ref.buttons = state.buttons;
+            ref.dpad = state.dpad;
+            ref.battery = state.battery;
+        }
+
+        pack(ref, slot.words);
+
+        if (changes == 0) {
+            return false; // Analog jitter inside the deadzones
+        }
+
+        event.state = state;
+        event.changes = changes;
+        events++;
+        return true;
+    }
+
+    uint64_t samplesSeen() const {
+        return samples;
+    }
+
+    uint64_t eventsEmitted() const {
+        return events;
+    }
+};
+
+} // namespace insen
+
+#endif // INSEN_CHANGE_FILTER_HPP
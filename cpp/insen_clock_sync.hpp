@@ -0,0 +1,226 @@
+/*
+ * INSEN Controller Client - Device clock synchronization
+ * //madebybunnyrce
+ * Maps the firmware's 32-bit sample timestamp onto the host steady_clock.
+ * Each GET round trip brackets the moment the device took its sample, so
+ * (device time, host midpoint) pairs from the fastest round trips are
+ * fitted with a line: the intercept is the clock offset, the slope the
+ * drift. Timestamp wrap-around is unwrapped.
+ */
+
+#ifndef INSEN_CLOCK_SYNC_HPP
+#define INSEN_CLOCK_SYNC_HPP
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <vector>
+
+namespace insen {
+
+struct ClockEstimate {
+    bool synchronized = false;
+    int64_t offset_ns = 0;          // Host time minus device time, at the latest sample
+    double drift_ppm = 0.0;         // How much faster the host clock runs
+    int64_t uncertainty_ns = 0;     // Half the best round trip plus half a tick
+    size_t samples = 0;             // Round trips seen since the last reset
+};
+
+class ClockSync {
+private:
+    struct SyncPoint {
+        int64_t device_ns;          // Middle of the device tick
+        int64_t host_ns;            // Midpoint of the round trip
+        int64_t rtt_ns;
+    };
+
+    mutable std::mutex mutex;
+    int64_t tick_ns;
+    int64_t bin_ns;
+    size_t window;
+    std::vector<SyncPoint> points;  // Ring of the best round trip per closed bin
+    size_t next;
+    SyncPoint current;              // Best round trip in the open bin
+    int64_t current_bin;
+    size_t round_trips;
+
+    bool have_ticks;
+    uint32_t last_ticks;
+    int64_t last_unwrapped;
+
+    // Fitted model: host = device + offset + drift * (device - reference)
+    bool fitted;
+    int64_t reference_ns;
+    double offset;
+    double drift;
+    int64_t best_rtt_ns;
+
+    static int64_t toNs(std::chrono::steady_clock::time_point time) {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(time.time_since_epoch()).count();
+    }
+
+    // Unwrap relative to the newest timestamp seen; the device clock is
+    // assumed not to jump by more than half its range between samples
+    int64_t unwrap(uint32_t ticks) const {
+        if (!have_ticks) {
+            return ticks;
+        }
+        return last_unwrapped + static_cast<int32_t>(ticks - last_ticks);
+    }
+
+    void refit() {
+        best_rtt_ns = current.rtt_ns;
+        for (const auto& point : points) {
+            best_rtt_ns = point.rtt_ns < best_rtt_ns ? point.rtt_ns : best_rtt_ns;
+        }
+
+        // Skip bins whose best round trip was still slow; those mostly
+        // measure queueing, not the clocks
+        int64_t slack = best_rtt_ns / 2 > 50000 ? best_rtt_ns / 2 : 50000;
+        int64_t limit = best_rtt_ns + slack;
+
+        double n = 0, sx = 0, sy = 0, sxx = 0, sxy = 0;
+        reference_ns = current.device_ns;
+
+        auto add = [&](const SyncPoint& point) {
+            if (point.rtt_ns > limit) {
+                return;
+            }
+            double x = static_cast<double>(point.device_ns - reference_ns);
+            double y = static_cast<double>(point.host_ns - point.device_ns);
+            n += 1;
+            sx += x;
+            sy += y;
+            sxx += x * x;
+            sxy += x * y;
+        };
+        for (const auto& point : points) {
+            add(point);
+        }
+        add(current);
+
+        double denominator = n * sxx - sx * sx;
+        if (n >= 3 && denominator > 0) {
+            drift = (n * sxy - sx * sy) / denominator;
+        }
+        offset = (sy - drift * sx) / n;
+        fitted = true;
+    }
+
+public:
+    // tick is the firmware timestamp unit (milliseconds unless configured).
+    // The fastest round trip of every bin of device time is kept, for the
+    // last window bins, so drift is measured over a long baseline without
+    // tick quantization swamping it.
+    explicit ClockSync(std::chrono::nanoseconds tick = std::chrono::milliseconds(1),
+                       std::chrono::nanoseconds bin = std::chrono::seconds(1), size_t window_size = 64)
+        : tick_ns(tick.count() > 0 ? tick.count() : 1), bin_ns(bin.count() > 0 ? bin.count() : 1),
+          window(window_size > 0 ? window_size : 1) {
+        reset();
+    }
+
+    // Change the firmware timestamp unit; drops all round trips so far
+    void setTickPeriod(std::chrono::nanoseconds tick) {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            tick_ns = tick.count() > 0 ? tick.count() : 1;
+        }
+        reset();
+    }
+
+    void reset() {
+        std::lock_guard<std::mutex> lock(mutex);
+        points.clear();
+        next = 0;
+        current = SyncPoint{0, 0, INT64_MAX};
+        current_bin = INT64_MIN;
+        round_trips = 0;
+        have_ticks = false;
+        last_ticks = 0;
+        last_unwrapped = 0;
+        fitted = false;
+        reference_ns = 0;
+        offset = drift = 0.0;
+        best_rtt_ns = 0;
+    }
+
+    // One GET round trip: request written at sent, reply line complete at
+    // received, device timestamp from the reply. Timestamp 0 means the
+    // firmware did not send one and is ignored.
+    void addSample(uint32_t device_ticks, std::chrono::steady_clock::time_point sent,
+                   std::chrono::steady_clock::time_point received) {
+        if (device_ticks == 0 || received < sent) {
+            return;
+        }
+
+        std::lock_guard<std::mutex> lock(mutex);
+        int64_t unwrapped = unwrap(device_ticks);
+        if (!have_ticks || unwrapped > last_unwrapped) {
+            last_unwrapped = unwrapped;
+            last_ticks = device_ticks;
+            have_ticks = true;
+        }
+
+        int64_t sent_ns = toNs(sent);
+        int64_t rtt_ns = toNs(received) - sent_ns;
+        SyncPoint point{unwrapped * tick_ns + tick_ns / 2, sent_ns + rtt_ns / 2, rtt_ns};
+        round_trips++;
+
+        int64_t bin = point.device_ns / bin_ns;
+        if (bin != current_bin) {
+            if (current.rtt_ns != INT64_MAX) {
+                if (points.size() < window) {
+                    points.push_back(current);
+                } else {
+                    points[next] = current;
+                }
+                next = (next + 1) % window;
+            }
+            current_bin = bin;
+            current = point;
+        } else if (point.rtt_ns <= current.rtt_ns) {
+            current = point;
+        } else {
+            return; // Model unchanged
+        }
+
+        refit();
+    }
+
+    bool synchronized() const {
+        std::lock_guard<std::mutex> lock(mutex);
+        return fitted;
+    }
+
+    // Host time at which the device took a sample stamped device_ticks, or
+    // fallback before the first round trip has been seen
+    std::chrono::steady_clock::time_point toHost(uint32_t device_ticks,
+                                                 std::chrono::steady_clock::time_point fallback) const {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (!fitted || device_ticks == 0) {
+            return fallback;
+        }
+
+        int64_t device_ns = unwrap(device_ticks) * tick_ns + tick_ns / 2;
+        double host_ns = static_cast<double>(device_ns) + offset +
+                         drift * static_cast<double>(device_ns - reference_ns);
+        return std::chrono::steady_clock::time_point(std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+            std::chrono::nanoseconds(static_cast<int64_t>(host_ns))));
+    }
+
+    ClockEstimate estimate() const {
+        std::lock_guard<std::mutex> lock(mutex);
+        ClockEstimate result;
+        result.synchronized = fitted;
+        result.offset_ns = static_cast<int64_t>(offset);
+        result.drift_ppm = drift * 1e6;
+        result.uncertainty_ns = fitted ? best_rtt_ns / 2 + tick_ns / 2 : 0;
+        result.samples = round_trips;
+        return result;
+    }
+};
+
+} // namespace insen
+
+#endif // INSEN_CLOCK_SYNC_HPP
@@ -0,0 +1,58 @@
+/*
+ * INSEN Controller Client - Command types
+ * //madebybunnyrce
+ * The kinds of command the firmware understands, shared by response
+ * matching and per-command statistics.
+ */
+
+#ifndef INSEN_COMMAND_HPP
+#define INSEN_COMMAND_HPP
+
+#include <cstddef>
+
+#include "insen_protocol.h"
+
+namespace insen {
+
+// Command kinds used to match pipelined responses back to their requests
+enum class CommandType {
+    Info,
+    Status,
+    List,
+    Get,
+    Version,
+    Help,
+    Other
+};
+
+constexpr size_t command_type_count = static_cast<size_t>(CommandType::Other) + 1;
+
+inline const char* commandTypeName(CommandType type) {
+    switch (type) {
+        case CommandType::Info: return "INFO";
+        case CommandType::Status: return "STATUS";
+        case CommandType::List: return "LIST";
+        case CommandType::Get: return "GET";
+        case CommandType::Version: return "VERSION";
+        case CommandType::Help: return "HELP";
+        case CommandType::Other: return "OTHER";
+    }
+    return "?";
+}
+
+// The protocol core's classification (insen_classify_command/_reply)
+inline CommandType commandTypeFrom(insen_command_t command) {
+    switch (command) {
+        case INSEN_COMMAND_INFO: return CommandType::Info;
+        case INSEN_COMMAND_STATUS: return CommandType::Status;
+        case INSEN_COMMAND_LIST: return CommandType::List;
+        case INSEN_COMMAND_GET: return CommandType::Get;
+        case INSEN_COMMAND_VERSION: return CommandType::Version;
+        case INSEN_COMMAND_HELP: return CommandType::Help;
+        default: return CommandType::Other;
+    }
+}
+
+} // namespace insen
+
+#endif // INSEN_COMMAND_HPP
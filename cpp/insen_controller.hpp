@@ -0,0 +1,1159 @@
+/*
+ * INSEN Controller Client - Controller
+ * //madebybunnyrce
+ * One INSEN board on one serial port: connection setup, command/response
+ * exchanges (single, pipelined and lane-arbitrated), input parsing and
+ * delivery, and the polling and event-driven monitor loops.
+ */
+
+#ifndef INSEN_CONTROLLER_HPP
+#define INSEN_CONTROLLER_HPP
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <functional>
+#include <iostream>
+#include <map>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+#include "insen_arbiter.hpp"
+#include "insen_change_filter.hpp"
+#include "insen_clock_sync.hpp"
+#include "insen_command.hpp"
+#include "insen_event_queue.hpp"
+#include "insen_latency.hpp"
+#include "insen_line_reader.hpp"
+#include "insen_parser.hpp"
+#include "insen_recording.hpp"
+#include "insen_scheduler.hpp"
+#include "insen_serial.hpp"
+#include "insen_state.hpp"
+#include "insen_state_table.hpp"
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <cerrno>
+#include <poll.h>
+#include <unistd.h>
+#ifdef __linux__
+#include <sys/eventfd.h>
+#include <sys/timerfd.h>
+#endif
+#endif
+
+namespace insen {
+
+// How the monitor thread paces requests and waits for responses
+enum class MonitorMode {
+    Polling,        // Send GET, block for the reply, sleep one frame
+    EventDriven,    // Timer-paced GETs, replies handled as soon as bytes arrive
+    Stream          // Consume INPUT lines the firmware pushes; poll only while none arrive
+};
+
+// startMonitoring() id that polls every connected controller each tick
+constexpr int all_controllers = -1;
+
+// What one link configuration achieved, from Controller::probeLink()
+struct LinkProbeResult {
+    int baud_rate = 0;              // As configured on the port (0 if unknown)
+    bool low_latency = false;
+    bool binary = false;
+    LatencySnapshot rtt;            // Single GET round trips
+    double samples_per_sec = 0.0;   // Back-to-back pipelined GETs
+    double bytes_per_sec = 0.0;     // Received while doing so
+};
+
+struct PendingCommand {
+    CommandType type;
+    int controller_id;      // Only meaningful for GET
+    size_t index;           // Position in the caller's batch
+    std::chrono::steady_clock::time_point sent_at;
+};
+
+class Controller {
+private:
+    std::string port_name;
+    int baud_rate;
+    bool low_latency;
+    bool is_connected;
+    StateTable<> controllers;     // Latest state per id, readable from any thread
+    std::function<void(const ControllerState&)> input_callback;
+    std::function<void(const ChangeEvent&)> change_callback;
+    ChangeFilter change_filter;   // Only used when change_callback is set
+    SpscQueue<ControllerState>* event_queue;
+    SessionRecorder* recorder;
+    std::string device_info;      // Last INFO response, for recording headers
+    bool binary_preferred;        // Negotiate binary samples on connect if offered
+    std::atomic<bool> binary_active;
+    std::atomic<bool> monitoring;
+    std::thread monitor_thread;
+    PollScheduler scheduler;      // Paces the monitor thread's GETs
+#if defined(__linux__)
+    int wake_fd;    // eventfd used to interrupt the event-driven monitor loop
+#endif
+
+    // Serializes exchanges between the monitor thread and other callers;
+    // the fields below are only touched while holding it
+    CommandArbiter arbiter;
+    LatencyStats<> latency;
+    ClockSync clock_sync;         // Firmware timestamp -> steady_clock
+
+    // Controller ids from the last LIST, for polling all controllers. Refreshed
+    // on a slow timer, or early once a GET reports DISCONNECTED.
+    mutable std::mutex topology_mutex;
+    std::vector<int> topology;
+    std::chrono::steady_clock::time_point topology_listed;
+    std::chrono::milliseconds topology_refresh;
+    std::atomic<bool> topology_stale;
+
+    // Pushed INPUT lines (stream mode)
+    std::atomic<uint64_t> pushed_samples;
+    std::atomic<int64_t> last_push_ns;
+    std::atomic<int64_t> stream_timeout_ns;
+
+    // Pipelining state
+    size_t pipeline_depth;
+    std::chrono::milliseconds response_timeout;
+    LineReader<> rx;
+    uint64_t bytes_read;          // Through readLine(), for probeLink()
+
+#ifdef _WIN32
+    HANDLE serial_handle;
+#else
+    int serial_fd;
+#endif
+
+    // Button name mapping
+    static inline const std::map<uint16_t, std::string> button_names = {
+        {0x01, "A"}, {0x02, "B"}, {0x04, "X"}, {0x08, "Y"},
+        {0x10, "LB"}, {0x20, "RB"}, {0x40, "SELECT"}, {0x80, "START"},
+        {0x100, "HOME"}, {0x200, "LSB"}, {0x400, "RSB"}
+    };
+
+    // Hand a parsed state to the consumers: queue and recorder first, so a
+    // slow callback cannot hold back queued consumers
+    void deliverState(const ControllerState& state) {
+        auto started = std::chrono::steady_clock::now();
+        if (state.sample_time != state.timestamp) {
+            latency.record(CommandType::Get, state.id, LatencyMetric::Age, started - state.sample_time);
+        }
+
+        if (event_queue) {
+            event_queue->tryPush(state);
+        }
+        if (recorder) {
+            recorder->record(state);
+        }
+        if (input_callback) {
+            input_callback(state);
+        }
+        if (change_callback) {
+            ChangeEvent event;
+            if (change_filter.update(state, event)) {
+                change_callback(event);
+            }
+        }
+
+        latency.record(CommandType::Get, state.id, LatencyMetric::Callback,
+                       std::chrono::steady_clock::now() - started);
+    }
+
+    void writeCommand(std::string_view command) {
+#ifdef _WIN32
+        std::string full_command(command);
+        full_command += "\r\n";
+
+        DWORD bytes_written;
+        if (!WriteFile(serial_handle, full_command.c_str(), static_cast<DWORD>(full_command.length()), &bytes_written, nullptr)) {
+            throw std::runtime_error("Failed to write to serial port");
+        }
+#else
+        if (!writeLine(serial_fd, command)) {
+            throw std::runtime_error("Failed to write to serial port");
+        }
+#endif
+    }
+
+    // Read one "\r\n"-terminated line from the persistent receive buffer.
+    // The view points into rx and stays valid until the next readLine().
+    // If first_byte is given and still unset, it receives the time new
+    // bytes were first read.
+    bool readLine(std::string_view& line, std::chrono::steady_clock::time_point deadline,
+                  std::chrono::steady_clock::time_point* first_byte = nullptr) {
+        while (!rx.nextLine(line)) {
+            auto now = std::chrono::steady_clock::now();
+            if (now >= deadline) {
+                return false;
+            }
+
+#ifdef _WIN32
+            char* dest = rx.writePtr();
+            DWORD bytes_read = 0;
+            if (!ReadFile(serial_handle, dest, static_cast<DWORD>(rx.writeSpace()), &bytes_read, nullptr)) {
+                return false;
+            }
+            rx.commit(static_cast<size_t>(bytes_read));
+            if (bytes_read > 0) {
+                markFirstByte(first_byte);
+            }
+#else
+            auto remaining = std::chrono::duration_cast<std::chrono::milliseconds>(deadline - now);
+            struct pollfd pfd = {serial_fd, POLLIN, 0};
+            if (poll(&pfd, 1, static_cast<int>(remaining.count()) + 1) <= 0) {
+                continue;
+            }
+            size_t before = rx.buffered();
+            if (!readAvailable(serial_fd, rx)) {
+                return false;
+            }
+            if (rx.buffered() > before) {
+                bytes_read += rx.buffered() - before;
+                markFirstByte(first_byte);
+            }
+#endif
+        }
+
+        return true;
+    }
+
+    void notePush() {
+        pushed_samples.fetch_add(1, std::memory_order_relaxed);
+        last_push_ns.store(std::chrono::steady_clock::now().time_since_epoch().count(), std::memory_order_relaxed);
+    }
+
+    // A line that answers no outstanding command
+    void deliverUnsolicited(std::string_view line) {
+        ControllerState state;
+        if (parseControllerInput(line, state)) {
+            notePush();
+            deliverState(state);
+        }
+    }
+
+    static void markFirstByte(std::chrono::steady_clock::time_point* first_byte) {
+        if (first_byte && *first_byte == std::chrono::steady_clock::time_point()) {
+            *first_byte = std::chrono::steady_clock::now();
+        }
+    }
+
+    // Record write-to-first-byte and write-to-line for one exchange; a reply
+    // that was already buffered counts as arriving with the line
+    void recordExchange(CommandType type, int controller_id,
+                        std::chrono::steady_clock::time_point sent_at,
+                        std::chrono::steady_clock::time_point first_byte) {
+        auto now = std::chrono::steady_clock::now();
+        if (first_byte == std::chrono::steady_clock::time_point()) {
+            first_byte = now;
+        }
+        latency.record(type, controller_id, LatencyMetric::FirstByte, first_byte - sent_at);
+        latency.record(type, controller_id, LatencyMetric::Line, now - sent_at);
+    }
+
+public:
+    Controller(const std::string& port = "COM3", int baudrate = 115200)
+        : port_name(port), baud_rate(baudrate), low_latency(true), is_connected(false), event_queue(nullptr),
+          recorder(nullptr), binary_preferred(true), binary_active(false), monitoring(false),
+          topology_refresh(2000), topology_stale(true),
+          pushed_samples(0), last_push_ns(0), stream_timeout_ns(50000000),
+          pipeline_depth(4), response_timeout(1000), bytes_read(0) {
+#ifdef _WIN32
+        serial_handle = INVALID_HANDLE_VALUE;
+#else
+        serial_fd = -1;
+#endif
+#if defined(__linux__)
+        wake_fd = -1;
+#endif
+    }
+
+    ~Controller() {
+        disconnect();
+    }
+
+    bool connect() {
+        try {
+#ifdef _WIN32
+            // Windows implementation
+            serial_handle = CreateFileA(
+                port_name.c_str(),
+                GENERIC_READ | GENERIC_WRITE,
+                0,
+                nullptr,
+                OPEN_EXISTING,
+                FILE_ATTRIBUTE_NORMAL,
+                nullptr
+            );
+
+            if (serial_handle == INVALID_HANDLE_VALUE) {
+                std::cerr << "Failed to open port " << port_name << std::endl;
+                return false;
+            }
+
+            DCB dcb = {};
+            dcb.DCBlength = sizeof(dcb);
+            
+            if (!GetCommState(serial_handle, &dcb)) {
+                std::cerr << "Failed to get comm state" << std::endl;
+                CloseHandle(serial_handle);
+                return false;
+            }
+
+            dcb.BaudRate = baud_rate;
+            dcb.ByteSize = 8;
+            dcb.Parity = NOPARITY;
+            dcb.StopBits = ONESTOPBIT;
+
+            if (!SetCommState(serial_handle, &dcb)) {
+                std::cerr << "Failed to set comm state" << std::endl;
+                CloseHandle(serial_handle);
+                return false;
+            }
+
+            COMMTIMEOUTS timeouts = {};
+            timeouts.ReadIntervalTimeout = 100;
+            timeouts.ReadTotalTimeoutConstant = 1000;
+            timeouts.ReadTotalTimeoutMultiplier = 0;
+            SetCommTimeouts(serial_handle, &timeouts);
+
+#else
+            // Linux/Unix implementation
+            SerialOptions options;
+            options.baud_rate = baud_rate;
+            options.low_latency = low_latency;
+            serial_fd = openSerialPort(port_name, options);
+            if (serial_fd < 0) {
+                return false;
+            }
+#endif
+
+            is_connected = true;
+            std::cout << "Connected to INSEN device on " << port_name << std::endl;
+            
+            // Get device info
+            std::this_thread::sleep_for(std::chrono::milliseconds(100));
+            getDeviceInfo();
+            if (binary_preferred) {
+                negotiateBinary(true);
+            }
+            
+            return true;
+
+        } catch (const std::exception& e) {
+            std::cerr << "Connection error: " << e.what() << std::endl;
+            return false;
+        }
+    }
+
+    void disconnect() {
+        stopMonitoring();
+        
+        if (is_connected) {
+#ifdef _WIN32
+            if (serial_handle != INVALID_HANDLE_VALUE) {
+                CloseHandle(serial_handle);
+                serial_handle = INVALID_HANDLE_VALUE;
+            }
+#else
+            if (serial_fd >= 0) {
+                close(serial_fd);
+                serial_fd = -1;
+            }
+#endif
+            is_connected = false;
+            binary_active.store(false);
+            std::cout << "Disconnected from INSEN device" << std::endl;
+        }
+    }
+
+    // Safe to call from any thread, including while monitoring: GET goes in
+    // the Input lane, everything else waits behind pending GETs.
+    std::string sendCommand(const std::string& command) {
+        if (!is_connected) {
+            throw std::runtime_error("Device not connected");
+        }
+
+        PendingCommand pending = classifyCommand(command, 0);
+        CommandArbiter::Guard guard(arbiter, laneFor(pending.type));
+
+        auto sent_at = std::chrono::steady_clock::now();
+        writeCommand(command);
+
+        std::string_view line;
+        std::chrono::steady_clock::time_point first_byte;
+        auto deadline = sent_at + response_timeout;
+        while (readLine(line, deadline, &first_byte)) {
+            if (responseMatches(pending, classifyResponse(line))) {
+                recordExchange(pending.type, pending.controller_id, sent_at, first_byte);
+                return std::string(line);
+            }
+            // A pushed INPUT line, or a late reply to an earlier command
+            // that timed out: deliver it if it is a sample, else skip it
+            deliverUnsolicited(line);
+        }
+
+        return "";
+    }
+
+    // Classify a command string so its response can be matched later
+    static PendingCommand classifyCommand(std::string_view command, size_t index) {
+        int controller_id;
+        insen_command_t type = insen_classify_command(command.data(), command.size(), &controller_id);
+        return PendingCommand{commandTypeFrom(type), controller_id, index, {}};
+    }
+
+    // Classify a response line (with or without the ">>> " prompt) or
+    // binary sample frame
+    static PendingCommand classifyResponse(std::string_view line) {
+        int controller_id;
+        insen_command_t type = insen_classify_reply(line.data(), line.size(), &controller_id);
+        return PendingCommand{commandTypeFrom(type), controller_id, 0, {}};
+    }
+
+    static CommandLane laneFor(CommandType type) {
+        return type == CommandType::Get ? CommandLane::Input : CommandLane::Admin;
+    }
+
+    // Untyped replies (errors, BINARY acks) are accepted for any command;
+    // an untyped command never takes a typed reply such as a pushed sample
+    static bool responseMatches(const PendingCommand& pending, const PendingCommand& reply) {
+        if (reply.type == CommandType::Other) {
+            return true;
+        }
+        return pending.type == reply.type &&
+               (reply.type != CommandType::Get || pending.controller_id == reply.controller_id);
+    }
+
+    // Latency histograms per command type / controller id; snapshot(),
+    // reset() and dump() are safe while monitoring
+    LatencyStats<>& latencyStats() {
+        return latency;
+    }
+
+    // Current offset/drift estimate between the firmware and host clocks
+    ClockEstimate clockEstimate() const {
+        return clock_sync.estimate();
+    }
+
+    // Firmware timestamp unit (default 1 ms); resets the estimate
+    void setDeviceTickPeriod(std::chrono::nanoseconds tick) {
+        clock_sync.setTickPeriod(tick);
+    }
+
+    // Sleep (default) or sleep-then-spin waits between polling-mode GETs
+    void setPollWait(WaitStrategy strategy, std::chrono::nanoseconds spin_window = std::chrono::microseconds(200)) {
+        scheduler.setWaitStrategy(strategy, spin_window);
+    }
+
+    // Achieved poll rate, jitter and deadline misses of the current or last
+    // monitoring run
+    PacingStats pacingStats() const {
+        return scheduler.stats();
+    }
+
+    // Stream mode falls back to polling once no INPUT line has been pushed
+    // for this long (default 50 ms)
+    void setStreamTimeout(std::chrono::milliseconds timeout) {
+        stream_timeout_ns.store(std::chrono::duration_cast<std::chrono::nanoseconds>(timeout).count());
+    }
+
+    // True while pushed INPUT lines are arriving
+    bool streamActive() const {
+        int64_t last = last_push_ns.load(std::memory_order_relaxed);
+        return last != 0 && std::chrono::steady_clock::now().time_since_epoch().count() - last <
+                                stream_timeout_ns.load(std::memory_order_relaxed);
+    }
+
+    // INPUT lines received without being asked for
+    uint64_t pushedSamples() const {
+        return pushed_samples.load(std::memory_order_relaxed);
+    }
+
+    // Wait statistics per lane, e.g. to see how much admin traffic delays GETs
+    LaneStats laneStats(CommandLane lane) const {
+        return arbiter.laneStats(lane);
+    }
+
+    void setPipelineDepth(size_t depth) {
+        pipeline_depth = depth > 0 ? depth : 1;
+    }
+
+    void setResponseTimeout(std::chrono::milliseconds timeout) {
+        response_timeout = timeout;
+    }
+
+    // Send a batch of commands keeping up to pipeline_depth of them in flight.
+    // Responses are matched by command type and controller id, falling back to
+    // the oldest outstanding command for untyped replies (e.g. errors), and
+    // handed to on_response(index, line, sent_at) as views into the receive
+    // buffer, with the time that command was written.
+    // Returns the number of commands that got a response before timing out.
+    // The whole batch holds the link, in the Input lane if it has any GET.
+    template <typename Commands, typename Handler>
+    size_t pipelineCommands(const Commands& commands, Handler&& on_response) {
+        if (!is_connected) {
+            throw std::runtime_error("Device not connected");
+        }
+
+        size_t total = std::size(commands);
+        CommandLane lane = CommandLane::Admin;
+        for (size_t i = 0; i < total && lane == CommandLane::Admin; i++) {
+            lane = laneFor(classifyCommand(commands[i], i).type);
+        }
+        CommandArbiter::Guard guard(arbiter, lane);
+
+        std::deque<PendingCommand> in_flight;
+        size_t next = 0;
+        size_t completed = 0;
+        auto deadline = std::chrono::steady_clock::now() + response_timeout;
+
+        while (completed < total) {
+            // Fill the window
+            while (next < total && in_flight.size() < pipeline_depth) {
+                std::string_view command = commands[next];
+                PendingCommand pending = classifyCommand(command, next);
+                pending.sent_at = std::chrono::steady_clock::now();
+                writeCommand(command);
+                in_flight.push_back(pending);
+                next++;
+            }
+
+            std::string_view line;
+            if (!readLine(line, deadline)) {
+                // Timed out: whatever is still outstanding gets no response
+                break;
+            }
+
+            PendingCommand reply = classifyResponse(line);
+            auto match = in_flight.end();
+
+            for (auto it = in_flight.begin(); it != in_flight.end(); ++it) {
+                if (it->type == reply.type &&
+                    (reply.type != CommandType::Get || it->controller_id == reply.controller_id)) {
+                    match = it;
+                    break;
+                }
+            }
+
+            if (match == in_flight.end() && reply.type == CommandType::Other && !in_flight.empty()) {
+                match = in_flight.begin();
+            }
+
+            if (match == in_flight.end()) {
+                deliverUnsolicited(line); // Nobody asked for it; maybe a pushed sample
+                continue;
+            }
+
+            // Replies to a pipelined batch share their first byte, so only
+            // write-to-line is recorded here
+            latency.record(match->type, match->controller_id, LatencyMetric::Line,
+                           std::chrono::steady_clock::now() - match->sent_at);
+            size_t index = match->index;
+            auto sent_at = match->sent_at;
+            in_flight.erase(match);
+            completed++;
+            deadline = std::chrono::steady_clock::now() + response_timeout;
+            on_response(index, line, sent_at);
+        }
+
+        return completed;
+    }
+
+    // Returns one response per command, in request order ("" on timeout)
+    std::vector<std::string> sendPipelined(const std::vector<std::string>& commands) {
+        std::vector<std::string> responses(commands.size());
+
+        pipelineCommands(commands, [&](size_t index, std::string_view line, std::chrono::steady_clock::time_point) {
+            responses[index] = std::string(line);
+        });
+
+        return responses;
+    }
+
+    // Poll several controllers in one pipelined exchange
+    size_t getControllerInputs(const std::vector<int>& controller_ids) {
+        std::vector<std::string> commands;
+        commands.reserve(controller_ids.size());
+
+        for (int id : controller_ids) {
+            commands.push_back("GET " + std::to_string(id));
+        }
+
+        size_t received = 0;
+
+        try {
+            pipelineCommands(commands, [&](size_t, std::string_view line, std::chrono::steady_clock::time_point sent_at) {
+                ControllerState state;
+                if (parseControllerInput(line, state, sent_at)) {
+                    deliverState(state);
+                    received++;
+                }
+            });
+        } catch (const std::exception& e) {
+            std::cerr << "Failed to get controller inputs: " << e.what() << std::endl;
+        }
+
+        return received;
+    }
+
+    // Re-read the connected controller ids with LIST
+    bool refreshTopology() {
+        std::string response;
+        try {
+            response = sendCommand("LIST");
+        } catch (const std::exception& e) {
+            std::cerr << "Failed to list controllers: " << e.what() << std::endl;
+            return false;
+        }
+
+        // CONTROLLERS|0_XBOX_ONE|1_PS4
+        insen_controller_info_t listed[16];
+        int count = 0;
+        if (insen_decode_list(response.data(), response.size(), listed, 16, &count) != INSEN_DECODE_OK) {
+            return false;
+        }
+        std::vector<int> ids;
+        for (int i = 0; i < count; i++) {
+            ids.push_back(listed[i].id);
+        }
+
+        std::lock_guard<std::mutex> lock(topology_mutex);
+        topology = std::move(ids);
+        topology_listed = std::chrono::steady_clock::now();
+        topology_stale.store(false);
+        return true;
+    }
+
+    // Ids from the cached LIST; empty until the first refresh
+    std::vector<int> connectedControllers() const {
+        std::lock_guard<std::mutex> lock(topology_mutex);
+        return topology;
+    }
+
+    void setTopologyRefresh(std::chrono::milliseconds interval) {
+        std::lock_guard<std::mutex> lock(topology_mutex);
+        topology_refresh = interval;
+    }
+
+    // One GET to every connected controller, sent back to back in a single
+    // pipelined burst. LIST is only re-issued when the cached topology is
+    // older than the refresh interval or a controller has disconnected.
+    size_t pollAllControllers() {
+        bool refresh = topology_stale.load();
+        std::vector<int> ids;
+        {
+            std::lock_guard<std::mutex> lock(topology_mutex);
+            refresh = refresh || std::chrono::steady_clock::now() - topology_listed >= topology_refresh;
+            ids = topology;
+        }
+        if (refresh && refreshTopology()) {
+            ids = connectedControllers();
+        }
+        return ids.empty() ? 0 : getControllerInputs(ids);
+    }
+
+    // sent_at is when the GET that produced response was written; when given,
+    // the round trip also feeds the device clock estimate
+    bool parseControllerInput(std::string_view response, ControllerState& state,
+                              std::chrono::steady_clock::time_point sent_at = {}) {
+        auto started = std::chrono::steady_clock::now();
+        ParseError error = parseInputLine(response, state);
+
+        if (error == ParseError::Disconnected) {
+            topology_stale.store(true);
+            return false;
+        }
+        if (error != ParseError::None) {
+            // Other responses are expected here; only report malformed INPUT lines
+            if (error != ParseError::NotInput) {
+                std::cerr << "Error parsing controller input: " << parseErrorString(error) << std::endl;
+            }
+            return false;
+        }
+
+        state.timestamp = std::chrono::steady_clock::now();
+        latency.record(CommandType::Get, state.id, LatencyMetric::Parse, state.timestamp - started);
+
+        if (sent_at != std::chrono::steady_clock::time_point()) {
+            clock_sync.addSample(state.device_time, sent_at, state.timestamp);
+        }
+        state.sample_time = clock_sync.toHost(state.device_time, state.timestamp);
+
+        // The callback still gets ids the table cannot hold; warn once, and
+        // latestStates().rejected() counts every later drop
+        if (!controllers.store(state.id, state) && controllers.rejected() == 1) {
+            std::cerr << "Controller id " << static_cast<int>(state.id) << " exceeds state table capacity ("
+                      << controllers.capacity() << "); latest state not kept" << std::endl;
+        }
+        return true;
+    }
+
+    // Latest state received for a controller. Safe to call from any thread
+    // while monitoring; never blocks the I/O thread.
+    bool getLatestState(int controller_id, ControllerState& state) const {
+        return controllers.load(controller_id, state);
+    }
+
+    const StateTable<>& latestStates() const {
+        return controllers;
+    }
+
+    static std::vector<std::string> getButtonNames(uint16_t button_mask) {
+        std::vector<std::string> pressed_buttons;
+        
+        for (const auto& [mask, name] : button_names) {
+            if (button_mask & mask) {
+                pressed_buttons.push_back(name);
+            }
+        }
+        
+        return pressed_buttons;
+    }
+
+    void getDeviceInfo() {
+        try {
+            std::string response = sendCommand("INFO");
+            device_info = response;
+            std::cout << "Device Info: " << response << std::endl;
+        } catch (const std::exception& e) {
+            std::cerr << "Failed to get device info: " << e.what() << std::endl;
+        }
+    }
+
+    // Switch GET replies and pushed samples to binary frames (insen_wire.h)
+    // or back to text. Enabling needs firmware that offers it in INFO and
+    // acknowledges the switch; otherwise the link stays on text. Returns
+    // whether the requested format is now in use.
+    bool negotiateBinary(bool enable) {
+        insen_firmware_info_t info;
+        if (enable && (insen_decode_info(device_info.data(), device_info.size(), &info) != INSEN_DECODE_OK ||
+                       !info.binary_supported)) {
+            return false;
+        }
+
+        try {
+            std::string response = sendCommand(enable ? INSEN_WIRE_ENABLE : INSEN_WIRE_DISABLE);
+            if (response == (enable ? INSEN_WIRE_ENABLE_ACK : INSEN_WIRE_DISABLE_ACK)) {
+                binary_active.store(enable);
+                std::cout << "Sample format: " << (enable ? "binary" : "text") << std::endl;
+                return true;
+            }
+        } catch (const std::exception& e) {
+            std::cerr << "Failed to negotiate sample format: " << e.what() << std::endl;
+        }
+        return false;
+    }
+
+    // Whether connect() tries binary samples (default true). While
+    // connected, also switches the link now.
+    void setBinaryProtocol(bool enabled) {
+        binary_preferred = enabled;
+        if (is_connected && enabled != binary_active.load()) {
+            negotiateBinary(enabled);
+        }
+    }
+
+    bool binaryActive() const {
+        return binary_active.load();
+    }
+
+    // Line rate and the driver low-latency flag used by the next connect()
+    void setBaudRate(int rate) {
+        baud_rate = rate;
+    }
+
+    void setLowLatency(bool enabled) {
+        low_latency = enabled;
+    }
+
+    // Rate the open port is configured for, as read back from the driver
+    int linkBaudRate() const {
+#ifdef _WIN32
+        return is_connected ? baud_rate : 0;
+#else
+        return is_connected ? serialBaudRate(serial_fd) : 0;
+#endif
+    }
+
+    // Measure the link as currently configured: round trip of single GETs,
+    // then sample and byte throughput of back-to-back pipelined GETs to one
+    // controller for the given time. Not while monitoring.
+    LinkProbeResult probeLink(std::chrono::milliseconds duration = std::chrono::milliseconds(500),
+                              int controller_id = 0, size_t round_trips = 50) {
+        LinkProbeResult result;
+        if (!is_connected || monitoring.load()) {
+            std::cerr << "Link probe needs a connected, idle controller" << std::endl;
+            return result;
+        }
+        result.baud_rate = linkBaudRate();
+        result.low_latency = low_latency;
+        result.binary = binary_active.load();
+
+        std::string get = "GET " + std::to_string(controller_id);
+        LatencyHistogram rtt;
+        for (size_t i = 0; i < round_trips; i++) {
+            auto sent_at = std::chrono::steady_clock::now();
+            if (!sendCommand(get).empty()) {
+                rtt.record(std::chrono::steady_clock::now() - sent_at);
+            }
+        }
+        result.rtt = rtt.snapshot();
+
+        // Keep the pipeline full for the whole burst
+        std::vector<std::string> burst(pipeline_depth * 4, get);
+        size_t samples = 0;
+        uint64_t bytes_before = bytes_read;
+        auto started = std::chrono::steady_clock::now();
+        auto end = started + duration;
+        while (std::chrono::steady_clock::now() < end) {
+            size_t received =
+                pipelineCommands(burst, [](size_t, std::string_view, std::chrono::steady_clock::time_point) {});
+            if (received == 0) {
+                break;
+            }
+            samples += received;
+        }
+        double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - started).count();
+        result.samples_per_sec = static_cast<double>(samples) / elapsed;
+        result.bytes_per_sec = static_cast<double>(bytes_read - bytes_before) / elapsed;
+        return result;
+    }
+
+    void getStatus() {
+        try {
+            std::string response = sendCommand("STATUS");
+            std::cout << "Status: " << response << std::endl;
+        } catch (const std::exception& e) {
+            std::cerr << "Failed to get status: " << e.what() << std::endl;
+        }
+    }
+
+    void listControllers() {
+        try {
+            std::string response = sendCommand("LIST");
+            std::cout << "Controllers: " << response << std::endl;
+        } catch (const std::exception& e) {
+            std::cerr << "Failed to list controllers: " << e.what() << std::endl;
+        }
+    }
+
+    bool getControllerInput(int controller_id = 0) {
+        try {
+            auto sent_at = std::chrono::steady_clock::now();
+            std::string response = sendCommand("GET " + std::to_string(controller_id));
+            ControllerState state;
+            
+            if (parseControllerInput(response, state, sent_at)) {
+                deliverState(state);
+                return true;
+            }
+            
+        } catch (const std::exception& e) {
+            std::cerr << "Failed to get controller input: " << e.what() << std::endl;
+        }
+        
+        return false;
+    }
+
+    void setInputCallback(const std::function<void(const ControllerState&)>& callback) {
+        input_callback = callback;
+    }
+
+    // Opt-in change delivery: callback fires only for button edges, dpad or
+    // battery changes, and analog moves beyond the deadzones, instead of on
+    // every poll. Independent of the input callback; set before monitoring.
+    void setChangeCallback(const std::function<void(const ChangeEvent&)>& callback,
+                           const Deadzones& deadzones = Deadzones()) {
+        change_callback = callback;
+        change_filter.setDeadzones(deadzones);
+        change_filter.reset();
+    }
+
+    // Also push every state to queue (owned by the caller, drained by the
+    // consumer in batches). Set before monitoring starts; nullptr disables.
+    void setEventQueue(SpscQueue<ControllerState>* queue) {
+        event_queue = queue;
+    }
+
+    // Also append every state to an open recorder (owned by the caller).
+    // Set before monitoring starts; nullptr disables.
+    void setRecorder(SessionRecorder* session_recorder) {
+        recorder = session_recorder;
+    }
+
+    // INFO response captured on connect; empty if the device did not answer
+    const std::string& deviceInfo() const {
+        return device_info;
+    }
+
+    // Poll one controller, or every connected one with all_controllers
+    void startMonitoring(int controller_id = 0, int fps = 60, MonitorMode mode = MonitorMode::Polling) {
+        if (monitoring.load()) {
+            std::cout << "Monitoring already active" << std::endl;
+            return;
+        }
+        if (monitor_thread.joinable()) {
+            stopMonitoring(); // The last run ended on a port error
+        }
+
+        monitoring.store(true);
+        scheduler.setRate(fps > 0 ? fps : 1);
+
+#if defined(__linux__)
+        // A burst to all controllers is one blocking pipelined exchange, so
+        // event-driven polling of all of them runs on the loop below
+        bool streaming = mode == MonitorMode::Stream;
+        if (streaming || (mode == MonitorMode::EventDriven && controller_id != all_controllers)) {
+            wake_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+            monitor_thread = std::thread([this, controller_id, streaming]() {
+                eventMonitorLoop(controller_id, streaming);
+            });
+
+            std::cout << "Started " << (streaming ? "streaming" : "event-driven") << " monitoring of ";
+            if (controller_id == all_controllers) {
+                std::cout << "all controllers";
+            } else {
+                std::cout << "controller " << controller_id;
+            }
+            std::cout << " at " << fps << " FPS" << std::endl;
+            return;
+        }
+#else
+        (void)mode; // Event-driven and stream modes need timerfd/eventfd; poll instead
+#endif
+
+        // Polls are due on a fixed grid, so the time a GET takes is absorbed
+        // by the next wait instead of stretching the period
+        monitor_thread = std::thread([this, controller_id]() {
+            scheduler.start();
+            while (monitoring.load()) {
+                scheduler.wait();
+                if (!monitoring.load()) {
+                    break;
+                }
+                if (controller_id == all_controllers) {
+                    pollAllControllers();
+                } else {
+                    getControllerInput(controller_id);
+                }
+            }
+        });
+
+        if (controller_id == all_controllers) {
+            std::cout << "Started monitoring all controllers at " << fps << " FPS" << std::endl;
+        } else {
+            std::cout << "Started monitoring controller " << controller_id
+                      << " at " << fps << " FPS" << std::endl;
+        }
+    }
+
+    // Also joins a monitor loop that already stopped itself on a port error
+    void stopMonitoring() {
+        if (monitoring.exchange(false) || monitor_thread.joinable()) {
+#if defined(__linux__)
+            if (wake_fd >= 0) {
+                uint64_t one = 1;
+                ssize_t ignored = write(wake_fd, &one, sizeof(one));
+                (void)ignored;
+            }
+#endif
+            if (monitor_thread.joinable()) {
+                monitor_thread.join();
+            }
+#if defined(__linux__)
+            if (wake_fd >= 0) {
+                close(wake_fd);
+                wake_fd = -1;
+            }
+#endif
+            PacingStats pacing = scheduler.stats();
+            std::cout << "Stopped monitoring: " << pacing.achieved_hz << " Hz achieved of " << pacing.target_hz
+                      << ", jitter " << pacing.jitter_ns / 1e3 << " us, " << pacing.missed << " polls missed"
+                      << std::endl;
+        }
+    }
+
+private:
+#if defined(__linux__)
+    // Event-driven monitor: a timerfd armed for each scheduler deadline paces
+    // GET requests, and replies are parsed and delivered the moment poll()
+    // reports the port readable.
+    // At most one GET is outstanding; a tick that finds one still pending
+    // re-sends only once it has timed out. The loop holds the Input lane from
+    // each GET until its reply, and leaves the port alone in between so
+    // admin commands from other threads can use the idle part of the frame.
+    //
+    // When streaming, the port is watched all the time and every INPUT line
+    // is delivered whether or not a GET is outstanding; the loop borrows the
+    // Input lane just long enough to drain and deliver pushed lines. rx, the
+    // queue, the change filter and the state table are only ever touched by
+    // whoever holds a lane. Ticks only poll while no push has arrived within
+    // the stream timeout.
+    void eventMonitorLoop(int controller_id, bool streaming) {
+        int timer_fd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+        if (timer_fd < 0) {
+            std::cerr << "Failed to create poll timer" << std::endl;
+            monitoring.store(false);
+            return;
+        }
+
+        // steady_clock is CLOCK_MONOTONIC on Linux, so deadlines can be
+        // handed to the timer as absolute times
+        auto armTimer = [timer_fd](std::chrono::steady_clock::time_point deadline) {
+            auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(deadline.time_since_epoch()).count();
+            struct itimerspec spec = {};
+            spec.it_value.tv_sec = static_cast<time_t>(ns / 1000000000LL);
+            spec.it_value.tv_nsec = static_cast<long>(ns % 1000000000LL);
+            timerfd_settime(timer_fd, TFD_TIMER_ABSTIME, &spec, nullptr);
+        };
+        scheduler.start();
+        armTimer(scheduler.nextDeadline());
+
+        char command[32];
+        int command_length = std::snprintf(command, sizeof(command), "GET %d", controller_id);
+        std::string_view get_command(command, static_cast<size_t>(command_length));
+        PendingCommand get_pending{CommandType::Get, controller_id, 0, {}};
+
+        bool awaiting_reply = false;
+        auto sent_at = std::chrono::steady_clock::now();
+        std::chrono::steady_clock::time_point first_byte;
+
+        struct pollfd fds[3] = {
+            {-1, POLLIN, 0},            // Serial port, watched only while holding the link
+            {timer_fd, POLLIN, 0},
+            {wake_fd, POLLIN, 0}
+        };
+
+        while (monitoring.load()) {
+            fds[0].fd = (awaiting_reply || streaming) ? serial_fd : -1;
+
+            if (poll(fds, 3, -1) < 0) {
+                if (errno == EINTR) {
+                    continue;
+                }
+                std::cerr << "Monitor poll failed" << std::endl;
+                monitoring.store(false);
+                break;
+            }
+
+            if (fds[0].revents & (POLLIN | POLLERR | POLLHUP)) {
+                bool borrowed = !awaiting_reply;
+                if (borrowed) {
+                    arbiter.acquire(CommandLane::Input);
+                }
+
+                size_t before = rx.buffered();
+                if (!readAvailable(serial_fd, rx)) {
+                    std::cerr << "Serial port closed during monitoring" << std::endl;
+                    if (borrowed) {
+                        arbiter.release();
+                    }
+                    monitoring.store(false);
+                    break;
+                }
+                if (rx.buffered() > before) {
+                    markFirstByte(&first_byte);
+                }
+
+                std::string_view line;
+                while ((awaiting_reply || streaming) && rx.nextLine(line)) {
+                    // Only the reply to the outstanding GET (its INPUT line,
+                    // DISCONNECTED or an error) ends the exchange and times
+                    // the round trip; anything else parsed is a push
+                    bool answers = awaiting_reply && responseMatches(get_pending, classifyResponse(line));
+                    ControllerState state;
+                    bool parsed = parseControllerInput(line, state,
+                                                       answers ? sent_at : std::chrono::steady_clock::time_point());
+                    if (answers) {
+                        recordExchange(CommandType::Get, controller_id, sent_at, first_byte);
+                        awaiting_reply = false;
+                    } else if (parsed) {
+                        notePush();
+                    }
+                    if (parsed) {
+                        deliverState(state);
+                    }
+                }
+
+                // Borrowed, or the GET was answered: free the lane only now
+                // that every drained line has been delivered
+                if (!awaiting_reply) {
+                    arbiter.release();
+                }
+            }
+
+            if (fds[1].revents & POLLIN) {
+                uint64_t expirations;
+                ssize_t ignored = read(timer_fd, &expirations, sizeof(expirations));
+                (void)ignored;
+
+                auto now = std::chrono::steady_clock::now();
+                scheduler.tick(now);
+                if (streaming && streamActive()) {
+                    // Pushes are arriving; no need to ask
+                } else if (controller_id == all_controllers) {
+                    pollAllControllers();
+                } else if (!awaiting_reply || now - sent_at >= response_timeout) {
+                    if (!awaiting_reply) {
+                        arbiter.acquire(CommandLane::Input);
+                    }
+                    try {
+                        sent_at = std::chrono::steady_clock::now();
+                        first_byte = std::chrono::steady_clock::time_point();
+                        writeCommand(get_command);
+                        awaiting_reply = true;
+                    } catch (const std::exception& e) {
+                        std::cerr << "Failed to get controller input: " << e.what() << std::endl;
+                        awaiting_reply = false;
+                        arbiter.release();
+                    }
+                }
+
+                scheduler.skipMissed(std::chrono::steady_clock::now());
+                armTimer(scheduler.nextDeadline());
+            }
+        }
+
+        if (awaiting_reply) {
+            arbiter.release();
+        }
+        close(timer_fd);
+    }
+#endif
+};
+
+#ifndef _WIN32
+// Probe a port once per serial configuration (e.g. a list of baud rates,
+// with and without low latency). Each configuration gets its own
+// connection; one that cannot be opened or set up yields a zero result.
+inline std::vector<LinkProbeResult> probeLinkConfigurations(
+        const std::string& port_name, const std::vector<SerialOptions>& configurations,
+        std::chrono::milliseconds duration = std::chrono::milliseconds(500), int controller_id = 0) {
+    std::vector<LinkProbeResult> results;
+    for (const SerialOptions& options : configurations) {
+        Controller controller(port_name, options.baud_rate);
+        controller.setLowLatency(options.low_latency);
+
+        LinkProbeResult result;
+        if (controller.connect()) {
+            result = controller.probeLink(duration, controller_id);
+            controller.disconnect();
+        }
+        results.push_back(result);
+    }
+    return results;
+}
+#endif
+
+} // namespace insen
+
+#endif // INSEN_CONTROLLER_HPP
@@ -0,0 +1,150 @@
+/*
+ * INSEN Controller Client - Device emulator
+ * //madebybunnyrce
+ * Serves emulated INSEN boards on pseudo-terminals until interrupted.
+ * Point insen_client, the C client or the benchmarks at the printed ports.
+ */
+
+#include <algorithm>
+#include <cctype>
+#include <chrono>
+#include <csignal>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <thread>
+
+#include "insen_emulator.hpp"
+
+#ifdef __linux__
+
+namespace {
+
+volatile std::sig_atomic_t stop_requested = 0;
+
+void onSignal(int) {
+    stop_requested = 1;
+}
+
+void printUsage(const char* program) {
+    std::cout << "Usage: " << program << " [options]\n"
+              << "  --controllers N        Connected controllers per board (default 2)\n"
+              << "  --devices N            Emulated boards, one pty each (default 1)\n"
+              << "  --baud N               Throttle replies to N baud, 8N1 (default unthrottled)\n"
+              << "  --latency US           Processing time for every command, microseconds\n"
+              << "  --latency-CMD US       Processing time for one command: info, status, list,\n"
+              << "                         get, version or help\n"
+              << "  --link-delay US        Transport delay added to every reply; pipelined\n"
+              << "                         commands overlap it (default 0)\n"
+              << "  --stream HZ            Push INPUT lines for every controller at HZ\n"
+              << "  --no-prompt            Send INPUT lines without the \">>> \" prefix\n"
+              << "  --no-binary            Do not offer binary sample frames, like older firmware\n"
+              << "  --firmware VERSION     Reported firmware version (default 1.2.0)\n";
+}
+
+bool commandByName(const std::string& name, insen::CommandType& type) {
+    static const insen::CommandType types[] = {insen::CommandType::Info, insen::CommandType::Status,
+                                               insen::CommandType::List, insen::CommandType::Get,
+                                               insen::CommandType::Version, insen::CommandType::Help};
+    for (insen::CommandType candidate : types) {
+        std::string candidate_name = insen::commandTypeName(candidate);
+        for (auto& c : candidate_name) {
+            c = static_cast<char>(std::tolower(static_cast<unsigned char>(c)));
+        }
+        if (candidate_name == name) {
+            type = candidate;
+            return true;
+        }
+    }
+    return false;
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    insen::EmulatorConfig config;
+    size_t devices = 1;
+
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "--help" || arg == "-h") {
+            printUsage(argv[0]);
+            return 0;
+        }
+        if (arg == "--no-prompt") {
+            config.prompt = false;
+            continue;
+        }
+        if (arg == "--no-binary") {
+            config.binary = false;
+            continue;
+        }
+        if (i + 1 >= argc) {
+            std::cerr << "Missing value for " << arg << std::endl;
+            printUsage(argv[0]);
+            return 1;
+        }
+
+        std::string value = argv[++i];
+        insen::CommandType type;
+        if (arg == "--controllers") {
+            config.controllers = std::atoi(value.c_str());
+        } else if (arg == "--devices") {
+            devices = static_cast<size_t>(std::max(1, std::atoi(value.c_str())));
+        } else if (arg == "--baud") {
+            config.baud_rate = std::atoi(value.c_str());
+        } else if (arg == "--latency") {
+            config.setLatency(std::chrono::microseconds(std::atol(value.c_str())));
+        } else if (arg.compare(0, 10, "--latency-") == 0 && commandByName(arg.substr(10), type)) {
+            config.setLatency(type, std::chrono::microseconds(std::atol(value.c_str())));
+        } else if (arg == "--stream") {
+            config.stream_hz = std::atof(value.c_str());
+        } else if (arg == "--link-delay") {
+            config.link_delay = std::chrono::microseconds(std::atol(value.c_str()));
+        } else if (arg == "--firmware") {
+            config.firmware_version = value;
+        } else {
+            std::cerr << "Unknown option " << arg << std::endl;
+            printUsage(argv[0]);
+            return 1;
+        }
+    }
+
+    insen::DeviceEmulator emulator(config, devices);
+    if (!emulator.start()) {
+        std::cerr << "Failed to start emulator" << std::endl;
+        return 1;
+    }
+
+    std::signal(SIGINT, onSignal);
+    std::signal(SIGTERM, onSignal);
+
+    std::cout << "INSEN emulator: " << config.controllers << " controller(s) per board";
+    if (config.baud_rate > 0) {
+        std::cout << ", " << config.baud_rate << " baud";
+    }
+    if (config.stream_hz > 0) {
+        std::cout << ", pushing input at " << config.stream_hz << " Hz";
+    }
+    std::cout << std::endl;
+    for (const auto& port : emulator.ports()) {
+        std::cout << port << std::endl;
+    }
+
+    while (!stop_requested) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    }
+
+    emulator.stop();
+    std::cout << "Served " << emulator.commandsServed() << " commands" << std::endl;
+    return 0;
+}
+
+#else
+
+int main() {
+    std::cerr << "The INSEN emulator needs Linux pseudo-terminals" << std::endl;
+    return 1;
+}
+
+#endif
@@ -0,0 +1,505 @@
+/*
+ * INSEN Controller Client - Device emulator
+ * //madebybunnyrce
+ * Emulates INSEN boards on pseudo-terminals so clients, benchmarks and CI
+ * can run without hardware. Each board answers INFO, STATUS, LIST, GET,
+ * VERSION and HELP in the documented formats, one command at a time like
+ * the firmware, with configurable processing latency per command type, a
+ * transport delay that pipelined commands overlap, and optional throttling
+ * to a serial line rate. Boards can also push unsolicited INPUT lines for
+ * every controller at a fixed rate (stream mode), and switch samples to
+ * binary frames on request. Controllers move along smooth synthetic paths. All boards are served by one epoll thread. Linux only.
+ */
+
+#ifndef INSEN_EMULATOR_HPP
+#define INSEN_EMULATOR_HPP
+
+#ifdef __linux__
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <deque>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+#include <fcntl.h>
+#include <pty.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/timerfd.h>
+#include <termios.h>
+#include <unistd.h>
+
+#include "insen_command.hpp"
+#include "insen_wire.h"
+
+namespace insen {
+
+struct EmulatorConfig {
+    int controllers = 2;                // Connected controllers, ids 0..controllers-1
+    int baud_rate = 0;                  // Throttle replies to this line rate; 0 = unthrottled
+    bool prompt = true;                 // ">>> " before INPUT lines
+    bool binary = true;                 // Offer binary sample frames (BINARY_V1 in INFO)
+    std::string firmware_version = "1.2.0";
+    std::chrono::microseconds latency[command_type_count] = {};     // Processing time per command
+    std::chrono::microseconds link_delay{0};    // Transport delay (e.g. USB polling); overlaps between commands
+    double stream_hz = 0.0;             // Push INPUT lines for every controller at this rate; 0 = off
+
+    void setLatency(std::chrono::microseconds value) {
+        for (auto& entry : latency) {
+            entry = value;
+        }
+    }
+
+    void setLatency(CommandType type, std::chrono::microseconds value) {
+        latency[static_cast<size_t>(type)] = value;
+    }
+};
+
+class DeviceEmulator {
+private:
+    using Clock = std::chrono::steady_clock;
+
+    struct Reply {
+        Clock::time_point processed_at; // When the firmware finishes processing
+        Clock::time_point ready_at;     // When the reply reaches the host side of the link
+        std::string command;
+    };
+
+    struct Device {
+        int master = -1;
+        std::string port;
+        std::string input;
+        std::deque<Reply> pending;
+        Clock::time_point busy_until;
+        std::string output;             // Generated, not yet written to the pty
+        size_t output_sent = 0;
+        Clock::time_point line_clock;   // Virtual time the line finishes what was written
+        Clock::time_point next_push;
+        bool binary = false;            // Samples go out as binary frames
+        uint64_t gets = 0;
+        uint64_t commands = 0;
+    };
+
+    EmulatorConfig config;
+    std::atomic<int> controllers;   // Can change while running, like pads being unplugged
+    std::vector<std::unique_ptr<Device>> devices;
+    std::atomic<bool> running;
+    std::atomic<uint64_t> served;
+    std::atomic<int64_t> push_period_ns;    // 0 = not streaming
+    std::atomic<uint64_t> bytes_in;
+    std::atomic<uint64_t> bytes_out;
+    Clock::time_point started;
+    int wake_fd;
+    int timer_fd;
+    std::thread thread;
+
+    static CommandType commandType(std::string_view command) {
+        if (command.substr(0, 3) == "GET") return CommandType::Get;
+        if (command == "INFO") return CommandType::Info;
+        if (command == "STATUS") return CommandType::Status;
+        if (command == "LIST") return CommandType::List;
+        if (command == "VERSION") return CommandType::Version;
+        if (command == "HELP") return CommandType::Help;
+        return CommandType::Other;
+    }
+
+    insen_controller_state_t sampleAt(int id, Clock::time_point at) const {
+        double t = std::chrono::duration<double>(at - started).count();
+        double phase = id * 0.7;
+        constexpr double two_pi = 6.283185307179586;
+
+        int lx = static_cast<int>(20000 * std::sin(two_pi * 0.25 * t + phase));
+        int ly = static_cast<int>(20000 * std::cos(two_pi * 0.25 * t + phase));
+        int rx = static_cast<int>(12000 * std::sin(two_pi * 0.6 * t + phase));
+        int ry = static_cast<int>(8000 * std::sin(two_pi * 0.9 * t + phase));
+        int lt = static_cast<int>(t * 128) % 256;
+        int rt = 255 - lt;
+        unsigned buttons = (static_cast<int>(t * 4) % 2) ? 1u << ((static_cast<int>(t * 2) + id) % 11) : 0u;
+        int dpad = (static_cast<int>(t) + id) % 9;
+        int battery = 100 - static_cast<int>(t / 60) % 100;
+        auto millis = static_cast<uint32_t>(t * 1000) + 1;
+
+        insen_controller_state_t sample = {};
+        sample.controller_id = static_cast<uint8_t>(id);
+        sample.left_stick_x = static_cast<int16_t>(lx);
+        sample.left_stick_y = static_cast<int16_t>(ly);
+        sample.right_stick_x = static_cast<int16_t>(rx);
+        sample.right_stick_y = static_cast<int16_t>(ry);
+        sample.left_trigger = static_cast<uint8_t>(lt);
+        sample.right_trigger = static_cast<uint8_t>(rt);
+        sample.buttons = static_cast<uint16_t>(buttons);
+        sample.dpad = static_cast<uint8_t>(dpad);
+        sample.battery_level = static_cast<uint8_t>(battery);
+        sample.timestamp = millis;
+        return sample;
+    }
+
+    // One sample as an INPUT line, or as a binary frame (which starts with
+    // its 0x00 delimiter, so queueLine() adds no line ending)
+    std::string inputLine(const Device& device, int id, Clock::time_point at) const {
+        insen_controller_state_t sample = sampleAt(id, at);
+        if (device.binary) {
+            uint8_t frame[INSEN_WIRE_FRAME_SIZE];
+            insen_wire_encode(&sample, 1, frame);
+            return std::string(reinterpret_cast<const char*>(frame), sizeof(frame));
+        }
+
+        char line[128];
+        std::snprintf(line, sizeof(line), "%sINPUT|%d|%d,%d|%d,%d|%d,%d|0x%04X|%d|%d|%u",
+                      config.prompt ? ">>> " : "", id, sample.left_stick_x, sample.left_stick_y,
+                      sample.right_stick_x, sample.right_stick_y, sample.left_trigger, sample.right_trigger,
+                      sample.buttons, sample.dpad, sample.battery_level, sample.timestamp);
+        return line;
+    }
+
+    std::string respond(Device& device, std::string_view command, Clock::time_point at) {
+        static const char* models[] = {"XBOX_ONE", "PS4", "SWITCH_PRO", "XBOX_SERIES"};
+        char line[160];
+
+        device.commands++;
+        switch (commandType(command)) {
+            case CommandType::Get: {
+                std::string_view arg = command.substr(3);
+                while (!arg.empty() && arg.front() == ' ') {
+                    arg.remove_prefix(1);
+                }
+                if (arg.empty() || arg.front() < '0' || arg.front() > '9') {
+                    return "ERROR|INVALID_CONTROLLER_ID";
+                }
+                int id = std::atoi(std::string(arg).c_str());
+                device.gets++;
+                if (id >= controllers.load(std::memory_order_relaxed)) {
+                    if (device.binary) {
+                        insen_controller_state_t sample = {};
+                        sample.controller_id = static_cast<uint8_t>(id);
+                        uint8_t frame[INSEN_WIRE_FRAME_SIZE];
+                        insen_wire_encode(&sample, 0, frame);
+                        return std::string(reinterpret_cast<const char*>(frame), sizeof(frame));
+                    }
+                    std::snprintf(line, sizeof(line), "%sINPUT|%d|DISCONNECTED", config.prompt ? ">>> " : "", id);
+                    return line;
+                }
+                return inputLine(device, id, at);
+            }
+            case CommandType::Info:
+                return "INSEN_FW_V" + config.firmware_version + "|BUILD_EMULATOR|MAKCU_COMPATIBLE|" +
+                       (config.binary ? INSEN_WIRE_CAPABILITY "|" : "") + "STATUS_OK";
+            case CommandType::Status:
+                std::snprintf(line, sizeof(line), "STATUS|ACTIVE_%d|TOTAL_INPUTS_%llu|API_COMMANDS_%llu|FREE_HEAP_234567",
+                              controllers.load(std::memory_order_relaxed), static_cast<unsigned long long>(device.gets),
+                              static_cast<unsigned long long>(device.commands));
+                return line;
+            case CommandType::List: {
+                std::string list = "CONTROLLERS";
+                for (int id = 0; id < controllers.load(std::memory_order_relaxed); id++) {
+                    list += "|" + std::to_string(id) + "_" + models[id % 4];
+                }
+                return list;
+            }
+            case CommandType::Version:
+                return "VERSION|" + config.firmware_version + "|MAKCU_COMPATIBLE";
+            case CommandType::Help:
+                return "COMMANDS|INFO,STATUS,LIST,GET,HELP,VERSION";
+            case CommandType::Other:
+                if (config.binary && command == INSEN_WIRE_ENABLE) {
+                    device.binary = true;
+                    return INSEN_WIRE_ENABLE_ACK;
+                }
+                if (config.binary && command == INSEN_WIRE_DISABLE) {
+                    device.binary = false;
+                    return INSEN_WIRE_DISABLE_ACK;
+                }
+                break;
+        }
+        return "ERROR|UNKNOWN_COMMAND";
+    }
+
+    void onReadable(Device& device, Clock::time_point now) {
+        char buffer[4096];
+        ssize_t n;
+        while ((n = read(device.master, buffer, sizeof(buffer))) > 0) {
+            device.input.append(buffer, static_cast<size_t>(n));
+            bytes_in.fetch_add(static_cast<uint64_t>(n), std::memory_order_relaxed);
+        }
+
+        size_t eol;
+        while ((eol = device.input.find('\n')) != std::string::npos) {
+            std::string command = device.input.substr(0, eol);
+            device.input.erase(0, eol + 1);
+            while (!command.empty() && (command.back() == '\r' || command.back() == ' ')) {
+                command.pop_back();
+            }
+            if (command.empty()) {
+                continue;
+            }
+
+            // Commands are processed one after another, like the firmware
+            auto begin = std::max(now, device.busy_until);
+            device.busy_until = begin + config.latency[static_cast<size_t>(commandType(command))];
+            device.pending.push_back(Reply{device.busy_until, device.busy_until + config.link_delay, std::move(command)});
+        }
+    }
+
+    // Queue one line for the host; an idle line starts sending it at "at"
+    static void queueLine(Device& device, const std::string& line, Clock::time_point at) {
+        if (device.output_sent == device.output.size()) {
+            device.output.clear();
+            device.output_sent = 0;
+            device.line_clock = std::max(device.line_clock, at);
+        }
+        device.output += line;
+        if (line.empty() || line.front() != '\0') {
+            device.output += "\r\n";
+        }
+    }
+
+    // Turn processed commands and due pushes into output and write what the
+    // line allows; returns when this device next needs attention
+    Clock::time_point service(Device& device, Clock::time_point now) {
+        while (!device.pending.empty() && device.pending.front().ready_at <= now) {
+            const Reply& reply = device.pending.front();
+            queueLine(device, respond(device, reply.command, reply.processed_at), reply.ready_at);
+            device.pending.pop_front();
+            served.fetch_add(1, std::memory_order_relaxed);
+        }
+
+        Clock::time_point next = Clock::time_point::max();
+        if (!device.pending.empty()) {
+            next = device.pending.front().ready_at;
+        }
+
+        auto push_period = std::chrono::nanoseconds(push_period_ns.load(std::memory_order_relaxed));
+        if (push_period.count() > 0) {
+            if (now >= device.next_push) {
+                // Like a firmware TX buffer, pushes are dropped while the
+                // link is badly backed up
+                if (device.output.size() - device.output_sent < 1024) {
+                    for (int id = 0; id < controllers.load(std::memory_order_relaxed); id++) {
+                        queueLine(device, inputLine(device, id, now), now);
+                    }
+                }
+                device.next_push += push_period;
+                if (device.next_push <= now) {
+                    device.next_push = now + push_period;
+                }
+            }
+            next = std::min(next, device.next_push);
+        }
+
+        size_t remaining = device.output.size() - device.output_sent;
+        if (remaining == 0) {
+            return next;
+        }
+
+        size_t allowed = remaining;
+        std::chrono::nanoseconds byte_time(0);
+        if (config.baud_rate > 0) {
+            // 10 bits per byte on the wire (8N1)
+            byte_time = std::chrono::nanoseconds(10000000000LL / config.baud_rate);
+            auto elapsed = now - device.line_clock;
+            allowed = elapsed.count() > 0 ? static_cast<size_t>(elapsed / byte_time) : 0;
+            allowed = std::min(allowed, remaining);
+        }
+
+        if (allowed > 0) {
+            ssize_t written = write(device.master, device.output.data() + device.output_sent, allowed);
+            if (written > 0) {
+                bytes_out.fetch_add(static_cast<uint64_t>(written), std::memory_order_relaxed);
+                device.output_sent += static_cast<size_t>(written);
+                device.line_clock += byte_time * written;
+                remaining -= static_cast<size_t>(written);
+            } else {
+                return std::min(next, now + std::chrono::milliseconds(1)); // pty full; retry soon
+            }
+        }
+
+        if (remaining > 0) {
+            // Wake when a few more bytes have gone out on the wire
+            auto chunk = static_cast<int64_t>(std::min<size_t>(remaining, 4));
+            next = std::min(next, config.baud_rate > 0 ? device.line_clock + byte_time * chunk
+                                                       : now + std::chrono::milliseconds(1));
+        }
+        return next;
+    }
+
+    void serve() {
+        int epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+        epoll_event event = {};
+        event.events = EPOLLIN;
+
+        event.data.ptr = nullptr;
+        epoll_ctl(epoll_fd, EPOLL_CTL_ADD, wake_fd, &event);
+        event.data.ptr = &timer_fd;
+        epoll_ctl(epoll_fd, EPOLL_CTL_ADD, timer_fd, &event);
+        for (auto& device : devices) {
+            event.data.ptr = device.get();
+            epoll_ctl(epoll_fd, EPOLL_CTL_ADD, device->master, &event);
+        }
+
+        epoll_event events[64];
+        while (running.load(std::memory_order_relaxed)) {
+            int ready = epoll_wait(epoll_fd, events, 64, -1);
+            auto now = Clock::now();
+
+            for (int i = 0; i < ready; i++) {
+                void* tag = events[i].data.ptr;
+                if (tag == &timer_fd || tag == nullptr) {
+                    uint64_t count;
+                    ssize_t ignored = read(tag ? timer_fd : wake_fd, &count, sizeof(count));
+                    (void)ignored;
+                } else {
+                    onReadable(*static_cast<Device*>(tag), now);
+                }
+            }
+
+            Clock::time_point next = Clock::time_point::max();
+            for (auto& device : devices) {
+                next = std::min(next, service(*device, now));
+            }
+
+            // Arm the timer for the earliest pending reply or throttled write
+            struct itimerspec spec = {};
+            if (next != Clock::time_point::max()) {
+                auto wait = std::max(std::chrono::duration_cast<std::chrono::nanoseconds>(next - Clock::now()),
+                                     std::chrono::nanoseconds(1000));
+                spec.it_value.tv_sec = static_cast<time_t>(wait.count() / 1000000000LL);
+                spec.it_value.tv_nsec = static_cast<long>(wait.count() % 1000000000LL);
+            }
+            timerfd_settime(timer_fd, 0, &spec, nullptr);
+        }
+
+        close(epoll_fd);
+    }
+
+public:
+    explicit DeviceEmulator(const EmulatorConfig& emulator_config = EmulatorConfig(), size_t device_count = 1)
+        : config(emulator_config), controllers(emulator_config.controllers), running(false), served(0),
+          push_period_ns(0), bytes_in(0), bytes_out(0), started(Clock::now()), wake_fd(-1), timer_fd(-1) {
+        setStreamRate(config.stream_hz);
+        for (size_t i = 0; i < device_count; i++) {
+            int master, slave;
+            char name[128];
+            if (openpty(&master, &slave, name, nullptr, nullptr) != 0) {
+                std::cerr << "Failed to open pty for emulated device " << i << std::endl;
+                break;
+            }
+
+            struct termios tty;
+            tcgetattr(master, &tty);
+            cfmakeraw(&tty);
+            tcsetattr(master, TCSANOW, &tty);
+            close(slave); // Clients reopen it by name
+            fcntl(master, F_SETFL, fcntl(master, F_GETFL) | O_NONBLOCK);
+
+            auto device = std::make_unique<Device>();
+            device->master = master;
+            device->port = name;
+            devices.push_back(std::move(device));
+        }
+    }
+
+    ~DeviceEmulator() {
+        stop();
+        for (auto& device : devices) {
+            close(device->master);
+        }
+    }
+
+    DeviceEmulator(const DeviceEmulator&) = delete;
+    DeviceEmulator& operator=(const DeviceEmulator&) = delete;
+
+    bool start() {
+        if (running.load() || devices.empty()) {
+            return false;
+        }
+
+        wake_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+        timer_fd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+        if (wake_fd < 0 || timer_fd < 0) {
+            std::cerr << "Failed to create emulator event fds" << std::endl;
+            stop();
+            return false;
+        }
+
+        running.store(true);
+        thread = std::thread([this]() { serve(); });
+        return true;
+    }
+
+    void stop() {
+        running.store(false);
+        if (wake_fd >= 0) {
+            uint64_t one = 1;
+            ssize_t ignored = write(wake_fd, &one, sizeof(one));
+            (void)ignored;
+        }
+        if (thread.joinable()) {
+            thread.join();
+        }
+        for (int* fd : {&wake_fd, &timer_fd}) {
+            if (*fd >= 0) {
+                close(*fd);
+                *fd = -1;
+            }
+        }
+    }
+
+    // Slave pty paths, one per emulated board, to open like a serial port
+    std::vector<std::string> ports() const {
+        std::vector<std::string> names;
+        for (const auto& device : devices) {
+            names.push_back(device->port);
+        }
+        return names;
+    }
+
+    // Connect or disconnect controllers on every board while running
+    void setControllers(int count) {
+        controllers.store(count, std::memory_order_relaxed);
+    }
+
+    // Start, retune or (with 0) stop pushing INPUT lines while running
+    void setStreamRate(double hz) {
+        push_period_ns.store(hz > 0 ? static_cast<int64_t>(1e9 / hz) : 0, std::memory_order_relaxed);
+        uint64_t one = 1;
+        if (wake_fd >= 0) {
+            ssize_t ignored = write(wake_fd, &one, sizeof(one));
+            (void)ignored;
+        }
+    }
+
+    // Host time at which the sample stamped device_time was taken, to
+    // within half a millisecond tick
+    Clock::time_point sampleTime(uint32_t device_time) const {
+        return started + std::chrono::microseconds(static_cast<int64_t>(device_time) * 1000 - 500);
+    }
+
+    uint64_t commandsServed() const {
+        return served.load(std::memory_order_relaxed);
+    }
+
+    // Bytes read from and written to the hosts, over all boards
+    uint64_t bytesReceived() const {
+        return bytes_in.load(std::memory_order_relaxed);
+    }
+
+    uint64_t bytesSent() const {
+        return bytes_out.load(std::memory_order_relaxed);
+    }
+};
+
+} // namespace insen
+
+#endif // __linux__
+
+#endif // INSEN_EMULATOR_HPP
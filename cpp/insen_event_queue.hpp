@@ -0,0 +1,242 @@
+/*
+ * INSEN Controller Client - Event queues
+ * //madebybunnyrce
+ * Bounded lock-free ring buffers that carry states from the I/O thread to
+ * consumers, so a slow consumer never delays the next poll. Producers never
+ * block: when a queue is full the event is dropped and counted. Consumers
+ * drain in batches.
+ *
+ *   SpscQueue - one producer (a Controller's monitor thread), one consumer
+ *   MpscQueue - many producers (ControllerHub reactors), one consumer
+ */
+
+#ifndef INSEN_EVENT_QUEUE_HPP
+#define INSEN_EVENT_QUEUE_HPP
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
+namespace insen {
+
+namespace detail {
+
+inline size_t roundUpPowerOfTwo(size_t value) {
+    size_t result = 2;
+    while (result < value) {
+        result <<= 1;
+    }
+    return result;
+}
+
+} // namespace detail
+
+template <typename T>
+class SpscQueue {
+private:
+    const size_t mask;
+    std::unique_ptr<T[]> ring;
+
+    // Producer side
+    alignas(64) std::atomic<size_t> tail;
+    size_t cached_head;
+    bool overflowing;
+    std::atomic<uint64_t> dropped;
+    std::atomic<uint64_t> overflows;
+
+    // Consumer side
+    alignas(64) std::atomic<size_t> head;
+    size_t cached_tail;
+
+public:
+    explicit SpscQueue(size_t capacity = 1024)
+        : mask(detail::roundUpPowerOfTwo(capacity) - 1), ring(new T[mask + 1]),
+          tail(0), cached_head(0), overflowing(false), dropped(0), overflows(0),
+          head(0), cached_tail(0) {}
+
+    SpscQueue(const SpscQueue&) = delete;
+    SpscQueue& operator=(const SpscQueue&) = delete;
+
+    // Producer: append one event, or drop it if the queue is full
+    bool tryPush(const T& value) {
+        size_t t = tail.load(std::memory_order_relaxed);
+
+        if (t - cached_head > mask) {
+            cached_head = head.load(std::memory_order_acquire);
+            if (t - cached_head > mask) {
+                dropped.fetch_add(1, std::memory_order_relaxed);
+                if (!overflowing) {
+                    overflowing = true;
+                    overflows.fetch_add(1, std::memory_order_relaxed);
+                }
+                return false;
+            }
+        }
+
+        ring[t & mask] = value;
+        tail.store(t + 1, std::memory_order_release);
+        overflowing = false;
+        return true;
+    }
+
+    // Consumer: copy up to max events into out, returns how many
+    size_t popBatch(T* out, size_t max) {
+        size_t h = head.load(std::memory_order_relaxed);
+
+        if (cached_tail - h < max) {
+            cached_tail = tail.load(std::memory_order_acquire);
+        }
+
+        size_t count = cached_tail - h;
+        if (count > max) {
+            count = max;
+        }
+
+        for (size_t i = 0; i < count; i++) {
+            out[i] = ring[(h + i) & mask];
+        }
+
+        head.store(h + count, std::memory_order_release);
+        return count;
+    }
+
+    // Consumer: hand up to max events to fn in place, returns how many
+    template <typename Fn>
+    size_t drain(Fn&& fn, size_t max = SIZE_MAX) {
+        size_t h = head.load(std::memory_order_relaxed);
+        cached_tail = tail.load(std::memory_order_acquire);
+
+        size_t count = cached_tail - h;
+        if (count > max) {
+            count = max;
+        }
+
+        for (size_t i = 0; i < count; i++) {
+            fn(ring[(h + i) & mask]);
+        }
+
+        head.store(h + count, std::memory_order_release);
+        return count;
+    }
+
+    size_t capacity() const {
+        return mask + 1;
+    }
+
+    // Approximate when called concurrently with push/pop
+    size_t size() const {
+        return tail.load(std::memory_order_acquire) - head.load(std::memory_order_acquire);
+    }
+
+    // Events lost because the queue was full
+    uint64_t droppedCount() const {
+        return dropped.load(std::memory_order_relaxed);
+    }
+
+    // Times the queue went from accepting events to full
+    uint64_t overflowCount() const {
+        return overflows.load(std::memory_order_relaxed);
+    }
+};
+
+// Bounded multi-producer queue (Vyukov's per-cell sequence scheme)
+template <typename T>
+class MpscQueue {
+private:
+    struct Cell {
+        std::atomic<size_t> sequence;
+        T value;
+    };
+
+    const size_t mask;
+    std::unique_ptr<Cell[]> cells;
+
+    alignas(64) std::atomic<size_t> tail;
+    std::atomic<bool> overflowing;
+    std::atomic<uint64_t> dropped;
+    std::atomic<uint64_t> overflows;
+
+    alignas(64) size_t head;    // Single consumer: plain index
+
+public:
+    explicit MpscQueue(size_t capacity = 1024)
+        : mask(detail::roundUpPowerOfTwo(capacity) - 1), cells(new Cell[mask + 1]),
+          tail(0), overflowing(false), dropped(0), overflows(0), head(0) {
+        for (size_t i = 0; i <= mask; i++) {
+            cells[i].sequence.store(i, std::memory_order_relaxed);
+        }
+    }
+
+    MpscQueue(const MpscQueue&) = delete;
+    MpscQueue& operator=(const MpscQueue&) = delete;
+
+    // Producer (any thread): append one event, or drop it if the queue is full
+    bool tryPush(const T& value) {
+        size_t t = tail.load(std::memory_order_relaxed);
+
+        for (;;) {
+            Cell& cell = cells[t & mask];
+            size_t sequence = cell.sequence.load(std::memory_order_acquire);
+            intptr_t diff = static_cast<intptr_t>(sequence) - static_cast<intptr_t>(t);
+
+            if (diff == 0) {
+                if (tail.compare_exchange_weak(t, t + 1, std::memory_order_relaxed)) {
+                    cell.value = value;
+                    cell.sequence.store(t + 1, std::memory_order_release);
+                    overflowing.store(false, std::memory_order_relaxed);
+                    return true;
+                }
+            } else if (diff < 0) {
+                dropped.fetch_add(1, std::memory_order_relaxed);
+                if (!overflowing.exchange(true, std::memory_order_relaxed)) {
+                    overflows.fetch_add(1, std::memory_order_relaxed);
+                }
+                return false;
+            } else {
+                t = tail.load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+    // Consumer: copy up to max events into out, returns how many
+    size_t popBatch(T* out, size_t max) {
+        return drain([&out](const T& value) { *out++ = value; }, max);
+    }
+
+    // Consumer: hand up to max ready events to fn, returns how many
+    template <typename Fn>
+    size_t drain(Fn&& fn, size_t max = SIZE_MAX) {
+        size_t count = 0;
+
+        while (count < max) {
+            Cell& cell = cells[head & mask];
+            if (cell.sequence.load(std::memory_order_acquire) != head + 1) {
+                break; // Empty, or the next producer has not finished writing
+            }
+
+            fn(cell.value);
+            cell.sequence.store(head + mask + 1, std::memory_order_release);
+            head++;
+            count++;
+        }
+
+        return count;
+    }
+
+    size_t capacity() const {
+        return mask + 1;
+    }
+
+    uint64_t droppedCount() const {
+        return dropped.load(std::memory_order_relaxed);
+    }
+
+    uint64_t overflowCount() const {
+        return overflows.load(std::memory_order_relaxed);
+    }
+};
+
+} // namespace insen
+
+#endif // INSEN_EVENT_QUEUE_HPP
@@ -0,0 +1,160 @@
+/*
+ * INSEN Controller Client - Sample history
+ * //madebybunnyrce
+ * Rolling per-controller window stored as one array per field, so
+ * analytics over a stick or trigger column read contiguous, aligned data
+ * the compiler can vectorize. Every value is written twice (slot i and
+ * i + Capacity), which makes the latest n samples one contiguous run with
+ * no wrap-around to handle.
+ */
+
+#ifndef INSEN_HISTORY_HPP
+#define INSEN_HISTORY_HPP
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+
+#include "insen_state.hpp"
+
+namespace insen {
+
+template <size_t Capacity = 1024>
+class SampleHistory {
+private:
+    template <typename T>
+    struct alignas(64) Column {
+        T data[2 * Capacity];
+
+        void put(size_t slot, T value) {
+            data[slot] = value;
+            data[slot + Capacity] = value;
+        }
+    };
+
+    Column<int16_t> left_stick_x, left_stick_y;
+    Column<int16_t> right_stick_x, right_stick_y;
+    Column<uint8_t> left_trigger, right_trigger;
+    Column<uint16_t> buttons;
+    Column<uint8_t> dpad;
+    Column<uint8_t> battery;
+    Column<uint32_t> device_time;   // Firmware timestamp
+    Column<int64_t> host_time;      // steady_clock ticks (ns on common platforms)
+    size_t count;                   // Samples pushed so far
+
+    // Latest n values of a column, oldest first, as one contiguous run
+    template <typename T>
+    const T* window(const Column<T>& column, size_t n) const {
+        if (count == 0 || n == 0) {
+            return column.data; // Empty window; nothing may be read through it
+        }
+        size_t slot = (count - 1) % Capacity;
+        return column.data + slot + Capacity + 1 - n;
+    }
+
+public:
+    SampleHistory() : count(0) {}
+
+    static constexpr size_t capacity() {
+        return Capacity;
+    }
+
+    // Samples available, at most Capacity
+    size_t size() const {
+        return count < Capacity ? count : Capacity;
+    }
+
+    size_t totalPushed() const {
+        return count;
+    }
+
+    void clear() {
+        count = 0;
+    }
+
+    void push(const Sample& sample, std::chrono::steady_clock::time_point host_timestamp = {}) {
+        size_t slot = count % Capacity;
+        left_stick_x.put(slot, sample.left_stick_x);
+        left_stick_y.put(slot, sample.left_stick_y);
+        right_stick_x.put(slot, sample.right_stick_x);
+        right_stick_y.put(slot, sample.right_stick_y);
+        left_trigger.put(slot, sample.left_trigger);
+        right_trigger.put(slot, sample.right_trigger);
+        buttons.put(slot, sample.buttons);
+        dpad.put(slot, sample.dpad);
+        battery.put(slot, sample.battery_level);
+        device_time.put(slot, sample.timestamp);
+        host_time.put(slot, static_cast<int64_t>(host_timestamp.time_since_epoch().count()));
+        count++;
+    }
+
+    void push(const ControllerState& state) {
+        push(toSample(state), state.timestamp);
+    }
+
+    // Column windows: the latest n samples (n <= size()), oldest first
+    const int16_t* leftStickX(size_t n) const { return window(left_stick_x, n); }
+    const int16_t* leftStickY(size_t n) const { return window(left_stick_y, n); }
+    const int16_t* rightStickX(size_t n) const { return window(right_stick_x, n); }
+    const int16_t* rightStickY(size_t n) const { return window(right_stick_y, n); }
+    const uint8_t* leftTrigger(size_t n) const { return window(left_trigger, n); }
+    const uint8_t* rightTrigger(size_t n) const { return window(right_trigger, n); }
+    const uint16_t* buttonMasks(size_t n) const { return window(buttons, n); }
+    const uint8_t* dpadStates(size_t n) const { return window(dpad, n); }
+    const uint8_t* batteryLevels(size_t n) const { return window(battery, n); }
+    const uint32_t* deviceTimes(size_t n) const { return window(device_time, n); }
+    const int64_t* hostTimes(size_t n) const { return window(host_time, n); }
+
+    // Sample i of the window of size n, reassembled (for inspection, not bulk work)
+    Sample sample(size_t n, size_t i) const {
+        Sample sample = {};
+        sample.left_stick_x = leftStickX(n)[i];
+        sample.left_stick_y = leftStickY(n)[i];
+        sample.right_stick_x = rightStickX(n)[i];
+        sample.right_stick_y = rightStickY(n)[i];
+        sample.left_trigger = leftTrigger(n)[i];
+        sample.right_trigger = rightTrigger(n)[i];
+        sample.buttons = buttonMasks(n)[i];
+        sample.dpad = dpadStates(n)[i];
+        sample.battery_level = batteryLevels(n)[i];
+        sample.timestamp = deviceTimes(n)[i];
+        return sample;
+    }
+};
+
+// Column reductions written as plain loops over contiguous data so they
+// auto-vectorize at -O2/-O3.
+template <typename T>
+int64_t columnSum(const T* values, size_t n) {
+    int64_t sum = 0;
+    for (size_t i = 0; i < n; i++) {
+        sum += values[i];
+    }
+    return sum;
+}
+
+template <typename T>
+void columnMinMax(const T* values, size_t n, T& min_value, T& max_value) {
+    T lo = n ? values[0] : T();
+    T hi = lo;
+    for (size_t i = 1; i < n; i++) {
+        lo = values[i] < lo ? values[i] : lo;
+        hi = values[i] > hi ? values[i] : hi;
+    }
+    min_value = lo;
+    max_value = hi;
+}
+
+// Samples in the window whose |value| exceeds threshold (e.g. stick activity)
+inline size_t columnCountAbove(const int16_t* values, size_t n, int threshold) {
+    size_t count = 0;
+    for (size_t i = 0; i < n; i++) {
+        int v = values[i];
+        count += (v > threshold) | (v < -threshold);
+    }
+    return count;
+}
+
+} // namespace insen
+
+#endif // INSEN_HISTORY_HPP
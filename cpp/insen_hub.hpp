@@ -0,0 +1,418 @@
+/*
+ * INSEN Controller Client - Multi-device hub
+ * //madebybunnyrce
+ * Services many INSEN boards from a few epoll reactor threads instead of
+ * one monitor thread per Controller. Each board's GET/INPUT exchange runs
+ * as a small state machine on the reactor that owns its fd; boards are
+ * sharded round-robin across reactors. Every device keeps its own clock
+ * estimate, so sample_time puts states from all boards on one timeline.
+ * Linux only (epoll/timerfd).
+ */
+
+#ifndef INSEN_HUB_HPP
+#define INSEN_HUB_HPP
+
+#ifdef __linux__
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <functional>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/timerfd.h>
+#include <unistd.h>
+
+#include "insen_clock_sync.hpp"
+#include "insen_event_queue.hpp"
+#include "insen_line_reader.hpp"
+#include "insen_parser.hpp"
+#include "insen_serial.hpp"
+#include "insen_state.hpp"
+
+namespace insen {
+
+// A state tagged with the hub device it came from
+struct HubSample {
+    int device;
+    ControllerState state;
+};
+
+class ControllerHub {
+public:
+    // Called on the reactor thread that owns the device. With more than
+    // one reactor, calls for different devices can run concurrently.
+    using InputCallback = std::function<void(int device, const ControllerState&)>;
+
+private:
+    struct Device {
+        int index;
+        int fd;
+        bool owns_fd;
+        std::string port_name;
+        std::vector<int> controller_ids;
+        LineReader<> rx;
+        size_t outstanding;                             // GETs sent, not yet answered
+        std::chrono::steady_clock::time_point sent_at;
+        ClockSync clock;
+        std::atomic<uint64_t> samples;
+        std::atomic<uint64_t> timeouts;
+        std::atomic<bool> connected;                    // Cleared on a read/write error or hangup
+    };
+
+    struct Reactor {
+        int epoll_fd = -1;
+        int timer_fd = -1;
+        int wake_fd = -1;
+        std::vector<Device*> devices;
+        std::thread thread;
+    };
+
+    std::vector<std::unique_ptr<Device>> devices;
+    std::vector<Reactor> reactors;
+    InputCallback input_callback;
+    MpscQueue<HubSample>* event_queue;
+    std::atomic<bool> running;
+    std::chrono::milliseconds response_timeout;
+
+    // Stop watching a device whose port failed or hung up; the fd is level
+    // triggered, so leaving it registered would wake the reactor forever.
+    // A tick and a read can both fail in one epoll batch; only the first
+    // drops the device.
+    static void dropDevice(Reactor& reactor, Device& device) {
+        if (!device.connected.exchange(false, std::memory_order_relaxed)) {
+            return;
+        }
+        epoll_ctl(reactor.epoll_fd, EPOLL_CTL_DEL, device.fd, nullptr);
+        device.outstanding = 0;
+        std::cerr << "Serial port " << device.port_name << " closed" << std::endl;
+    }
+
+    // Fire one pipelined burst of GETs, one per controller on the device
+    static void sendBurst(Reactor& reactor, Device& device) {
+        char command[32];
+        for (int id : device.controller_ids) {
+            int length = std::snprintf(command, sizeof(command), "GET %d", id);
+            if (!writeLine(device.fd, std::string_view(command, static_cast<size_t>(length)))) {
+                dropDevice(reactor, device);
+                return;
+            }
+            device.outstanding++;
+        }
+        device.sent_at = std::chrono::steady_clock::now();
+    }
+
+    void onReadable(Reactor& reactor, Device& device, bool free_running) {
+        if (!readAvailable(device.fd, device.rx)) {
+            dropDevice(reactor, device);
+            return;
+        }
+
+        std::string_view line;
+        while (device.rx.nextLine(line)) {
+            ControllerState state;
+            ParseError error = parseInputLine(line, state);
+            if (error == ParseError::Disconnected && device.outstanding > 0) {
+                device.outstanding--; // Still the answer to a GET
+            }
+            if (error != ParseError::None) {
+                continue;
+            }
+
+            state.timestamp = std::chrono::steady_clock::now();
+            device.clock.addSample(state.device_time, device.sent_at, state.timestamp);
+            state.sample_time = device.clock.toHost(state.device_time, state.timestamp);
+            device.samples.fetch_add(1, std::memory_order_relaxed);
+            if (device.outstanding > 0) {
+                device.outstanding--;
+            }
+            if (event_queue) {
+                event_queue->tryPush(HubSample{device.index, state});
+            }
+            if (input_callback) {
+                input_callback(device.index, state);
+            }
+        }
+
+        // Without a poll rate the next burst goes out as soon as the last ends
+        if (free_running && device.outstanding == 0) {
+            sendBurst(reactor, device);
+        }
+    }
+
+    void onTick(Reactor& reactor) {
+        auto now = std::chrono::steady_clock::now();
+        for (Device* device : reactor.devices) {
+            if (!device->connected.load(std::memory_order_relaxed)) {
+                continue;
+            }
+            if (device->outstanding > 0) {
+                if (now - device->sent_at < response_timeout) {
+                    continue; // Still waiting; never queue a second burst
+                }
+                device->timeouts.fetch_add(1, std::memory_order_relaxed);
+                device->outstanding = 0;
+            }
+            sendBurst(reactor, *device);
+        }
+    }
+
+    void reactorLoop(Reactor& reactor, bool free_running) {
+        if (free_running) {
+            for (Device* device : reactor.devices) {
+                sendBurst(reactor, *device);
+            }
+        }
+
+        epoll_event events[64];
+
+        while (running.load(std::memory_order_relaxed)) {
+            int ready = epoll_wait(reactor.epoll_fd, events, 64, -1);
+            if (ready < 0) {
+                if (errno == EINTR) {
+                    continue;
+                }
+                std::cerr << "Hub epoll_wait failed" << std::endl;
+                break;
+            }
+
+            for (int i = 0; i < ready; i++) {
+                void* tag = events[i].data.ptr;
+
+                if (tag == &reactor.timer_fd) {
+                    uint64_t expirations;
+                    ssize_t ignored = read(reactor.timer_fd, &expirations, sizeof(expirations));
+                    (void)ignored;
+                    onTick(reactor);
+                } else if (tag != &reactor.wake_fd) {
+                    // Skip what is left of a device dropped earlier in this batch
+                    Device& device = *static_cast<Device*>(tag);
+                    if (device.connected.load(std::memory_order_relaxed)) {
+                        onReadable(reactor, device, free_running);
+                    }
+                }
+            }
+        }
+    }
+
+    static void closeReactor(Reactor& reactor) {
+        for (int* fd : {&reactor.epoll_fd, &reactor.timer_fd, &reactor.wake_fd}) {
+            if (*fd >= 0) {
+                close(*fd);
+                *fd = -1;
+            }
+        }
+        reactor.devices.clear();
+    }
+
+public:
+    ControllerHub() : event_queue(nullptr), running(false), response_timeout(1000) {}
+
+    ~ControllerHub() {
+        stop();
+        for (auto& device : devices) {
+            if (device->owns_fd && device->fd >= 0) {
+                close(device->fd);
+            }
+        }
+    }
+
+    ControllerHub(const ControllerHub&) = delete;
+    ControllerHub& operator=(const ControllerHub&) = delete;
+
+    // Open a serial port and poll the given controllers on it.
+    // Returns the device index used in callbacks, or -1 on failure.
+    int addDevice(const std::string& port_name, const std::vector<int>& controller_ids = {0},
+                  const SerialOptions& options = SerialOptions()) {
+        int fd = openSerialPort(port_name, options);
+        if (fd < 0) {
+            return -1;
+        }
+        return adoptDevice(fd, controller_ids, port_name, true);
+    }
+
+    // Use an already-open, non-blocking fd (e.g. a pty). The hub closes it
+    // on destruction only if owns_fd is set.
+    int adoptDevice(int fd, const std::vector<int>& controller_ids = {0},
+                    const std::string& name = "fd", bool owns_fd = false) {
+        if (running.load()) {
+            std::cerr << "Cannot add devices while the hub is running" << std::endl;
+            return -1;
+        }
+
+        auto device = std::make_unique<Device>();
+        device->index = static_cast<int>(devices.size());
+        device->fd = fd;
+        device->owns_fd = owns_fd;
+        device->port_name = name;
+        device->controller_ids = controller_ids;
+        device->outstanding = 0;
+        device->samples = 0;
+        device->timeouts = 0;
+        device->connected = true;
+        devices.push_back(std::move(device));
+        return devices.back()->index;
+    }
+
+    void setInputCallback(const InputCallback& callback) {
+        input_callback = callback;
+    }
+
+    // Push every sample to a queue shared by all reactor threads
+    void setEventQueue(MpscQueue<HubSample>* queue) {
+        event_queue = queue;
+    }
+
+    void setResponseTimeout(std::chrono::milliseconds timeout) {
+        response_timeout = timeout;
+    }
+
+    size_t deviceCount() const {
+        return devices.size();
+    }
+
+    // Poll every device fps times per second (fps <= 0: back-to-back bursts,
+    // as fast as each board answers) on reactor_threads epoll threads.
+    bool start(int fps = 60, size_t reactor_threads = 1) {
+        if (running.load()) {
+            std::cout << "Hub already running" << std::endl;
+            return false;
+        }
+
+        if (reactor_threads == 0) {
+            reactor_threads = 1;
+        }
+        if (reactor_threads > devices.size() && !devices.empty()) {
+            reactor_threads = devices.size();
+        }
+
+        reactors = std::vector<Reactor>(reactor_threads);
+        bool free_running = fps <= 0;
+
+        // A device dropped in an earlier run stays out; its port is gone
+        for (size_t i = 0; i < devices.size(); i++) {
+            if (devices[i]->connected.load()) {
+                reactors[i % reactor_threads].devices.push_back(devices[i].get());
+            }
+        }
+
+        for (auto& reactor : reactors) {
+            reactor.epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+            reactor.timer_fd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+            reactor.wake_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+
+            if (reactor.epoll_fd < 0 || reactor.timer_fd < 0 || reactor.wake_fd < 0) {
+                std::cerr << "Failed to create hub reactor" << std::endl;
+                for (auto& r : reactors) {
+                    closeReactor(r);
+                }
+                reactors.clear();
+                return false;
+            }
+
+            epoll_event event = {};
+            event.events = EPOLLIN;
+            event.data.ptr = &reactor.wake_fd;
+            epoll_ctl(reactor.epoll_fd, EPOLL_CTL_ADD, reactor.wake_fd, &event);
+
+            for (Device* device : reactor.devices) {
+                event.data.ptr = device;
+                epoll_ctl(reactor.epoll_fd, EPOLL_CTL_ADD, device->fd, &event);
+            }
+
+            // The tick also retires timed-out bursts in free-running mode
+            long period_ns = free_running ? response_timeout.count() * 1000000L : 1000000000L / fps;
+            struct itimerspec spec = {};
+            spec.it_interval.tv_sec = period_ns / 1000000000L;
+            spec.it_interval.tv_nsec = period_ns % 1000000000L;
+            spec.it_value = spec.it_interval;
+            if (!free_running) {
+                spec.it_value.tv_sec = 0;
+                spec.it_value.tv_nsec = 1; // First poll right away
+            }
+            timerfd_settime(reactor.timer_fd, 0, &spec, nullptr);
+
+            event.data.ptr = &reactor.timer_fd;
+            epoll_ctl(reactor.epoll_fd, EPOLL_CTL_ADD, reactor.timer_fd, &event);
+        }
+
+        running.store(true);
+        for (auto& reactor : reactors) {
+            reactor.thread = std::thread([this, &reactor, free_running]() {
+                reactorLoop(reactor, free_running);
+            });
+        }
+
+        std::cout << "Hub polling " << devices.size() << " device(s) on "
+                  << reactors.size() << " reactor thread(s)" << std::endl;
+        return true;
+    }
+
+    void stop() {
+        if (!running.load()) {
+            return;
+        }
+
+        running.store(false);
+        for (auto& reactor : reactors) {
+            uint64_t one = 1;
+            ssize_t ignored = write(reactor.wake_fd, &one, sizeof(one));
+            (void)ignored;
+        }
+        for (auto& reactor : reactors) {
+            if (reactor.thread.joinable()) {
+                reactor.thread.join();
+            }
+            closeReactor(reactor);
+        }
+        reactors.clear();
+
+        for (auto& device : devices) {
+            device->outstanding = 0;
+            device->rx.clear();
+        }
+    }
+
+    // False once the device's port failed or hung up
+    bool deviceConnected(int device) const {
+        return devices.at(static_cast<size_t>(device))->connected.load(std::memory_order_relaxed);
+    }
+
+    uint64_t samplesReceived(int device) const {
+        return devices.at(static_cast<size_t>(device))->samples.load(std::memory_order_relaxed);
+    }
+
+    uint64_t samplesReceived() const {
+        uint64_t total = 0;
+        for (const auto& device : devices) {
+            total += device->samples.load(std::memory_order_relaxed);
+        }
+        return total;
+    }
+
+    ClockEstimate clockEstimate(int device) const {
+        return devices.at(static_cast<size_t>(device))->clock.estimate();
+    }
+
+    uint64_t timeouts() const {
+        uint64_t total = 0;
+        for (const auto& device : devices) {
+            total += device->timeouts.load(std::memory_order_relaxed);
+        }
+        return total;
+    }
+};
+
+} // namespace insen
+
+#endif // __linux__
+
+#endif // INSEN_HUB_HPP
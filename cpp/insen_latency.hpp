@@ -0,0 +1,281 @@
+/*
+ * INSEN Controller Client - Latency histograms
+ * //madebybunnyrce
+ * HDR-style log-linear histograms: 32 linear sub-buckets per power of two,
+ * so any recorded value is reported within ~3% from 1 ns up to ~17 s.
+ * Recording is three relaxed fetch_adds (bucket, count, sum) plus
+ * compare-exchange loops for min and max that only retry when the value
+ * is a new extreme, cheap enough for every exchange on the I/O path;
+ * snapshots and reports can be taken from any thread.
+ */
+
+#ifndef INSEN_LATENCY_HPP
+#define INSEN_LATENCY_HPP
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <memory>
+#include <ostream>
+#include <vector>
+
+#include "insen_command.hpp"
+#include "insen_state_table.hpp"
+
+namespace insen {
+
+namespace detail {
+
+constexpr unsigned latency_sub_bits = 5;
+constexpr uint64_t latency_sub_count = uint64_t(1) << latency_sub_bits;
+constexpr unsigned latency_max_exponent = 34;   // 2^34 ns, about 17 s
+constexpr size_t latency_bucket_count = (latency_max_exponent - latency_sub_bits + 2) * latency_sub_count;
+
+inline unsigned highestBit(uint64_t value) {
+#if defined(__GNUC__)
+    return 63u - static_cast<unsigned>(__builtin_clzll(value));
+#else
+    unsigned bit = 0;
+    while (value >>= 1) {
+        bit++;
+    }
+    return bit;
+#endif
+}
+
+inline size_t latencyBucket(uint64_t ns) {
+    if (ns < latency_sub_count) {
+        return static_cast<size_t>(ns);
+    }
+    unsigned exponent = highestBit(ns);
+    if (exponent > latency_max_exponent) {
+        return latency_bucket_count - 1;
+    }
+    unsigned shift = exponent - latency_sub_bits;
+    return (shift + 1) * latency_sub_count + ((ns >> shift) - latency_sub_count);
+}
+
+// Largest value that lands in bucket
+inline uint64_t latencyBucketHigh(size_t bucket) {
+    if (bucket < latency_sub_count) {
+        return bucket;
+    }
+    uint64_t shift = bucket / latency_sub_count - 1;
+    uint64_t sub = bucket % latency_sub_count + latency_sub_count;
+    return ((sub + 1) << shift) - 1;
+}
+
+} // namespace detail
+
+// Point-in-time copy of a histogram; all values in nanoseconds
+struct LatencySnapshot {
+    std::vector<uint64_t> counts;
+    uint64_t total = 0;
+    uint64_t sum_ns = 0;
+    uint64_t min_ns = 0;
+    uint64_t max_ns = 0;
+
+    double mean() const {
+        return total ? static_cast<double>(sum_ns) / static_cast<double>(total) : 0.0;
+    }
+
+    // Value at or below which the given percentile (0-100) of samples fall
+    uint64_t percentile(double p) const {
+        if (total == 0) {
+            return 0;
+        }
+        auto rank = static_cast<uint64_t>(p / 100.0 * static_cast<double>(total) + 0.5);
+        rank = rank < 1 ? 1 : (rank > total ? total : rank);
+
+        uint64_t seen = 0;
+        for (size_t i = 0; i < counts.size(); i++) {
+            seen += counts[i];
+            if (seen >= rank) {
+                uint64_t high = detail::latencyBucketHigh(i);
+                return high < max_ns ? high : max_ns;
+            }
+        }
+        return max_ns;
+    }
+};
+
+class LatencyHistogram {
+private:
+    std::unique_ptr<std::atomic<uint64_t>[]> counts;
+    std::atomic<uint64_t> total;
+    std::atomic<uint64_t> sum_ns;
+    std::atomic<uint64_t> min_ns;
+    std::atomic<uint64_t> max_ns;
+
+public:
+    LatencyHistogram()
+        : counts(new std::atomic<uint64_t>[detail::latency_bucket_count]), total(0), sum_ns(0),
+          min_ns(UINT64_MAX), max_ns(0) {
+        reset();
+    }
+
+    LatencyHistogram(const LatencyHistogram&) = delete;
+    LatencyHistogram& operator=(const LatencyHistogram&) = delete;
+
+    void record(uint64_t ns) {
+        counts[detail::latencyBucket(ns)].fetch_add(1, std::memory_order_relaxed);
+        total.fetch_add(1, std::memory_order_relaxed);
+        sum_ns.fetch_add(ns, std::memory_order_relaxed);
+
+        uint64_t low = min_ns.load(std::memory_order_relaxed);
+        while (ns < low && !min_ns.compare_exchange_weak(low, ns, std::memory_order_relaxed)) {
+        }
+        uint64_t high = max_ns.load(std::memory_order_relaxed);
+        while (ns > high && !max_ns.compare_exchange_weak(high, ns, std::memory_order_relaxed)) {
+        }
+    }
+
+    void record(std::chrono::steady_clock::duration elapsed) {
+        auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count();
+        record(static_cast<uint64_t>(ns > 0 ? ns : 0));
+    }
+
+    uint64_t count() const {
+        return total.load(std::memory_order_relaxed);
+    }
+
+    // Counters are read one by one, so a snapshot taken while recording
+    // may be off by the few samples that land during the copy
+    LatencySnapshot snapshot() const {
+        LatencySnapshot snap;
+        snap.counts.resize(detail::latency_bucket_count);
+        for (size_t i = 0; i < detail::latency_bucket_count; i++) {
+            snap.counts[i] = counts[i].load(std::memory_order_relaxed);
+            snap.total += snap.counts[i];
+        }
+        snap.sum_ns = sum_ns.load(std::memory_order_relaxed);
+        snap.min_ns = snap.total ? min_ns.load(std::memory_order_relaxed) : 0;
+        snap.max_ns = max_ns.load(std::memory_order_relaxed);
+        return snap;
+    }
+
+    void reset() {
+        for (size_t i = 0; i < detail::latency_bucket_count; i++) {
+            counts[i].store(0, std::memory_order_relaxed);
+        }
+        total.store(0, std::memory_order_relaxed);
+        sum_ns.store(0, std::memory_order_relaxed);
+        min_ns.store(UINT64_MAX, std::memory_order_relaxed);
+        max_ns.store(0, std::memory_order_relaxed);
+    }
+};
+
+enum class LatencyMetric {
+    FirstByte,      // Command written -> first response byte read
+    Line,           // Command written -> complete response line
+    Parse,          // Parsing an INPUT line
+    Callback,       // Delivering a state to the queue and callbacks
+    Age             // Device sample time (clock-synced) -> delivery starts
+};
+
+constexpr size_t latency_metric_count = 5;
+
+inline const char* latencyMetricName(LatencyMetric metric) {
+    switch (metric) {
+        case LatencyMetric::FirstByte: return "first_byte";
+        case LatencyMetric::Line: return "line";
+        case LatencyMetric::Parse: return "parse";
+        case LatencyMetric::Callback: return "callback";
+        case LatencyMetric::Age: return "age";
+    }
+    return "?";
+}
+
+struct LatencyEntry {
+    CommandType type;
+    int controller_id;      // -1 unless type is Get
+    LatencyMetric metric;
+    LatencySnapshot snapshot;
+};
+
+// Histograms per command type and metric, with GET further split by
+// controller id (ids beyond Controllers share one GET row)
+template <size_t Controllers = default_max_controllers>
+class LatencyStats {
+private:
+    static constexpr size_t row_count = command_type_count + Controllers;
+
+    std::vector<std::unique_ptr<LatencyHistogram>> histograms;
+
+    static size_t row(CommandType type, int controller_id) {
+        if (type == CommandType::Get && controller_id >= 0 && static_cast<size_t>(controller_id) < Controllers) {
+            return command_type_count + static_cast<size_t>(controller_id);
+        }
+        return static_cast<size_t>(type);
+    }
+
+public:
+    LatencyStats() {
+        for (size_t i = 0; i < row_count * latency_metric_count; i++) {
+            histograms.push_back(std::make_unique<LatencyHistogram>());
+        }
+    }
+
+    LatencyHistogram& histogram(CommandType type, int controller_id, LatencyMetric metric) {
+        return *histograms[row(type, controller_id) * latency_metric_count + static_cast<size_t>(metric)];
+    }
+
+    void record(CommandType type, int controller_id, LatencyMetric metric,
+                std::chrono::steady_clock::duration elapsed) {
+        histogram(type, controller_id, metric).record(elapsed);
+    }
+
+    // Every non-empty histogram
+    std::vector<LatencyEntry> snapshot() const {
+        std::vector<LatencyEntry> entries;
+        for (size_t r = 0; r < row_count; r++) {
+            for (size_t m = 0; m < latency_metric_count; m++) {
+                const LatencyHistogram& hist = *histograms[r * latency_metric_count + m];
+                if (hist.count() == 0) {
+                    continue;
+                }
+                bool per_id = r >= command_type_count;
+                entries.push_back(LatencyEntry{
+                    per_id ? CommandType::Get : static_cast<CommandType>(r),
+                    per_id ? static_cast<int>(r - command_type_count) : -1,
+                    static_cast<LatencyMetric>(m),
+                    hist.snapshot()});
+            }
+        }
+        return entries;
+    }
+
+    void reset() {
+        for (auto& hist : histograms) {
+            hist->reset();
+        }
+    }
+
+    // One line per non-empty histogram, times in microseconds
+    void dump(std::ostream& out) const {
+        char line[160];
+        std::snprintf(line, sizeof(line), "%-8s %3s %-10s %10s %9s %9s %9s %9s %9s\n",
+                      "command", "id", "metric", "count", "p50_us", "p90_us", "p99_us", "p999_us", "max_us");
+        out << line;
+
+        for (const auto& entry : snapshot()) {
+            const LatencySnapshot& snap = entry.snapshot;
+            char id[8] = "-";
+            if (entry.controller_id >= 0) {
+                std::snprintf(id, sizeof(id), "%d", entry.controller_id);
+            }
+            std::snprintf(line, sizeof(line), "%-8s %3s %-10s %10llu %9.1f %9.1f %9.1f %9.1f %9.1f\n",
+                          commandTypeName(entry.type), id, latencyMetricName(entry.metric),
+                          static_cast<unsigned long long>(snap.total),
+                          snap.percentile(50) / 1e3, snap.percentile(90) / 1e3, snap.percentile(99) / 1e3,
+                          snap.percentile(99.9) / 1e3, snap.max_ns / 1e3);
+            out << line;
+        }
+    }
+};
+
+} // namespace insen
+
+#endif // INSEN_LATENCY_HPP
@@ -0,0 +1,93 @@
+/*
+ * INSEN Controller Client - Line framing receive buffer
+ * //madebybunnyrce
+ * Persistent per-connection receive buffer that frames "\r\n"-terminated
+ * response lines and hands them out as string views into its own storage.
+ * Bytes that arrive split across reads or merged into one read are kept
+ * until a full line is available, so no response is lost or glued together.
+ * Binary sample frames (0x00-delimited, see insen_wire.h) are framed the
+ * same way and handed out with their leading 0x00, so parsers can tell
+ * them from text. The framing rules are the protocol core's
+ * (insen_frame_next in insen_protocol.h), shared with the C client.
+ */
+
+#ifndef INSEN_LINE_READER_HPP
+#define INSEN_LINE_READER_HPP
+
+#include <array>
+#include <cstddef>
+#include <cstring>
+#include <string_view>
+
+#include "insen_protocol.h"
+
+namespace insen {
+
+template <size_t Capacity = 4096>
+class LineReader {
+private:
+    std::array<char, Capacity> buffer;
+    size_t head;        // First unconsumed byte
+    size_t tail;        // One past the last received byte
+    size_t scanned;     // Bytes after head already searched for '\n'
+    size_t overflows;   // Lines dropped because they did not fit
+
+public:
+    LineReader() : head(0), tail(0), scanned(0), overflows(0) {}
+
+    // Where the next read() should land. Reclaims consumed space first so
+    // the free region is always contiguous; only a partial line is moved.
+    char* writePtr() {
+        if (head > 0 && (head == tail || Capacity - tail < Capacity / 4)) {
+            std::memmove(buffer.data(), buffer.data() + head, tail - head);
+            tail -= head;
+            head = 0;
+        }
+
+        if (tail == Capacity) {
+            // A single line larger than the buffer: drop it and resync
+            head = tail = scanned = 0;
+            overflows++;
+        }
+
+        return buffer.data() + tail;
+    }
+
+    size_t writeSpace() const {
+        return Capacity - tail;
+    }
+
+    void commit(size_t bytes) {
+        tail += bytes;
+    }
+
+    // Fetch the next complete line without its terminator, or the next
+    // binary frame with its leading delimiter but not its trailing one.
+    // Empty lines and frames are skipped. The view stays valid until the
+    // next writePtr() call.
+    bool nextLine(std::string_view& line) {
+        insen_frame_t frame;
+        bool found = insen_frame_next(buffer.data() + head, tail - head, &scanned, &frame) != 0;
+        head += frame.consumed;
+        if (found) {
+            line = std::string_view(frame.message, frame.length);
+        }
+        return found;
+    }
+
+    size_t buffered() const {
+        return tail - head;
+    }
+
+    size_t overflowCount() const {
+        return overflows;
+    }
+
+    void clear() {
+        head = tail = scanned = 0;
+    }
+};
+
+} // namespace insen
+
+#endif // INSEN_LINE_READER_HPP
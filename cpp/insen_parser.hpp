@@ -0,0 +1,86 @@
+/*
+ * INSEN Controller Client - INPUT line parser
+ * //madebybunnyrce
+ * Parses "[>>> ]INPUT|ID|LX,LY|RX,RY|LT,RT|BUTTONS|DPAD|BATTERY|TIMESTAMP"
+ * lines and binary sample frames from LineReader into ControllerState.
+ * The decoding itself is the shared protocol core (insen_protocol.h), the
+ * same code the C client uses. No exceptions, no temporaries, no heap:
+ * errors come back as a ParseError code.
+ */
+
+#ifndef INSEN_PARSER_HPP
+#define INSEN_PARSER_HPP
+
+#include <cstdint>
+#include <string_view>
+
+#include "insen_protocol.h"
+#include "insen_state.hpp"
+
+namespace insen {
+
+enum class ParseError : uint8_t {
+    None = INSEN_DECODE_OK,
+    NotInput = INSEN_DECODE_UNEXPECTED,             // Some other response (STATUS, LIST, ...)
+    MissingField = INSEN_DECODE_MISSING_FIELD,      // Fewer fields than the INPUT format requires
+    BadNumber = INSEN_DECODE_BAD_NUMBER,            // A field is not a number
+    OutOfRange = INSEN_DECODE_OUT_OF_RANGE,         // A number does not fit its field
+    Disconnected = INSEN_DECODE_DISCONNECTED,       // "INPUT|id|DISCONNECTED"; only state.id is set
+    BadFrame = INSEN_DECODE_BAD_FRAME               // Binary frame with a bad size, encoding or CRC
+};
+
+inline const char* parseErrorString(ParseError error) {
+    switch (error) {
+        case ParseError::None:
+            return "Success";
+        case ParseError::NotInput:
+            return "Not an INPUT response";
+        case ParseError::MissingField:
+            return "Missing field";
+        case ParseError::BadNumber:
+            return "Malformed number";
+        case ParseError::OutOfRange:
+            return "Value out of range";
+        case ParseError::Disconnected:
+            return "Controller disconnected";
+        case ParseError::BadFrame:
+            return "Corrupt binary frame";
+        default:
+            return "Unknown error";
+    }
+}
+
+// LineReader hands out binary frames with their leading 0x00
+inline bool isBinaryFrame(std::string_view line) noexcept {
+    return !line.empty() && line.front() == '\0';
+}
+
+// Parse one INPUT line (with or without the ">>> " prompt) or binary frame
+// into state. On error state is not updated, except state.id for
+// Disconnected. The trailing timestamp field is optional (device_time is 0
+// without it).
+inline ParseError parseInputLine(std::string_view line, ControllerState& state) noexcept {
+    Sample sample;
+    auto error = static_cast<ParseError>(insen_decode_input(line.data(), line.size(), &sample));
+
+    if (error == ParseError::None) {
+        state.left_stick_x = sample.left_stick_x;
+        state.left_stick_y = sample.left_stick_y;
+        state.right_stick_x = sample.right_stick_x;
+        state.right_stick_y = sample.right_stick_y;
+        state.left_trigger = sample.left_trigger;
+        state.right_trigger = sample.right_trigger;
+        state.buttons = sample.buttons;
+        state.dpad = sample.dpad;
+        state.battery = sample.battery_level;
+        state.id = sample.controller_id;
+        state.device_time = sample.timestamp;
+    } else if (error == ParseError::Disconnected) {
+        state.id = sample.controller_id;
+    }
+    return error;
+}
+
+} // namespace insen
+
+#endif // INSEN_PARSER_HPP
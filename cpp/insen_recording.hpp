@@ -0,0 +1,516 @@
+/*
+ * INSEN Controller Client - Session recording
+ * //madebybunnyrce
+ * Compact binary capture of every sample from the monitor path.
+ *
+ * File layout (all integers little-endian):
+ *
+ *   File header
+ *     char[8]  "INSENREC"
+ *     u16      format version (1)
+ *     u16      header size in bytes, including the INFO text
+ *     u32      reserved
+ *     i64      steady_clock time at open, ns
+ *     i64      system_clock time at open, ns since the Unix epoch
+ *     u16      INFO text length, then the INFO response text
+ *
+ *   Chunks, repeated until end of file
+ *     u32      "INSC"
+ *     u32      payload size in bytes
+ *     u32      sample count
+ *     u32      reserved
+ *     i64      steady_clock time of the chunk's first sample, ns
+ *     payload  sample records
+ *
+ *   Sample record
+ *     u8       controller id
+ *     u16      change mask (CHANGE_* bits), vs. the previous sample of the
+ *              same controller in this chunk (all zero at chunk start)
+ *     varint   ns since the previous sample in the chunk
+ *     fields   one per set bit, in bit order: sticks, triggers and the
+ *              firmware timestamp as zig-zag varint deltas, buttons as a
+ *              varint XOR, dpad and battery as raw bytes
+ *
+ * Chunks are self-contained, so a reader can start at any of them.
+ */
+
+#ifndef INSEN_RECORDING_HPP
+#define INSEN_RECORDING_HPP
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+#include "insen_event_queue.hpp"
+#include "insen_state.hpp"
+
+namespace insen {
+
+namespace recording {
+
+constexpr char file_magic[8] = {'I', 'N', 'S', 'E', 'N', 'R', 'E', 'C'};
+constexpr uint32_t chunk_magic = 0x43534E49; // "INSC"
+constexpr uint16_t format_version = 1;
+constexpr size_t file_header_fixed_size = 34;
+constexpr size_t chunk_header_size = 24;
+
+enum ChangeBits : uint16_t {
+    CHANGE_LEFT_STICK_X = 1 << 0,
+    CHANGE_LEFT_STICK_Y = 1 << 1,
+    CHANGE_RIGHT_STICK_X = 1 << 2,
+    CHANGE_RIGHT_STICK_Y = 1 << 3,
+    CHANGE_LEFT_TRIGGER = 1 << 4,
+    CHANGE_RIGHT_TRIGGER = 1 << 5,
+    CHANGE_BUTTONS = 1 << 6,
+    CHANGE_DPAD = 1 << 7,
+    CHANGE_BATTERY = 1 << 8,
+    CHANGE_TIMESTAMP = 1 << 9
+};
+
+struct FileHeader {
+    uint16_t version;
+    uint16_t header_size;
+    int64_t start_host_ns;
+    int64_t start_wall_ns;
+    std::string device_info;    // INFO response of the recorded device
+};
+
+struct ChunkHeader {
+    uint32_t payload_size;
+    uint32_t sample_count;
+    int64_t base_host_ns;
+};
+
+inline void putU16(std::vector<uint8_t>& out, uint16_t value) {
+    out.push_back(static_cast<uint8_t>(value));
+    out.push_back(static_cast<uint8_t>(value >> 8));
+}
+
+inline void putU32(std::vector<uint8_t>& out, uint32_t value) {
+    for (int i = 0; i < 4; i++) {
+        out.push_back(static_cast<uint8_t>(value >> (8 * i)));
+    }
+}
+
+inline void putI64(std::vector<uint8_t>& out, int64_t value) {
+    for (int i = 0; i < 8; i++) {
+        out.push_back(static_cast<uint8_t>(static_cast<uint64_t>(value) >> (8 * i)));
+    }
+}
+
+inline void putVarint(std::vector<uint8_t>& out, uint64_t value) {
+    while (value >= 0x80) {
+        out.push_back(static_cast<uint8_t>(value | 0x80));
+        value >>= 7;
+    }
+    out.push_back(static_cast<uint8_t>(value));
+}
+
+inline uint64_t zigzag(int64_t value) {
+    return (static_cast<uint64_t>(value) << 1) ^ static_cast<uint64_t>(value >> 63);
+}
+
+inline int64_t unzigzag(uint64_t value) {
+    return static_cast<int64_t>(value >> 1) ^ -static_cast<int64_t>(value & 1);
+}
+
+inline uint16_t getU16(const uint8_t* p) {
+    return static_cast<uint16_t>(p[0] | (p[1] << 8));
+}
+
+inline uint32_t getU32(const uint8_t* p) {
+    return static_cast<uint32_t>(p[0]) | (static_cast<uint32_t>(p[1]) << 8) |
+           (static_cast<uint32_t>(p[2]) << 16) | (static_cast<uint32_t>(p[3]) << 24);
+}
+
+inline int64_t getI64(const uint8_t* p) {
+    uint64_t value = 0;
+    for (int i = 7; i >= 0; i--) {
+        value = (value << 8) | p[i];
+    }
+    return static_cast<int64_t>(value);
+}
+
+// Returns false on a truncated or over-long varint
+inline bool getVarint(const uint8_t*& p, const uint8_t* end, uint64_t& value) {
+    value = 0;
+    for (int shift = 0; shift < 64 && p < end; shift += 7) {
+        uint8_t byte = *p++;
+        value |= static_cast<uint64_t>(byte & 0x7F) << shift;
+        if (!(byte & 0x80)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+inline std::vector<uint8_t> encodeFileHeader(const FileHeader& header) {
+    std::vector<uint8_t> out(file_magic, file_magic + sizeof(file_magic));
+    size_t info_length = header.device_info.size() < 0xFFFF ? header.device_info.size() : 0xFFFF;
+    putU16(out, format_version);
+    putU16(out, static_cast<uint16_t>(file_header_fixed_size + info_length));
+    putU32(out, 0);
+    putI64(out, header.start_host_ns);
+    putI64(out, header.start_wall_ns);
+    putU16(out, static_cast<uint16_t>(info_length));
+    out.insert(out.end(), header.device_info.begin(), header.device_info.begin() + info_length);
+    return out;
+}
+
+inline bool decodeFileHeader(const uint8_t* data, size_t size, FileHeader& header) {
+    if (size < file_header_fixed_size || std::memcmp(data, file_magic, sizeof(file_magic)) != 0) {
+        return false;
+    }
+
+    header.version = getU16(data + 8);
+    header.header_size = getU16(data + 10);
+    header.start_host_ns = getI64(data + 16);
+    header.start_wall_ns = getI64(data + 24);
+    uint16_t info_length = getU16(data + 32);
+
+    if (header.version != format_version || header.header_size > size ||
+        file_header_fixed_size + info_length > header.header_size) {
+        return false;
+    }
+
+    header.device_info.assign(reinterpret_cast<const char*>(data + file_header_fixed_size), info_length);
+    return true;
+}
+
+// Delta-encodes samples into one chunk payload
+class ChunkEncoder {
+private:
+    std::array<Sample, 256> previous;
+    std::vector<uint8_t> payload;
+    uint32_t samples;
+    int64_t base_host_ns;
+    int64_t last_host_ns;
+
+public:
+    ChunkEncoder() {
+        payload.reserve(64 * 1024 + 64);
+        reset();
+    }
+
+    void reset() {
+        previous.fill(Sample{});
+        payload.clear();
+        samples = 0;
+        base_host_ns = last_host_ns = 0;
+    }
+
+    void add(const Sample& sample, int64_t host_ns) {
+        if (samples == 0) {
+            base_host_ns = last_host_ns = host_ns;
+        }
+
+        Sample& prev = previous[sample.controller_id];
+        uint16_t mask = 0;
+        mask |= (sample.left_stick_x != prev.left_stick_x) ? CHANGE_LEFT_STICK_X : 0;
+        mask |= (sample.left_stick_y != prev.left_stick_y) ? CHANGE_LEFT_STICK_Y : 0;
+        mask |= (sample.right_stick_x != prev.right_stick_x) ? CHANGE_RIGHT_STICK_X : 0;
+        mask |= (sample.right_stick_y != prev.right_stick_y) ? CHANGE_RIGHT_STICK_Y : 0;
+        mask |= (sample.left_trigger != prev.left_trigger) ? CHANGE_LEFT_TRIGGER : 0;
+        mask |= (sample.right_trigger != prev.right_trigger) ? CHANGE_RIGHT_TRIGGER : 0;
+        mask |= (sample.buttons != prev.buttons) ? CHANGE_BUTTONS : 0;
+        mask |= (sample.dpad != prev.dpad) ? CHANGE_DPAD : 0;
+        mask |= (sample.battery_level != prev.battery_level) ? CHANGE_BATTERY : 0;
+        mask |= (sample.timestamp != prev.timestamp) ? CHANGE_TIMESTAMP : 0;
+
+        payload.push_back(sample.controller_id);
+        putU16(payload, mask);
+        putVarint(payload, static_cast<uint64_t>(host_ns >= last_host_ns ? host_ns - last_host_ns : 0));
+
+        if (mask & CHANGE_LEFT_STICK_X) putVarint(payload, zigzag(sample.left_stick_x - prev.left_stick_x));
+        if (mask & CHANGE_LEFT_STICK_Y) putVarint(payload, zigzag(sample.left_stick_y - prev.left_stick_y));
+        if (mask & CHANGE_RIGHT_STICK_X) putVarint(payload, zigzag(sample.right_stick_x - prev.right_stick_x));
+        if (mask & CHANGE_RIGHT_STICK_Y) putVarint(payload, zigzag(sample.right_stick_y - prev.right_stick_y));
+        if (mask & CHANGE_LEFT_TRIGGER) putVarint(payload, zigzag(sample.left_trigger - prev.left_trigger));
+        if (mask & CHANGE_RIGHT_TRIGGER) putVarint(payload, zigzag(sample.right_trigger - prev.right_trigger));
+        if (mask & CHANGE_BUTTONS) putVarint(payload, static_cast<uint16_t>(sample.buttons ^ prev.buttons));
+        if (mask & CHANGE_DPAD) payload.push_back(sample.dpad);
+        if (mask & CHANGE_BATTERY) payload.push_back(sample.battery_level);
+        if (mask & CHANGE_TIMESTAMP) {
+            putVarint(payload, zigzag(static_cast<int64_t>(sample.timestamp) - static_cast<int64_t>(prev.timestamp)));
+        }
+
+        prev = sample;
+        last_host_ns = host_ns > last_host_ns ? host_ns : last_host_ns;
+        samples++;
+    }
+
+    uint32_t sampleCount() const {
+        return samples;
+    }
+
+    size_t payloadSize() const {
+        return payload.size();
+    }
+
+    // Chunk header followed by the payload
+    void finish(std::vector<uint8_t>& out) const {
+        putU32(out, chunk_magic);
+        putU32(out, static_cast<uint32_t>(payload.size()));
+        putU32(out, samples);
+        putU32(out, 0);
+        putI64(out, base_host_ns);
+        out.insert(out.end(), payload.begin(), payload.end());
+    }
+};
+
+inline bool decodeChunkHeader(const uint8_t* data, size_t size, ChunkHeader& header) {
+    if (size < chunk_header_size || getU32(data) != chunk_magic) {
+        return false;
+    }
+    header.payload_size = getU32(data + 4);
+    header.sample_count = getU32(data + 8);
+    header.base_host_ns = getI64(data + 16);
+    return chunk_header_size + static_cast<size_t>(header.payload_size) <= size;
+}
+
+// Decode one chunk payload, calling fn(const Sample&, int64_t host_ns) per
+// sample. Returns the number of samples decoded; stops early on corruption,
+// or after the current sample if fn returns false.
+template <typename Fn>
+size_t decodeChunk(const ChunkHeader& header, const uint8_t* payload, Fn&& fn) {
+    std::array<Sample, 256> previous;
+    previous.fill(Sample{});
+
+    const uint8_t* p = payload;
+    const uint8_t* end = payload + header.payload_size;
+    int64_t host_ns = header.base_host_ns;
+    size_t decoded = 0;
+
+    auto signedDelta = [&](int64_t base, int64_t& value) {
+        uint64_t raw;
+        if (!getVarint(p, end, raw)) {
+            return false;
+        }
+        value = base + unzigzag(raw);
+        return true;
+    };
+
+    while (decoded < header.sample_count && end - p >= 3) {
+        Sample& sample = previous[*p++];
+        uint16_t mask = getU16(p);
+        p += 2;
+
+        uint64_t host_delta;
+        if (!getVarint(p, end, host_delta)) {
+            break;
+        }
+        host_ns += static_cast<int64_t>(host_delta);
+
+        int64_t value = 0;
+        bool ok = true;
+        if (ok && (mask & CHANGE_LEFT_STICK_X) && (ok = signedDelta(sample.left_stick_x, value))) sample.left_stick_x = static_cast<int16_t>(value);
+        if (ok && (mask & CHANGE_LEFT_STICK_Y) && (ok = signedDelta(sample.left_stick_y, value))) sample.left_stick_y = static_cast<int16_t>(value);
+        if (ok && (mask & CHANGE_RIGHT_STICK_X) && (ok = signedDelta(sample.right_stick_x, value))) sample.right_stick_x = static_cast<int16_t>(value);
+        if (ok && (mask & CHANGE_RIGHT_STICK_Y) && (ok = signedDelta(sample.right_stick_y, value))) sample.right_stick_y = static_cast<int16_t>(value);
+        if (ok && (mask & CHANGE_LEFT_TRIGGER) && (ok = signedDelta(sample.left_trigger, value))) sample.left_trigger = static_cast<uint8_t>(value);
+        if (ok && (mask & CHANGE_RIGHT_TRIGGER) && (ok = signedDelta(sample.right_trigger, value))) sample.right_trigger = static_cast<uint8_t>(value);
+        if (ok && (mask & CHANGE_BUTTONS)) {
+            uint64_t flipped;
+            ok = getVarint(p, end, flipped);
+            sample.buttons = static_cast<uint16_t>(sample.buttons ^ flipped);
+        }
+        if (ok && (mask & CHANGE_DPAD)) {
+            ok = p < end;
+            sample.dpad = ok ? *p++ : 0;
+        }
+        if (ok && (mask & CHANGE_BATTERY)) {
+            ok = p < end;
+            sample.battery_level = ok ? *p++ : 0;
+        }
+        if (ok && (mask & CHANGE_TIMESTAMP) && (ok = signedDelta(sample.timestamp, value))) {
+            sample.timestamp = static_cast<uint32_t>(value);
+        }
+        if (!ok) {
+            break;
+        }
+
+        sample.controller_id = static_cast<uint8_t>(&sample - previous.data());
+        decoded++;
+        if constexpr (std::is_same<std::invoke_result_t<Fn&, const Sample&, int64_t>, bool>::value) {
+            if (!fn(static_cast<const Sample&>(sample), host_ns)) {
+                break;
+            }
+        } else {
+            fn(static_cast<const Sample&>(sample), host_ns);
+        }
+    }
+
+    return decoded;
+}
+
+} // namespace recording
+
+// Appends samples from the monitor path to a recording file. record() only
+// pushes into a lock-free queue (safe from several I/O threads at once);
+// a background flusher encodes chunks and writes them out.
+class SessionRecorder {
+private:
+    struct Entry {
+        Sample sample;
+        int64_t host_ns;
+    };
+
+    MpscQueue<Entry> queue;
+    std::FILE* file;
+    std::thread flusher;
+    std::atomic<bool> running;
+    std::atomic<uint64_t> recorded;
+    std::atomic<uint64_t> bytes_written;
+    size_t chunk_bytes;
+    std::chrono::milliseconds flush_interval;
+
+    bool writeAll(const std::vector<uint8_t>& data) {
+        if (std::fwrite(data.data(), 1, data.size(), file) != data.size()) {
+            std::cerr << "Failed to write recording" << std::endl;
+            return false;
+        }
+        bytes_written.fetch_add(data.size(), std::memory_order_relaxed);
+        return true;
+    }
+
+    void flushLoop() {
+        recording::ChunkEncoder encoder;
+        std::vector<uint8_t> out;
+        auto chunk_started = std::chrono::steady_clock::now();
+        bool stopping = false;
+
+        while (!stopping) {
+            stopping = !running.load(std::memory_order_acquire);
+
+            size_t drained = queue.drain([&](const Entry& entry) {
+                if (encoder.sampleCount() == 0) {
+                    chunk_started = std::chrono::steady_clock::now();
+                }
+                encoder.add(entry.sample, entry.host_ns);
+                recorded.fetch_add(1, std::memory_order_relaxed);
+
+                if (encoder.payloadSize() >= chunk_bytes) {
+                    out.clear();
+                    encoder.finish(out);
+                    writeAll(out);
+                    encoder.reset();
+                }
+            });
+
+            bool stale = encoder.sampleCount() > 0 &&
+                         std::chrono::steady_clock::now() - chunk_started >= flush_interval;
+            if (encoder.sampleCount() > 0 && (stale || stopping)) {
+                out.clear();
+                encoder.finish(out);
+                writeAll(out);
+                encoder.reset();
+                std::fflush(file);
+            }
+
+            if (drained == 0 && !stopping) {
+                std::this_thread::sleep_for(std::chrono::milliseconds(2));
+            }
+        }
+
+        std::fflush(file);
+    }
+
+public:
+    explicit SessionRecorder(size_t queue_capacity = 65536)
+        : queue(queue_capacity), file(nullptr), running(false), recorded(0), bytes_written(0),
+          chunk_bytes(64 * 1024), flush_interval(1000) {}
+
+    ~SessionRecorder() {
+        close();
+    }
+
+    SessionRecorder(const SessionRecorder&) = delete;
+    SessionRecorder& operator=(const SessionRecorder&) = delete;
+
+    // Create path and write the file header. device_info is the device's
+    // INFO response (see Controller::deviceInfo()).
+    bool open(const std::string& path, const std::string& device_info) {
+        if (file) {
+            std::cerr << "Recorder already open" << std::endl;
+            return false;
+        }
+
+        file = std::fopen(path.c_str(), "wb");
+        if (!file) {
+            std::cerr << "Failed to open recording " << path << std::endl;
+            return false;
+        }
+
+        recording::FileHeader header;
+        header.version = recording::format_version;
+        header.header_size = 0;
+        header.start_host_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count();
+        header.start_wall_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::system_clock::now().time_since_epoch()).count();
+        header.device_info = device_info;
+
+        if (!writeAll(recording::encodeFileHeader(header))) {
+            std::fclose(file);
+            file = nullptr;
+            return false;
+        }
+
+        running.store(true, std::memory_order_release);
+        flusher = std::thread([this]() { flushLoop(); });
+        return true;
+    }
+
+    // Flush everything queued so far and close the file
+    void close() {
+        if (!file) {
+            return;
+        }
+        running.store(false, std::memory_order_release);
+        if (flusher.joinable()) {
+            flusher.join();
+        }
+        std::fclose(file);
+        file = nullptr;
+    }
+
+    // Called on the I/O thread. Never blocks; drops (and counts) the sample
+    // if the flusher has fallen a whole queue behind.
+    bool record(const Sample& sample, std::chrono::steady_clock::time_point host_time) {
+        int64_t host_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(host_time.time_since_epoch()).count();
+        return queue.tryPush(Entry{sample, host_ns});
+    }
+
+    bool record(const ControllerState& state) {
+        return record(toSample(state), state.timestamp);
+    }
+
+    bool isOpen() const {
+        return file != nullptr;
+    }
+
+    uint64_t samplesRecorded() const {
+        return recorded.load(std::memory_order_relaxed);
+    }
+
+    uint64_t samplesDropped() const {
+        return queue.droppedCount();
+    }
+
+    uint64_t bytesWritten() const {
+        return bytes_written.load(std::memory_order_relaxed);
+    }
+};
+
+} // namespace insen
+
+#endif // INSEN_RECORDING_HPP
@@ -0,0 +1,270 @@
+/*
+ * INSEN Controller Client - Session replay
+ * //madebybunnyrce
+ * Plays a SessionRecorder capture back through the same callback / event
+ * queue path as a live Controller, so consumers can be tested and
+ * benchmarked without a board attached. The file is memory-mapped and
+ * decoded chunk by chunk, so even very large captures start immediately.
+ */
+
+#ifndef INSEN_REPLAY_HPP
+#define INSEN_REPLAY_HPP
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+#ifdef _WIN32
+#include <fstream>
+#include <iterator>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include "insen_event_queue.hpp"
+#include "insen_recording.hpp"
+#include "insen_state.hpp"
+
+namespace insen {
+
+class SessionReplay {
+private:
+    const uint8_t* data;
+    size_t size;
+#ifdef _WIN32
+    std::vector<uint8_t> buffer;
+#endif
+    recording::FileHeader file_header;
+
+    std::function<void(const ControllerState&)> input_callback;
+    SpscQueue<ControllerState>* event_queue;
+    std::atomic<bool> playing;
+    std::thread replay_thread;
+    std::atomic<uint64_t> delivered;
+    bool truncated;
+
+public:
+    SessionReplay() : data(nullptr), size(0), event_queue(nullptr), playing(false), delivered(0), truncated(false) {}
+
+    ~SessionReplay() {
+        stop();
+        close();
+    }
+
+    SessionReplay(const SessionReplay&) = delete;
+    SessionReplay& operator=(const SessionReplay&) = delete;
+
+    bool open(const std::string& path) {
+        close();
+
+#ifdef _WIN32
+        std::ifstream file(path, std::ios::binary);
+        if (!file) {
+            std::cerr << "Failed to open recording " << path << std::endl;
+            return false;
+        }
+        buffer.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+        data = buffer.data();
+        size = buffer.size();
+#else
+        int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+        if (fd < 0) {
+            std::cerr << "Failed to open recording " << path << std::endl;
+            return false;
+        }
+
+        struct stat info;
+        if (fstat(fd, &info) != 0 || info.st_size == 0) {
+            std::cerr << "Empty or unreadable recording " << path << std::endl;
+            ::close(fd);
+            return false;
+        }
+
+        void* mapping = mmap(nullptr, static_cast<size_t>(info.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+        ::close(fd);
+        if (mapping == MAP_FAILED) {
+            std::cerr << "Failed to map recording " << path << std::endl;
+            return false;
+        }
+        madvise(mapping, static_cast<size_t>(info.st_size), MADV_SEQUENTIAL);
+        data = static_cast<const uint8_t*>(mapping);
+        size = static_cast<size_t>(info.st_size);
+#endif
+
+        if (!recording::decodeFileHeader(data, size, file_header)) {
+            std::cerr << "Not an INSEN recording: " << path << std::endl;
+            close();
+            return false;
+        }
+        return true;
+    }
+
+    void close() {
+#ifdef _WIN32
+        buffer.clear();
+#else
+        if (data) {
+            munmap(const_cast<uint8_t*>(data), size);
+        }
+#endif
+        data = nullptr;
+        size = 0;
+    }
+
+    bool isOpen() const {
+        return data != nullptr;
+    }
+
+    // Header of the open recording, including the device's INFO response
+    const recording::FileHeader& header() const {
+        return file_header;
+    }
+
+    void setInputCallback(const std::function<void(const ControllerState&)>& callback) {
+        input_callback = callback;
+    }
+
+    // Same contract as Controller::setEventQueue
+    void setEventQueue(SpscQueue<ControllerState>* queue) {
+        event_queue = queue;
+    }
+
+    // Lowest-overhead path: decode every sample into fn(const Sample&,
+    // int64_t host_ns) with no pacing. fn may return false to stop the pass
+    // after that sample. Returns the number of samples visited.
+    template <typename Fn>
+    uint64_t visit(Fn&& fn) {
+        uint64_t count = 0;
+        truncated = false;
+        if (!data) {
+            return 0;
+        }
+
+        bool stopped = false;
+        auto step = [&](const Sample& sample, int64_t host_ns) {
+            if constexpr (std::is_same<std::invoke_result_t<Fn&, const Sample&, int64_t>, bool>::value) {
+                stopped = !fn(sample, host_ns);
+            } else {
+                fn(sample, host_ns);
+            }
+            return !stopped;
+        };
+
+        size_t offset = file_header.header_size;
+        while (offset < size) {
+            recording::ChunkHeader chunk;
+            if (!recording::decodeChunkHeader(data + offset, size - offset, chunk)) {
+                truncated = true; // e.g. the recorder was killed mid-chunk
+                break;
+            }
+            const uint8_t* payload = data + offset + recording::chunk_header_size;
+            size_t decoded = recording::decodeChunk(chunk, payload, step);
+            count += decoded;
+            if (stopped) {
+                break;
+            }
+            if (decoded != chunk.sample_count) {
+                truncated = true;
+                break;
+            }
+            offset += recording::chunk_header_size + chunk.payload_size;
+        }
+        return count;
+    }
+
+    // Deliver the recording to the callback and queue on the calling thread;
+    // returns the number of states delivered.
+    // speed 1.0 keeps the original timing, 2.0 plays twice as fast, and
+    // speed <= 0 plays as fast as possible. State timestamps keep the
+    // recorded spacing (scaled by speed), starting from now.
+    uint64_t run(double speed = 1.0) {
+        using namespace std::chrono;
+
+        bool paced = speed > 0;
+        double scale = paced ? 1.0 / speed : 1.0;
+        auto start = steady_clock::now();
+        int64_t first_ns = 0;
+        bool first = true;
+        bool threaded = playing.load(std::memory_order_relaxed);
+
+        delivered.store(0, std::memory_order_relaxed);
+
+        visit([&](const Sample& sample, int64_t host_ns) {
+            if (threaded && !playing.load(std::memory_order_relaxed)) {
+                return false; // stop() requested: end the pass without delivering
+            }
+            if (first) {
+                first_ns = host_ns;
+                first = false;
+            }
+
+            auto offset = nanoseconds(static_cast<int64_t>(static_cast<double>(host_ns - first_ns) * scale));
+            auto due = start + duration_cast<steady_clock::duration>(offset);
+            // Sleep in slices so stop() is not held up by gaps in the capture
+            while (paced && due > steady_clock::now()) {
+                std::this_thread::sleep_until(std::min(due, steady_clock::now() + milliseconds(50)));
+                if (threaded && !playing.load(std::memory_order_relaxed)) {
+                    return false;
+                }
+            }
+
+            ControllerState state = fromSample(sample, due);
+            if (event_queue) {
+                event_queue->tryPush(state);
+            }
+            if (input_callback) {
+                input_callback(state);
+            }
+            delivered.fetch_add(1, std::memory_order_relaxed);
+            return true;
+        });
+        return delivered.load(std::memory_order_relaxed);
+    }
+
+    // Replay on a background thread, like Controller::startMonitoring
+    bool start(double speed = 1.0) {
+        if (playing.load() || !data) {
+            return false;
+        }
+        playing.store(true);
+        replay_thread = std::thread([this, speed]() {
+            run(speed);
+            playing.store(false);
+        });
+        return true;
+    }
+
+    void stop() {
+        playing.store(false);
+        if (replay_thread.joinable()) {
+            replay_thread.join();
+        }
+    }
+
+    bool isPlaying() const {
+        return playing.load();
+    }
+
+    uint64_t samplesDelivered() const {
+        return delivered.load(std::memory_order_relaxed);
+    }
+
+    // True if the last pass hit a damaged or incomplete chunk
+    bool wasTruncated() const {
+        return truncated;
+    }
+};
+
+} // namespace insen
+
+#endif // INSEN_REPLAY_HPP
@@ -0,0 +1,199 @@
+/*
+ * INSEN Controller Client - Poll scheduling
+ * //madebybunnyrce
+ * Paces polls on absolute steady_clock deadlines: tick n is due at
+ * start + n / rate, so time spent in the command never accumulates as
+ * drift and fractional periods (60 Hz = 16.67 ms) are honoured exactly.
+ * A late tick still runs, but once a whole period has been lost the
+ * missed deadlines are skipped rather than caught up in a burst, so
+ * samples stay on the grid.
+ * Waiting can optionally sleep until shortly before the deadline and
+ * spin the rest, for sub-millisecond accuracy.
+ */
+
+#ifndef INSEN_SCHEDULER_HPP
+#define INSEN_SCHEDULER_HPP
+
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <mutex>
+#include <thread>
+
+#include "insen_latency.hpp"
+
+namespace insen {
+
+enum class WaitStrategy {
+    Sleep,      // sleep_until the deadline; accuracy is the OS timer slack
+    Hybrid      // Sleep until spin_window before the deadline, then spin
+};
+
+struct PacingStats {
+    uint64_t ticks = 0;
+    uint64_t missed = 0;            // Deadlines skipped after an overrun
+    double target_hz = 0.0;
+    double achieved_hz = 0.0;       // Ticks per second between the first and last tick
+    double jitter_ns = 0.0;         // Standard deviation of the tick-to-tick interval
+    LatencySnapshot lateness;       // Tick time minus its deadline
+};
+
+class PollScheduler {
+private:
+    using Clock = std::chrono::steady_clock;
+
+    mutable std::mutex mutex;
+    double rate_hz;
+    WaitStrategy strategy;
+    std::chrono::nanoseconds spin_window;
+
+    Clock::time_point start_time;
+    uint64_t index;                 // Next deadline is deadline(index)
+
+    // Tick statistics, guarded by mutex
+    uint64_t ticks;
+    uint64_t missed;
+    Clock::time_point first_tick;
+    Clock::time_point last_tick;
+    double interval_mean;           // Welford running mean/variance, ns
+    double interval_m2;
+    LatencyHistogram lateness;
+
+    Clock::time_point deadline(uint64_t n) const {
+        return start_time + std::chrono::duration_cast<Clock::duration>(
+            std::chrono::nanoseconds(std::llround(static_cast<double>(n) * 1e9 / rate_hz)));
+    }
+
+public:
+    explicit PollScheduler(double rate = 60.0, WaitStrategy wait_strategy = WaitStrategy::Sleep,
+                           std::chrono::nanoseconds spin = std::chrono::microseconds(200))
+        : rate_hz(rate > 0 ? rate : 1.0), strategy(wait_strategy), spin_window(spin) {
+        start();
+    }
+
+    PollScheduler(const PollScheduler&) = delete;
+    PollScheduler& operator=(const PollScheduler&) = delete;
+
+    // Takes effect at the next start()
+    void setRate(double rate) {
+        std::lock_guard<std::mutex> lock(mutex);
+        rate_hz = rate > 0 ? rate : 1.0;
+    }
+
+    double rate() const {
+        std::lock_guard<std::mutex> lock(mutex);
+        return rate_hz;
+    }
+
+    void setWaitStrategy(WaitStrategy wait_strategy,
+                         std::chrono::nanoseconds spin = std::chrono::microseconds(200)) {
+        std::lock_guard<std::mutex> lock(mutex);
+        strategy = wait_strategy;
+        spin_window = spin;
+    }
+
+    // Restart the grid with the first deadline at now, and clear the stats
+    void start(Clock::time_point now = Clock::now()) {
+        std::lock_guard<std::mutex> lock(mutex);
+        start_time = now;
+        index = 0;
+        ticks = missed = 0;
+        first_tick = last_tick = Clock::time_point();
+        interval_mean = interval_m2 = 0.0;
+        lateness.reset();
+    }
+
+    Clock::time_point nextDeadline() const {
+        std::lock_guard<std::mutex> lock(mutex);
+        return deadline(index);
+    }
+
+    // If the deadline after the next one has already passed, move to the
+    // latest deadline not after now, which then runs late by less than a
+    // period. Returns the number skipped.
+    uint64_t skipMissed(Clock::time_point now) {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (now < deadline(index + 1)) {
+            return 0;
+        }
+        auto elapsed = std::chrono::duration<double>(now - start_time).count();
+        auto next = static_cast<uint64_t>(std::floor(elapsed * rate_hz)) + 1;
+        while (deadline(next) <= now) {
+            next++;
+        }
+        uint64_t skipped = next - 1 - index;
+        missed += skipped;
+        index = next - 1;
+        return skipped;
+    }
+
+    // Account one tick that happened at woke for the current deadline, and
+    // advance to the next one. For callers that wait on their own timer.
+    void tick(Clock::time_point woke) {
+        std::lock_guard<std::mutex> lock(mutex);
+        lateness.record(woke - deadline(index));
+
+        if (ticks == 0) {
+            first_tick = woke;
+        } else {
+            double interval = std::chrono::duration<double, std::nano>(woke - last_tick).count();
+            double delta = interval - interval_mean;
+            interval_mean += delta / static_cast<double>(ticks);
+            interval_m2 += delta * (interval - interval_mean);
+        }
+        last_tick = woke;
+        ticks++;
+        index++;
+    }
+
+    // Wait for the next deadline, account the tick and return its time
+    Clock::time_point wait() {
+        skipMissed(Clock::now());
+
+        Clock::time_point due;
+        WaitStrategy wait_strategy;
+        std::chrono::nanoseconds spin;
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            due = deadline(index);
+            wait_strategy = strategy;
+            spin = spin_window;
+        }
+
+        if (wait_strategy == WaitStrategy::Hybrid) {
+            if (Clock::now() < due - spin) {
+                std::this_thread::sleep_until(due - spin);
+            }
+            // yield rather than a bare spin so a device emulator or the
+            // consumer sharing this core still gets to run
+            while (Clock::now() < due) {
+                std::this_thread::yield();
+            }
+        } else {
+            std::this_thread::sleep_until(due);
+        }
+
+        auto woke = Clock::now();
+        tick(woke);
+        return woke;
+    }
+
+    PacingStats stats() const {
+        std::lock_guard<std::mutex> lock(mutex);
+        PacingStats result;
+        result.ticks = ticks;
+        result.missed = missed;
+        result.target_hz = rate_hz;
+        if (ticks > 1) {
+            double span = std::chrono::duration<double>(last_tick - first_tick).count();
+            result.achieved_hz = span > 0 ? static_cast<double>(ticks - 1) / span : 0.0;
+            result.jitter_ns = std::sqrt(interval_m2 / static_cast<double>(ticks - 1));
+        }
+        result.lateness = lateness.snapshot();
+        return result;
+    }
+};
+
+} // namespace insen
+
+#endif // INSEN_SCHEDULER_HPP
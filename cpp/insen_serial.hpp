@@ -0,0 +1,256 @@
+/*
+ * INSEN Controller Client - POSIX serial port helpers
+ * //madebybunnyrce
+ * Port setup and non-blocking line I/O shared by Controller and
+ * ControllerHub. Any baud rate can be requested: standard rates use the
+ * termios constants, others (e.g. 2000000 on a USB-CDC or FTDI link) go
+ * through termios2/BOTHER on Linux. The driver's low-latency flag can be
+ * set, so USB serial adapters forward bytes at once instead of batching
+ * them on a latency timer.
+ */
+
+#ifndef INSEN_SERIAL_HPP
+#define INSEN_SERIAL_HPP
+
+#ifndef _WIN32
+
+#include <cerrno>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <string_view>
+
+#include <fcntl.h>
+#include <poll.h>
+#include <termios.h>
+#include <unistd.h>
+
+#ifdef __linux__
+#include <linux/serial.h>
+#include <sys/ioctl.h>
+#endif
+
+#include "insen_line_reader.hpp"
+#include "insen_protocol.h"
+
+// termios2 is declared by <asm/termbits.h>, which clashes with glibc's
+// <termios.h>; mirror the asm-generic layout on the architectures using it
+#if defined(__linux__) && (defined(__x86_64__) || defined(__i386__) || defined(__aarch64__) || \
+                           defined(__arm__) || defined(__riscv))
+#define INSEN_HAVE_TERMIOS2 1
+#endif
+
+namespace insen {
+
+struct SerialOptions {
+    int baud_rate = 115200;
+    bool low_latency = true;    // Ask the driver to skip its receive latency timer (Linux)
+};
+
+namespace detail {
+
+inline speed_t standardSpeed(int baud_rate) {
+    switch (baud_rate) {
+        case 9600: return B9600;
+        case 19200: return B19200;
+        case 38400: return B38400;
+        case 57600: return B57600;
+        case 115200: return B115200;
+        case 230400: return B230400;
+#ifdef __linux__
+        case 460800: return B460800;
+        case 500000: return B500000;
+        case 576000: return B576000;
+        case 921600: return B921600;
+        case 1000000: return B1000000;
+        case 1152000: return B1152000;
+        case 1500000: return B1500000;
+        case 2000000: return B2000000;
+        case 2500000: return B2500000;
+        case 3000000: return B3000000;
+        case 3500000: return B3500000;
+        case 4000000: return B4000000;
+#endif
+        default: return B0;
+    }
+}
+
+#ifdef INSEN_HAVE_TERMIOS2
+struct KernelTermios2 {
+    tcflag_t c_iflag;
+    tcflag_t c_oflag;
+    tcflag_t c_cflag;
+    tcflag_t c_lflag;
+    cc_t c_line;
+    cc_t c_cc[19];
+    speed_t c_ispeed;
+    speed_t c_ospeed;
+};
+
+constexpr tcflag_t kernel_bother = 0010000;
+
+// Set an arbitrary rate after the rest of the termios setup is applied
+inline bool setCustomSpeed(int fd, int baud_rate) {
+    KernelTermios2 tio;
+    if (ioctl(fd, _IOR('T', 0x2A, KernelTermios2), &tio) != 0) {
+        return false;
+    }
+    tio.c_cflag = (tio.c_cflag & ~static_cast<tcflag_t>(CBAUD)) | kernel_bother;
+    tio.c_ispeed = tio.c_ospeed = static_cast<speed_t>(baud_rate);
+    return ioctl(fd, _IOW('T', 0x2B, KernelTermios2), &tio) == 0;
+}
+#endif
+
+#ifdef __linux__
+// Best effort: only some drivers (e.g. ftdi_sio, 8250) support it
+inline bool setLowLatency(int fd, bool enable) {
+    struct serial_struct serial;
+    if (ioctl(fd, TIOCGSERIAL, &serial) != 0) {
+        return false;
+    }
+    serial.flags = enable ? (serial.flags | ASYNC_LOW_LATENCY) : (serial.flags & ~ASYNC_LOW_LATENCY);
+    return ioctl(fd, TIOCSSERIAL, &serial) == 0;
+}
+#endif
+
+} // namespace detail
+
+// Rate the port is actually configured for, or 0 if it cannot be read
+inline int serialBaudRate(int fd) {
+#ifdef INSEN_HAVE_TERMIOS2
+    detail::KernelTermios2 tio;
+    if (ioctl(fd, _IOR('T', 0x2A, detail::KernelTermios2), &tio) == 0) {
+        return static_cast<int>(tio.c_ospeed);
+    }
+#endif
+    struct termios tty;
+    if (tcgetattr(fd, &tty) != 0) {
+        return 0;
+    }
+    speed_t speed = cfgetospeed(&tty);
+    for (int rate : {9600, 19200, 38400, 57600, 115200, 230400, 460800, 500000, 576000, 921600,
+                     1000000, 1152000, 1500000, 2000000, 2500000, 3000000, 3500000, 4000000}) {
+        if (detail::standardSpeed(rate) == speed && speed != B0) {
+            return rate;
+        }
+    }
+    return 0;
+}
+
+// Open and configure a port for 8N1 raw I/O. The fd is non-blocking: every
+// read is preceded by poll(), so callers wake on data instead of sitting
+// in VTIME timeouts. Returns -1 (after logging why) on failure.
+inline int openSerialPort(const std::string& port_name, const SerialOptions& options = SerialOptions()) {
+    int fd = open(port_name.c_str(), O_RDWR | O_NOCTTY | O_NONBLOCK);
+
+    if (fd < 0) {
+        std::cerr << "Failed to open port " << port_name << std::endl;
+        return -1;
+    }
+
+    struct termios tty;
+    if (tcgetattr(fd, &tty) != 0) {
+        std::cerr << "Failed to get terminal attributes" << std::endl;
+        close(fd);
+        return -1;
+    }
+
+    speed_t speed = detail::standardSpeed(options.baud_rate);
+#ifndef INSEN_HAVE_TERMIOS2
+    if (speed == B0) {
+        std::cerr << "Unsupported baud rate " << options.baud_rate << std::endl;
+        close(fd);
+        return -1;
+    }
+#endif
+    // A non-standard rate starts from 115200 and is replaced below
+    cfsetospeed(&tty, speed != B0 ? speed : B115200);
+    cfsetispeed(&tty, speed != B0 ? speed : B115200);
+
+    tty.c_cflag = (tty.c_cflag & ~CSIZE) | CS8;
+    tty.c_iflag &= ~IGNBRK;
+    tty.c_lflag = 0;
+    tty.c_oflag = 0;
+    tty.c_cc[VMIN] = 0;
+    tty.c_cc[VTIME] = 10;
+
+    tty.c_iflag &= ~(IXON | IXOFF | IXANY);
+    tty.c_cflag |= (CLOCAL | CREAD);
+    tty.c_cflag &= ~(PARENB | PARODD);
+    tty.c_cflag &= ~CSTOPB;
+    tty.c_cflag &= ~CRTSCTS;
+
+    if (tcsetattr(fd, TCSANOW, &tty) != 0) {
+        std::cerr << "Failed to set terminal attributes" << std::endl;
+        close(fd);
+        return -1;
+    }
+
+#ifdef INSEN_HAVE_TERMIOS2
+    if (speed == B0 && !detail::setCustomSpeed(fd, options.baud_rate)) {
+        std::cerr << "Failed to set baud rate " << options.baud_rate << std::endl;
+        close(fd);
+        return -1;
+    }
+#endif
+#ifdef __linux__
+    detail::setLowLatency(fd, options.low_latency);
+#endif
+
+    return fd;
+}
+
+// Write command + "\r\n" completely, waiting for room if the port is full
+inline bool writeLine(int fd, std::string_view command) {
+    char line[256];
+    size_t length = insen_encode_command(line, sizeof(line), command.data(), command.size());
+    if (length == 0) {
+        return false;
+    }
+
+    const char* data = line;
+
+    while (length > 0) {
+        ssize_t written = write(fd, data, length);
+        if (written < 0 && (errno == EAGAIN || errno == EINTR)) {
+            struct pollfd pfd = {fd, POLLOUT, 0};
+            poll(&pfd, 1, 100);
+            continue;
+        }
+        if (written < 0) {
+            return false;
+        }
+        data += written;
+        length -= static_cast<size_t>(written);
+    }
+
+    return true;
+}
+
+// Drain whatever a non-blocking fd has into rx.
+// Returns false if the port reported an error or hung up.
+template <size_t Capacity>
+bool readAvailable(int fd, LineReader<Capacity>& rx) {
+    for (;;) {
+        char* dest = rx.writePtr();
+        ssize_t bytes_read = read(fd, dest, rx.writeSpace());
+        if (bytes_read > 0) {
+            rx.commit(static_cast<size_t>(bytes_read));
+            if (rx.writeSpace() > 0) {
+                continue;
+            }
+            return true;
+        }
+        if (bytes_read < 0 && (errno == EAGAIN || errno == EINTR)) {
+            return true;
+        }
+        // An error, or 0 bytes: end of file once the device is unplugged
+        return false;
+    }
+}
+
+} // namespace insen
+
+#endif // _WIN32
+
+#endif // INSEN_SERIAL_HPP
@@ -0,0 +1,75 @@
+/*
+ * INSEN Controller Client - Controller state types
+ * //madebybunnyrce
+ * ControllerState is the in-process view of one sample: the firmware's
+ * own timestamp, the host time it was received, and (once the clock is
+ * synchronized) the host time the device actually took it. Sample is the
+ * packed 20-byte layout shared with the C library, used wherever samples
+ * are stored in bulk.
+ */
+
+#ifndef INSEN_STATE_HPP
+#define INSEN_STATE_HPP
+
+#include <chrono>
+#include <cstdint>
+
+#include "insen_sample.h"
+
+namespace insen {
+
+struct ControllerState {
+    int16_t left_stick_x, left_stick_y;
+    int16_t right_stick_x, right_stick_y;
+    uint8_t left_trigger, right_trigger;
+    uint16_t buttons;
+    uint8_t dpad;
+    uint8_t battery;
+    uint8_t id;
+    uint32_t device_time;                                   // Firmware timestamp, 0 if not sent
+    std::chrono::steady_clock::time_point timestamp;        // Host time the reply was received
+    std::chrono::steady_clock::time_point sample_time;      // device_time on the host clock
+};
+
+static_assert(sizeof(ControllerState) <= 40, "ControllerState should stay within 40 bytes");
+
+using Sample = insen_controller_state_t;
+
+inline Sample toSample(const ControllerState& state) {
+    Sample sample = {};
+    sample.left_stick_x = state.left_stick_x;
+    sample.left_stick_y = state.left_stick_y;
+    sample.right_stick_x = state.right_stick_x;
+    sample.right_stick_y = state.right_stick_y;
+    sample.left_trigger = state.left_trigger;
+    sample.right_trigger = state.right_trigger;
+    sample.buttons = state.buttons;
+    sample.dpad = state.dpad;
+    sample.controller_id = state.id;
+    sample.battery_level = state.battery;
+    sample.timestamp = state.device_time;
+    return sample;
+}
+
+inline ControllerState fromSample(const Sample& sample,
+                                  std::chrono::steady_clock::time_point timestamp = {}) {
+    ControllerState state = {};
+    state.left_stick_x = sample.left_stick_x;
+    state.left_stick_y = sample.left_stick_y;
+    state.right_stick_x = sample.right_stick_x;
+    state.right_stick_y = sample.right_stick_y;
+    state.left_trigger = sample.left_trigger;
+    state.right_trigger = sample.right_trigger;
+    state.buttons = sample.buttons;
+    state.dpad = sample.dpad;
+    state.id = sample.controller_id;
+    state.battery = sample.battery_level;
+    state.device_time = sample.timestamp;
+    state.timestamp = timestamp;
+    state.sample_time = timestamp;
+    return state;
+}
+
+} // namespace insen
+
+#endif // INSEN_STATE_HPP
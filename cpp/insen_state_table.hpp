@@ -0,0 +1,131 @@
+/*
+ * INSEN Controller Client - Latest-state table
+ * //madebybunnyrce
+ * Fixed-size table of the most recent state per controller id. Each slot
+ * sits on its own cache line and is published with a sequence lock: the
+ * I/O thread writes without waiting, and any other thread can copy out a
+ * consistent snapshot without locks or allocation.
+ */
+
+#ifndef INSEN_STATE_TABLE_HPP
+#define INSEN_STATE_TABLE_HPP
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+
+#include "insen_state.hpp"
+
+namespace insen {
+
+// Same limit as INSEN_MAX_CONTROLLERS in the C library
+constexpr size_t default_max_controllers = 4;
+
+template <typename T = ControllerState, size_t Capacity = default_max_controllers>
+class StateTable {
+    static_assert(std::is_trivially_copyable<T>::value, "StateTable needs a trivially copyable state");
+
+private:
+    static constexpr size_t word_count = (sizeof(T) + sizeof(uint64_t) - 1) / sizeof(uint64_t);
+
+    // The payload is kept in atomic words so a reader racing a writer is
+    // well-defined; the sequence tells it whether to retry.
+    struct alignas(64) Slot {
+        std::atomic<uint32_t> sequence{0};     // Odd while a write is in progress
+        std::atomic<uint64_t> words[word_count];
+    };
+
+    std::array<Slot, Capacity> slots;
+    std::atomic<uint64_t> rejected_stores{0};    // store() calls with an id outside the table
+
+public:
+    StateTable() {
+        for (auto& slot : slots) {
+            for (auto& word : slot.words) {
+                word.store(0, std::memory_order_relaxed);
+            }
+        }
+    }
+
+    StateTable(const StateTable&) = delete;
+    StateTable& operator=(const StateTable&) = delete;
+
+    static constexpr size_t capacity() {
+        return Capacity;
+    }
+
+    // Publish a new state. Wait-free; one writer per slot at a time.
+    // Out-of-range ids are counted in rejected() rather than stored.
+    bool store(int id, const T& state) {
+        if (id < 0 || static_cast<size_t>(id) >= Capacity) {
+            rejected_stores.fetch_add(1, std::memory_order_relaxed);
+            return false;
+        }
+
+        uint64_t buffer[word_count] = {};
+        std::memcpy(buffer, &state, sizeof(T));
+
+        Slot& slot = slots[static_cast<size_t>(id)];
+        uint32_t sequence = slot.sequence.load(std::memory_order_relaxed);
+        slot.sequence.store(sequence + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+
+        for (size_t i = 0; i < word_count; i++) {
+            slot.words[i].store(buffer[i], std::memory_order_relaxed);
+        }
+
+        slot.sequence.store(sequence + 2, std::memory_order_release);
+        return true;
+    }
+
+    // Copy out the latest state. Returns false if id is out of range or
+    // nothing has been published for it yet.
+    bool load(int id, T& state) const {
+        if (id < 0 || static_cast<size_t>(id) >= Capacity) {
+            return false;
+        }
+
+        const Slot& slot = slots[static_cast<size_t>(id)];
+        uint64_t buffer[word_count];
+        uint32_t before, after;
+
+        do {
+            before = slot.sequence.load(std::memory_order_acquire);
+            if (before & 1) {
+                continue; // Writer mid-update
+            }
+            for (size_t i = 0; i < word_count; i++) {
+                buffer[i] = slot.words[i].load(std::memory_order_relaxed);
+            }
+            std::atomic_thread_fence(std::memory_order_acquire);
+            after = slot.sequence.load(std::memory_order_relaxed);
+        } while ((before & 1) || before != after);
+
+        if (before == 0) {
+            return false;
+        }
+
+        std::memcpy(&state, buffer, sizeof(T));
+        return true;
+    }
+
+    // Number of states published for id; lets readers skip unchanged slots
+    uint32_t version(int id) const {
+        if (id < 0 || static_cast<size_t>(id) >= Capacity) {
+            return 0;
+        }
+        return slots[static_cast<size_t>(id)].sequence.load(std::memory_order_acquire) / 2;
+    }
+
+    // Number of states dropped because their id did not fit the table
+    uint64_t rejected() const {
+        return rejected_stores.load(std::memory_order_relaxed);
+    }
+};
+
+} // namespace insen
+
+#endif // INSEN_STATE_TABLE_HPP